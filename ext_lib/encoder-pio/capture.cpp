@@ -1,5 +1,6 @@
 #include <math.h>
 #include <cfloat>
+#include <climits>
 #include "capture.hpp"
 
 namespace pimoroni {
@@ -7,9 +8,12 @@ namespace pimoroni {
   ////////////////////////////////////////////////////////////////////////////////////////////////////
   // CONSTRUCTORS
   ////////////////////////////////////////////////////////////////////////////////////////////////////
-  Capture::Capture(int32_t captured_count, int32_t count_change, float average_frequency, float counts_per_revolution) :
-    captured_count(captured_count), count_change(count_change), average_frequency(average_frequency),
-    counts_per_revolution(std::max(counts_per_revolution, FLT_MIN)) { //Clamp counts_per_rev to avoid potential NaN
+  Capture::Capture(int32_t captured_count, int32_t count_change, int32_t cumulative_time, uint32_t clocks_per_time,
+                   float counts_per_revolution, uint32_t revs_per_count_q24) :
+    captured_count(captured_count), count_change(count_change), cumulative_time(cumulative_time),
+    clocks_per_time(clocks_per_time),
+    counts_per_revolution(std::max(counts_per_revolution, FLT_MIN)), //Clamp counts_per_rev to avoid potential NaN
+    revs_per_count_q24(revs_per_count_q24) {
   }
 
 
@@ -43,6 +47,11 @@ namespace pimoroni {
 
   ////////////////////////////////////////////////////////////////////////////////////////////////////
   float Capture::get_frequency() const {
+    //Calculate the average frequency of state transitions
+    float average_frequency = 0.0f;
+    if(count_change != 0 && cumulative_time != INT_MAX) {
+      average_frequency = ((float)clocks_per_time * (float)count_change) / (float)cumulative_time;
+    }
     return average_frequency;
   }
 
@@ -65,6 +74,59 @@ namespace pimoroni {
   float Capture::get_radians_per_second() const {
     return get_revolutions_per_second() * M_TWOPI;
   }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  q16_t Capture::get_revolutions_q16() const {
+    return q16::saturate(((int64_t)get_count() * revs_per_count_q24) >> 8);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  q16_t Capture::get_angle_degrees_q16() const {
+    return q16::saturate((int64_t)get_revolutions_q16() * 360);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  q16_t Capture::get_angle_radians_q16() const {
+    return q16::mul(get_revolutions_q16(), q16::TWO_PI);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  q16_t Capture::get_frequency_q16() const {
+    q16_t average_frequency = 0;
+    if(count_change != 0 && cumulative_time > 0 && cumulative_time != INT_MAX) {
+      average_frequency = q16::divide(((int64_t)clocks_per_time * count_change) << 16, cumulative_time);
+    }
+    return average_frequency;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  q16_t Capture::get_revolutions_per_second_q16() const {
+    //Work from the raw values rather than get_frequency_q16() so that a saturated frequency
+    //does not limit the result. The PIO loop rate is less than 2^27, so rev_clocks_q16 < 2^43
+    q16_t average_rps = 0;
+    if(count_change != 0 && cumulative_time > 0 && cumulative_time != INT_MAX) {
+      if(count_change > (1 << 20) || count_change < -(1 << 20))
+        return (count_change > 0) ? INT32_MAX : INT32_MIN;
+      int64_t rev_clocks_q16 = ((int64_t)clocks_per_time * revs_per_count_q24) >> 8;
+      average_rps = q16::divide(rev_clocks_q16 * count_change, cumulative_time);
+    }
+    return average_rps;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  q16_t Capture::get_revolutions_per_minute_q16() const {
+    return q16::saturate((int64_t)get_revolutions_per_second_q16() * 60);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  q16_t Capture::get_degrees_per_second_q16() const {
+    return q16::saturate((int64_t)get_revolutions_per_second_q16() * 360);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  q16_t Capture::get_radians_per_second_q16() const {
+    return q16::mul(get_revolutions_per_second_q16(), q16::TWO_PI);
+  }
   ////////////////////////////////////////////////////////////////////////////////////////////////////
   ////////////////////////////////////////////////////////////////////////////////////////////////////
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "pico/stdlib.h"
+#include "q16.hpp"
 
 namespace pimoroni {
 
@@ -11,8 +12,10 @@ namespace pimoroni {
   private:
     const int32_t captured_count        = 0;
     const int32_t count_change          = 0;      
-    const float average_frequency       = 0.0f;
+    const int32_t cumulative_time       = 0;
+    const uint32_t clocks_per_time      = 0;
     const float counts_per_revolution   = 1;
+    const uint32_t revs_per_count_q24   = 1 << 24;
 
 
     //--------------------------------------------------
@@ -20,7 +23,10 @@ namespace pimoroni {
     //--------------------------------------------------
   public:
     Capture() {}
-    Capture(int32_t captured_count, int32_t count_change, float average_frequency, float counts_per_revolution);
+    // cumulative_time is the number of PIO loops the count_change took; clocks_per_time is the
+    // number of PIO loops per second. revs_per_count_q24 is 2^24 / counts_per_revolution.
+    Capture(int32_t captured_count, int32_t count_change, int32_t cumulative_time, uint32_t clocks_per_time,
+            float counts_per_revolution, uint32_t revs_per_count_q24);
 
 
     //--------------------------------------------------
@@ -39,6 +45,18 @@ namespace pimoroni {
     float get_revolutions_per_minute() const;
     float get_degrees_per_second() const;
     float get_radians_per_second() const;
+
+    // Fixed point versions of the above that avoid software floating point.
+    // Results outside the Q16.16 range saturate.
+    q16_t get_revolutions_q16() const;
+    q16_t get_angle_degrees_q16() const;
+    q16_t get_angle_radians_q16() const;
+
+    q16_t get_frequency_q16() const;
+    q16_t get_revolutions_per_second_q16() const;
+    q16_t get_revolutions_per_minute_q16() const;
+    q16_t get_degrees_per_second_q16() const;
+    q16_t get_radians_per_second_q16() const;
   };
 
 }
\ No newline at end of file
@@ -1,11 +1,11 @@
 #include <math.h>
 #include <climits>
+#include <algorithm>
 #include "hardware/irq.h"
+#include "hardware/dma.h"
 #include "encoder.hpp"
 #include "encoder.pio.h"
-
-#define LAST_STATE(state)  ((state) & 0b0011)
-#define CURR_STATE(state)  (((state) & 0b1100) >> 2)
+#include "quadrature.hpp"
 
 namespace pimoroni {
 
@@ -17,20 +17,23 @@ namespace pimoroni {
 
   ////////////////////////////////////////////////////////////////////////////////////////////////////
   void Encoder::pio0_interrupt_callback() {
-    //Go through each of encoders on this PIO to see which triggered this interrupt
-    for(uint8_t sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
-      if(pio_encoders[0][sm] != nullptr) { 
-        pio_encoders[0][sm]->check_for_transition(); 
-      }
-    }
+    dispatch_interrupt(0);
   }
 
   ////////////////////////////////////////////////////////////////////////////////////////////////////
   void Encoder::pio1_interrupt_callback() {
-    //Go through each of encoders on this PIO to see which triggered this interrupt
-    for(uint8_t sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
-      if(pio_encoders[1][sm] != nullptr) { 
-        pio_encoders[1][sm]->check_for_transition(); 
+    dispatch_interrupt(1);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  void Encoder::dispatch_interrupt(uint pio_idx) {
+    //Only visit the encoders whose RX FIFO has data; the M0+ has no count trailing zeros
+    //instruction, so shift through the pending bits instead
+    PIO pio = (pio_idx == 0) ? pio0 : pio1;
+    uint32_t pending = (pio->ints0 >> PIO_IRQ0_INTS_SM0_RXNEMPTY_LSB) & ((1u << NUM_PIO_STATE_MACHINES) - 1);
+    for(uint8_t sm = 0; pending != 0; sm++, pending >>= 1) {
+      if((pending & 1u) && pio_encoders[pio_idx][sm] != nullptr) {
+        pio_encoders[pio_idx][sm]->check_for_transition();
       }
     }
   }
@@ -45,11 +48,18 @@ namespace pimoroni {
                    uint16_t freq_divider) :
     enc_pio(pio), pinA(pinA), pinB(pinB), pinC(pinC),
     counts_per_revolution(counts_per_revolution), count_microsteps(count_microsteps),
-    freq_divider(freq_divider), clocks_per_time((float)(clock_get_hz(clk_sys) / (ENC_LOOP_CYCLES * freq_divider))) {
+    freq_divider(freq_divider), clocks_per_time((float)(clock_get_hz(clk_sys) / (ENC_LOOP_CYCLES * freq_divider))),
+    clocks_per_time_int(clock_get_hz(clk_sys) / (ENC_LOOP_CYCLES * freq_divider)),
+    revs_per_count_q24((uint32_t)((float)(1 << 24) / std::max(counts_per_revolution, 1.0f))) {
   }
 
   ////////////////////////////////////////////////////////////////////////////////////////////////////
   Encoder::~Encoder() {
+    if(dma_channel >= 0) {
+      dma_channel_abort(dma_channel);
+      dma_channel_unclaim(dma_channel);
+    }
+
     //Clean up our use of the SM associated with this encoder
     encoder_program_release(enc_pio, enc_sm);
     uint index = pio_get_index(enc_pio);
@@ -125,7 +135,7 @@ namespace pimoroni {
 
   ////////////////////////////////////////////////////////////////////////////////////////////////////
   int32_t Encoder::get_count() const {
-    return count - count_offset;
+    return count.load(std::memory_order_relaxed) - count_offset;
   }
 
   ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -145,7 +155,16 @@ namespace pimoroni {
 
   ////////////////////////////////////////////////////////////////////////////////////////////////////
   float Encoder::get_frequency() const {
-    return clocks_per_time / (float)time_since;
+    return clocks_per_time / (float)time_since.load(std::memory_order_relaxed);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  q16_t Encoder::get_frequency_q16() const {
+    int32_t time = time_since.load(std::memory_order_relaxed);
+    if(time == 0)
+      return INT32_MAX;
+    return (time > 0) ? q16::divide((int64_t)clocks_per_time_int << 16, time)
+                      : q16::divide(-((int64_t)clocks_per_time_int << 16), -time);
   }
 
   ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -170,162 +189,159 @@ namespace pimoroni {
 
   ////////////////////////////////////////////////////////////////////////////////////////////////////
   void Encoder::zero_count() {
-    count_offset = count;
+    count_offset = count.load(std::memory_order_relaxed);
   }
 
   ////////////////////////////////////////////////////////////////////////////////////////////////////
   Capture Encoder::perform_capture() {
-    //Capture the current values
-		int32_t captured_count = count;
-		int32_t captured_cumulative_time = cumulative_time;
-		cumulative_time = 0;
-
-    //Determine the change in counts since the last capture was performed
-		int32_t count_change = captured_count - last_captured_count;
-		last_captured_count = captured_count;
-
-    //Calculate the average frequency of state transitions    
-    float average_frequency = 0.0f;
-		if(count_change != 0 && captured_cumulative_time != INT_MAX) {
-      average_frequency = (clocks_per_time * (float)count_change) / (float)captured_cumulative_time;
-    }
+    //Capture the current values, starting again if the interrupt handler changed them part way through
+    int32_t captured_count;
+    uint64_t captured_total_time;
+    uint32_t start;
+    do {
+      start = seqlock.read_begin();
+      captured_count = count.load(std::memory_order_relaxed);
+      captured_total_time = ((uint64_t)total_time_hi.load(std::memory_order_relaxed) << 32) |
+                            total_time_lo.load(std::memory_order_relaxed);
+    } while(seqlock.read_retry(start));
+
+    //Determine the change in counts and the time taken by them since the last capture was performed
+    int32_t count_change = captured_count - last_captured_count;
+    last_captured_count = captured_count;
+    uint64_t time_change = captured_total_time - last_captured_total_time;
+    last_captured_total_time = captured_total_time;
+    int32_t captured_cumulative_time = (time_change > (uint64_t)INT32_MAX) ? INT32_MAX : (int32_t)time_change;
+
+    //The average frequency of state transitions is calculated when it is asked for
+    return Capture(captured_count, count_change, captured_cumulative_time, clocks_per_time_int,
+                   counts_per_revolution, revs_per_count_q24);
+  }
 
-    return Capture(captured_count, count_change, average_frequency, counts_per_revolution);
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  void Encoder::set_event_queue(EncoderEventQueue* queue, uint8_t id) {
+    event_id = id;
+    event_queue = queue;
   }
 
   ////////////////////////////////////////////////////////////////////////////////////////////////////
-  void Encoder::microstep_up(int32_t time) {
-    count++;
-    time_since = time;
-    microstep_time = 0;
+  bool Encoder::init_dma(uint32_t* ring, uint8_t ring_bits) {
+    uint32_t ring_bytes = 4u << ring_bits;
+    if(dma_channel >= 0 || ring == nullptr || ring_bits > MAX_DMA_RING_BITS ||
+       ((uintptr_t)ring & (ring_bytes - 1)) != 0) {
+      return false;
+    }
 
-    if(time + cumulative_time < time)  //Check to avoid integer overflow
-      cumulative_time = INT_MAX;
-    else
-      cumulative_time += time;
+    dma_channel = dma_claim_unused_channel(false);
+    if(dma_channel < 0)
+      return false;
+
+    //Words already in the RX FIFO are left for the DMA channel
+    hw_clear_bits(&enc_pio->inte0, PIO_IRQ0_INTE_SM0_RXNEMPTY_BITS << enc_sm);
+
+    dma_ring = ring;
+    dma_ring_mask = (1u << ring_bits) - 1;
+    dma_read_count = 0;
+    dma_channel_config c = dma_channel_get_default_config(dma_channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, ring_bits + 2);
+    channel_config_set_dreq(&c, pio_get_dreq(enc_pio, enc_sm, false));
+    dma_channel_configure(dma_channel, &c, ring, &enc_pio->rxf[enc_sm], DMA_TRANSFER_COUNT, true);
+    return true;
   }
 
   ////////////////////////////////////////////////////////////////////////////////////////////////////
-  void Encoder::microstep_down(int32_t time) {
-    count--;
-    time_since = 0 - time;
-    microstep_time = 0;
+  uint32_t Encoder::process_dma() {
+    if(dma_channel < 0)
+      return 0;
+
+    //The transfer count counts down as words are written
+    uint32_t write_count = DMA_TRANSFER_COUNT - dma_channel_hw_addr(dma_channel)->transfer_count;
+    uint32_t num_words = write_count - dma_read_count;
+    if(num_words > dma_ring_mask + 1) {
+      dma_overrun_count += num_words - (dma_ring_mask + 1);
+      dma_read_count = write_count - (dma_ring_mask + 1);
+    }
+
+    //Decode in runs that do not wrap around the end of the ring
+    uint32_t processed = 0;
+    while(dma_read_count != write_count) {
+      uint32_t idx = dma_read_count & dma_ring_mask;
+      uint32_t run = std::min(write_count - dma_read_count, dma_ring_mask + 1 - idx);
+      process_words(dma_ring + idx, run);
+      dma_read_count += run;
+      processed += run;
+    }
 
-    if(time + cumulative_time < time)  //Check to avoid integer overflow
-      cumulative_time = INT_MAX;
-    else
-      cumulative_time += time;
+    //Once the transfer finishes, start another one from where it stopped
+    if(write_count == DMA_TRANSFER_COUNT) {
+      dma_read_count = 0;
+      dma_channel_set_trans_count(dma_channel, DMA_TRANSFER_COUNT, true);
+    }
+    return processed;
   }
 
   ////////////////////////////////////////////////////////////////////////////////////////////////////
-  void Encoder::check_for_transition() {
-    while(enc_pio->ints0 & (PIO_IRQ0_INTS_SM0_RXNEMPTY_BITS << enc_sm)) {
-      uint32_t received = pio_sm_get(enc_pio, enc_sm);
+  uint32_t Encoder::get_dma_overrun_count() const {
+    return dma_overrun_count;
+  }
 
-      // Extract the current and last encoder states from the received value
-      stateA = (bool)(received & STATE_A_MASK);
-      stateB = (bool)(received & STATE_B_MASK);
-      uint8_t states = (received & STATES_MASK) >> 28;  
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  void Encoder::process_words(const uint32_t* words, uint32_t num_words) {
+    for(uint32_t i = 0; i < num_words; i++) {
+      process_received(words[i]);
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  void Encoder::process_received(uint32_t received) {
+    // Extract the current and last encoder states from the received value
+    stateA = (bool)(received & STATE_A_MASK);
+    stateB = (bool)(received & STATE_B_MASK);
+    const quadrature::Transition& transition = quadrature::TRANSITIONS[(received & STATES_MASK) >> STATES_SHIFT];
 
-      // Extract the time (in cycles) it has been since the last received
-      int32_t time_received = (received & TIME_MASK) + ENC_DEBOUNCE_TIME;
+    // Extract the time (in cycles) it has been since the last received. It is at most 28 bits, so cannot overflow
+    int32_t time_received = (received & TIME_MASK) + ENC_DEBOUNCE_TIME;
 
+    int32_t step = transition.step;
+    if(!count_microsteps) {
       // For rotary encoders, only every fourth transition is cared about, causing an inaccurate time value
       // To address this we accumulate the times received and zero it when a transition is counted
-      if(!count_microsteps) {
-        if(time_received + microstep_time < time_received)  //Check to avoid integer overflow
-          time_received = INT32_MAX;
-        else
-          time_received += microstep_time;
-        microstep_time = time_received;
-      }
+      time_received = quadrature::saturating_add(time_received, microstep_time);
+      microstep_time = time_received;
 
-      // Determine what transition occurred
-      switch(LAST_STATE(states)) {
-        //--------------------------------------------------
-        case MICROSTEP_0:
-          switch(CURR_STATE(states)) {
-            // A ____|‾‾‾‾
-            // B _________
-            case MICROSTEP_1:   
-              if(count_microsteps)
-                microstep_up(time_received);
-              break;
-
-            // A _________
-            // B ____|‾‾‾‾
-            case MICROSTEP_3:
-              if(count_microsteps)
-                microstep_down(time_received);           
-              break;
-          }
-          break;
-
-        //--------------------------------------------------
-        case MICROSTEP_1:
-          switch(CURR_STATE(states)) {
-            // A ‾‾‾‾‾‾‾‾‾
-            // B ____|‾‾‾‾
-            case MICROSTEP_2:
-              if(count_microsteps || last_travel_dir == CLOCKWISE)
-                microstep_up(time_received);
-
-              last_travel_dir = NO_DIR;  //Finished turning clockwise
-              break;
-
-            // A ‾‾‾‾|____
-            // B _________
-            case MICROSTEP_0:
-              if(count_microsteps)
-                microstep_down(time_received);
-              break;
-          }
-          break;
-          
-        //--------------------------------------------------
-        case MICROSTEP_2:
-          switch(CURR_STATE(states)) {
-            // A ‾‾‾‾|____
-            // B ‾‾‾‾‾‾‾‾‾
-            case MICROSTEP_3:
-              if(count_microsteps)
-                microstep_up(time_received);
-              
-              last_travel_dir = CLOCKWISE;  //Started turning clockwise
-              break;
-
-            // A ‾‾‾‾‾‾‾‾‾
-            // B ‾‾‾‾|____
-            case MICROSTEP_1:
-              if(count_microsteps)
-                microstep_down(time_received);
-              
-              last_travel_dir = COUNTERCLOCK; //Started turning counter-clockwise
-              break;
-          }
-          break;
-
-        //--------------------------------------------------
-        case MICROSTEP_3:
-          switch(CURR_STATE(states)) {
-            // A _________
-            // B ‾‾‾‾|____
-            case MICROSTEP_0:
-              if(count_microsteps)
-                microstep_up(time_received);
-              break;
-
-            // A ____|‾‾‾‾
-            // B ‾‾‾‾‾‾‾‾‾
-            case MICROSTEP_2:
-              if(count_microsteps || last_travel_dir == COUNTERCLOCK)
-                microstep_down(time_received);
-              
-              last_travel_dir = NO_DIR;    //Finished turning counter-clockwise
-              break;
-          }
-          break;
-      }
+      // Only count a detent if it finishes in the direction it started
+      if(!transition.detent_end || last_travel_dir != step)
+        step = 0;
+    }
+
+    if(transition.dir != quadrature::KEEP_DIR)
+      last_travel_dir = (Direction)transition.dir;
+
+    if(step != 0) {
+      microstep_time = 0;
+
+      //Only this writer changes these, so they can be read back without the lock
+      uint32_t time_lo = total_time_lo.load(std::memory_order_relaxed);
+      uint32_t new_time_lo = time_lo + (uint32_t)time_received;
+      seqlock.write_begin();
+      count.store(count.load(std::memory_order_relaxed) + step, std::memory_order_relaxed);
+      time_since.store((step > 0) ? time_received : -time_received, std::memory_order_relaxed);
+      total_time_lo.store(new_time_lo, std::memory_order_relaxed);
+      if(new_time_lo < time_lo)
+        total_time_hi.store(total_time_hi.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      seqlock.write_end();
+
+      if(event_queue != nullptr)
+        event_queue->push(EncoderEvent{time_us_32(), (int8_t)step, event_id});
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  void Encoder::check_for_transition() {
+    while(enc_pio->ints0 & (PIO_IRQ0_INTS_SM0_RXNEMPTY_BITS << enc_sm)) {
+      process_received(pio_sm_get(enc_pio, enc_sm));
     }
   }
   ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -2,6 +2,8 @@
 
 #include "hardware/pio.h"
 #include "capture.hpp"
+#include "encoder_event_queue.hpp"
+#include "seqlock.hpp"
 
 namespace pimoroni {
 
@@ -24,12 +26,13 @@ namespace pimoroni {
     static const uint32_t STATES_MASK = STATE_A_MASK | STATE_B_MASK |
                                         STATE_A_LAST_MASK | STATE_B_LAST_MASK;
 
+    static const uint32_t STATES_SHIFT = 28;
+
     static const uint32_t TIME_MASK   = 0x0fffffff;
 
-    static const uint8_t MICROSTEP_0  = 0b00;
-    static const uint8_t MICROSTEP_1  = 0b10;
-    static const uint8_t MICROSTEP_2  = 0b11;
-    static const uint8_t MICROSTEP_3  = 0b01;
+    // A multiple of every ring size, so a restarted transfer keeps writing where the last one ended
+    static const uint32_t DMA_TRANSFER_COUNT = 0x80000000;
+    static const uint8_t MAX_DMA_RING_BITS   = 13;   // the DMA ring can be at most 32KB
 
 
     //--------------------------------------------------
@@ -56,6 +59,8 @@ namespace pimoroni {
     const bool count_microsteps         = DEFAULT_COUNT_MICROSTEPS;
     const uint16_t freq_divider         = DEFAULT_FREQ_DIVIDER;
     const float clocks_per_time         = 0;
+    const uint32_t clocks_per_time_int  = 0;
+    const uint32_t revs_per_count_q24   = 0;
 
     //--------------------------------------------------
     
@@ -64,14 +69,30 @@ namespace pimoroni {
 
     volatile bool stateA                = false;
     volatile bool stateB                = false;
-    volatile int32_t count              = 0;
-    volatile int32_t time_since         = 0;
     volatile Direction last_travel_dir  = NO_DIR;
     volatile int32_t microstep_time     = 0;
-    volatile int32_t cumulative_time    = 0;
+
+    // Written by the interrupt handler (or process_dma()) inside seqlock, so readers on
+    // either core can take a consistent snapshot. The total time of all counted steps
+    // only ever grows; captures take the difference from the last one.
+    SeqLock seqlock;
+    std::atomic<int32_t> count{0};
+    std::atomic<int32_t> time_since{0};
+    std::atomic<uint32_t> total_time_lo{0};
+    std::atomic<uint32_t> total_time_hi{0};
 
     int32_t count_offset                = 0;
     int32_t last_captured_count         = 0;
+    uint64_t last_captured_total_time   = 0;
+
+    EncoderEventQueue* event_queue      = nullptr;
+    uint8_t event_id                    = 0;
+
+    int dma_channel                     = -1;
+    const uint32_t* dma_ring            = nullptr;
+    uint32_t dma_ring_mask              = 0;
+    uint32_t dma_read_count             = 0;
+    uint32_t dma_overrun_count          = 0;
 
 
     //--------------------------------------------------
@@ -82,6 +103,8 @@ namespace pimoroni {
     static uint8_t pio_claimed_sms[NUM_PIOS];
     static void pio0_interrupt_callback();
     static void pio1_interrupt_callback();
+  private:
+    static void dispatch_interrupt(uint pio_idx);
 
 
     //--------------------------------------------------
@@ -113,13 +136,37 @@ namespace pimoroni {
     float get_revolutions_per_minute() const;
     float get_degrees_per_second() const;
     float get_radians_per_second() const;
+
+    // Fixed point version of get_frequency() that avoids software floating point
+    q16_t get_frequency_q16() const;
     
     void zero_count();
     Capture perform_capture();
 
+    // Also report every counted step, with its timestamp, to queue. Pass nullptr to stop.
+    // id identifies this encoder in the events; several encoders may share one queue.
+    void set_event_queue(EncoderEventQueue* queue, uint8_t id);
+
+    // Stop interrupting on every transition and have a DMA channel copy the PIO words
+    // to ring instead. ring holds 2^ring_bits words, with ring_bits <= MAX_DMA_RING_BITS,
+    // and must be aligned to its size in bytes. Call after init(), then call
+    // process_dma() periodically; count and speed only change when it runs.
+    bool init_dma(uint32_t* ring, uint8_t ring_bits);
+
+    // Decode the words the DMA channel has written since the last call, and return how
+    // many there were. If more than the ring holds arrived, the oldest are lost and
+    // counted by get_dma_overrun_count(). Each word carries its own last state, so
+    // decoding resumes correctly after an overrun.
+    uint32_t process_dma();
+    uint32_t get_dma_overrun_count() const;
+
+    // Decode words in the format pushed by the encoder PIO program, in order. This is
+    // what process_dma() and the interrupt handler use, and it can be fed recorded streams.
+    // Event timestamps are the time of this call, not of the transitions.
+    void process_words(const uint32_t* words, uint32_t num_words);
+
   private:
-    void microstep_up(int32_t time_since);
-    void microstep_down(int32_t time_since);
+    void process_received(uint32_t received);
     void check_for_transition();
   };
 
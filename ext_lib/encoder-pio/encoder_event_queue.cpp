@@ -0,0 +1,46 @@
+#include "encoder_event_queue.hpp"
+
+namespace pimoroni {
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  // CONSTRUCTORS
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  EncoderEventQueue::EncoderEventQueue(EncoderEvent* buffer, uint32_t capacity) :
+    buffer(buffer), mask(capacity - 1), head(0), tail(0), overflow_count(0) {
+    assert(buffer != nullptr);
+    assert(capacity != 0 && (capacity & (capacity - 1)) == 0);
+  }
+
+
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  // METHODS
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  uint32_t EncoderEventQueue::pop(EncoderEvent* dest, uint32_t max_events) {
+    uint32_t pos = tail.load(std::memory_order_relaxed);
+    uint32_t available = head.load(std::memory_order_acquire) - pos;
+    uint32_t num_events = (available < max_events) ? available : max_events;
+    for(uint32_t idx = 0; idx < num_events; idx++) {
+      dest[idx] = buffer[pos++ & mask];
+    }
+    tail.store(pos, std::memory_order_release);
+    return num_events;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  uint32_t EncoderEventQueue::get_size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  uint32_t EncoderEventQueue::get_capacity() const {
+    return mask + 1;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  uint32_t EncoderEventQueue::get_overflow_count() const {
+    return overflow_count.load(std::memory_order_relaxed);
+  }
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+}
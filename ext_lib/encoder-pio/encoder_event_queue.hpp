@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include "pico/stdlib.h"
+
+namespace pimoroni {
+
+  // One counted encoder step, as seen by the interrupt handler
+  struct EncoderEvent {
+    uint32_t timestamp_us;  // time_us_32() when the step was decoded
+    int8_t delta;           // +1 or -1
+    uint8_t encoder_id;     // the id given to Encoder::set_event_queue()
+  };
+
+  // Single producer, single consumer ring buffer of EncoderEvents.
+  //
+  // The producer is the encoder interrupt handler. All encoders that share a queue
+  // must have their interrupts handled on the same core at the same priority so that
+  // pushes never nest. The consumer may be the main loop on either core. Neither side
+  // disables interrupts; each index is written by one side only.
+  class EncoderEventQueue {
+    //--------------------------------------------------
+    // Variables
+    //--------------------------------------------------
+  private:
+    EncoderEvent* const buffer;
+    const uint32_t mask;
+    std::atomic<uint32_t> head;           // written by the producer only
+    std::atomic<uint32_t> tail;           // written by the consumer only
+    std::atomic<uint32_t> overflow_count; // written by the producer only
+
+
+    //--------------------------------------------------
+    // Constructors
+    //--------------------------------------------------
+  public:
+    // capacity must be a power of 2
+    EncoderEventQueue(EncoderEvent* buffer, uint32_t capacity);
+
+
+    //--------------------------------------------------
+    // Methods
+    //--------------------------------------------------
+  public:
+    // Called by the producer. Returns false and counts an overflow if the queue is full
+    inline bool push(const EncoderEvent& event) {
+      uint32_t pos = head.load(std::memory_order_relaxed);
+      if(pos - tail.load(std::memory_order_acquire) > mask) {
+        overflow_count.store(overflow_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+      }
+      buffer[pos & mask] = event;
+      head.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Called by the consumer. Copies up to max_events of the oldest events to dest
+    // and returns the number copied
+    uint32_t pop(EncoderEvent* dest, uint32_t max_events);
+
+    uint32_t get_size() const;
+    uint32_t get_capacity() const;
+    uint32_t get_overflow_count() const;
+  };
+
+}
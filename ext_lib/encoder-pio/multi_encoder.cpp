@@ -0,0 +1,259 @@
+#include <climits>
+#include <algorithm>
+#include "hardware/irq.h"
+#include "multi_encoder.hpp"
+#include "encoder.pio.h"
+#include "quadrature.hpp"
+
+namespace pimoroni {
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  // STATICS
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  MultiEncoder* MultiEncoder::pio_encoders[][NUM_PIO_STATE_MACHINES] = { { nullptr, nullptr, nullptr, nullptr }, { nullptr, nullptr, nullptr, nullptr } };
+  uint8_t MultiEncoder::pio_claimed_sms[] = { 0x0, 0x0 };
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  void MultiEncoder::pio0_interrupt_callback() {
+    dispatch_interrupt(0);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  void MultiEncoder::pio1_interrupt_callback() {
+    dispatch_interrupt(1);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  void MultiEncoder::dispatch_interrupt(uint pio_idx) {
+    PIO pio = (pio_idx == 0) ? pio0 : pio1;
+    uint32_t pending = (pio->ints1 >> PIO_IRQ1_INTS_SM0_RXNEMPTY_LSB) & ((1u << NUM_PIO_STATE_MACHINES) - 1);
+    for(uint8_t sm = 0; pending != 0; sm++, pending >>= 1) {
+      if((pending & 1u) && pio_encoders[pio_idx][sm] != nullptr) {
+        pio_encoders[pio_idx][sm]->check_for_transition();
+      }
+    }
+  }
+
+
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  // CONSTRUCTORS / DESTRUCTOR
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  MultiEncoder::MultiEncoder(PIO pio, uint8_t first_pin, uint8_t num_encoders,
+                             float counts_per_revolution, bool count_microsteps,
+                             uint16_t freq_divider) :
+    enc_pio(pio), first_pin(first_pin), num_encoders(num_encoders),
+    counts_per_revolution(counts_per_revolution), count_microsteps(count_microsteps),
+    freq_divider(freq_divider),
+    revs_per_count_q24((uint32_t)((float)(1 << 24) / std::max(counts_per_revolution, 1.0f))) {
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  MultiEncoder::~MultiEncoder() {
+    if(initialised) {
+      //Clean up our use of the SM and the program copy that only this SM runs
+      uint index = pio_get_index(enc_pio);
+      hw_clear_bits(&enc_pio->inte1, PIO_IRQ1_INTE_SM0_RXNEMPTY_BITS << enc_sm);
+      pio_sm_set_enabled(enc_pio, enc_sm, false);
+      pio_sm_unclaim(enc_pio, enc_sm);
+      pio_remove_program(enc_pio, &enc_program, enc_offset);
+      pio_encoders[index][enc_sm] = nullptr;
+      pio_claimed_sms[index] &= ~(1u << enc_sm);
+      if(pio_claimed_sms[index] == 0) {
+        if(index == 0)
+          irq_remove_handler(PIO0_IRQ_1, pio0_interrupt_callback);
+        else
+          irq_remove_handler(PIO1_IRQ_1, pio1_interrupt_callback);
+      }
+    }
+  }
+
+
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  // METHODS
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  bool MultiEncoder::init() {
+    const uint num_pins = 2 * num_encoders;
+
+    //Are the pins we want to use actually valid?
+    if(!initialised && (num_encoders > 0) && (num_encoders <= MAX_ENCODERS) &&
+       (first_pin + num_pins <= NUM_BANK0_GPIOS)) {
+
+      //Each MultiEncoder loads its own copy of the program, patched to read its number of pins
+      encoder_multi_program_patch(enc_instructions, num_pins);
+      enc_program = encoder_multi_program;
+      enc_program.instructions = enc_instructions;
+      if(!pio_can_add_program(enc_pio, &enc_program))
+        return false;
+
+      int sm = pio_claim_unused_sm(enc_pio, false);
+      if(sm < 0)
+        return false;
+      enc_sm = (uint)sm;
+      enc_offset = pio_add_program(enc_pio, &enc_program);
+      encoder_multi_program_init(enc_pio, enc_sm, enc_offset, first_pin, num_pins, freq_divider);
+
+      //Keep a record of this encoder for the interrupt callback
+      uint pio_idx = pio_get_index(enc_pio);
+      //Other drivers may also use IRQ_1 of this PIO, so the handler is a shared one
+      if(pio_claimed_sms[pio_idx] == 0) {
+        if(pio_idx == 0) {
+          irq_add_shared_handler(PIO0_IRQ_1, pio0_interrupt_callback, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+          irq_set_enabled(PIO0_IRQ_1, true);
+        }
+        else {
+          irq_add_shared_handler(PIO1_IRQ_1, pio1_interrupt_callback, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+          irq_set_enabled(PIO1_IRQ_1, true);
+        }
+      }
+      pio_encoders[pio_idx][enc_sm] = this;
+      pio_claimed_sms[pio_idx] |= 1u << enc_sm;
+
+      //Read the current state of the encoder pins and start the PIO program on the SM
+      states = (gpio_get_all() >> first_pin) & ((1u << num_pins) - 1);
+      uint32_t now_us = time_us_32();
+      for(uint8_t enc = 0; enc < num_encoders; enc++) {
+        channels[enc].last_step_us = now_us;
+      }
+      hw_set_bits(&enc_pio->inte1, PIO_IRQ1_INTE_SM0_RXNEMPTY_BITS << enc_sm);
+      encoder_multi_program_start(enc_pio, enc_sm, num_pins);
+
+      initialised = true;
+    }
+    return initialised;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  uint8_t MultiEncoder::get_num_encoders() const {
+    return num_encoders;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  bool MultiEncoder::get_state_a(uint8_t enc) const {
+    return (states >> (2 * enc)) & 1u;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  bool MultiEncoder::get_state_b(uint8_t enc) const {
+    return (states >> (2 * enc + 1)) & 1u;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  int32_t MultiEncoder::get_count(uint8_t enc) const {
+    return channels[enc].count.load(std::memory_order_relaxed) - channels[enc].count_offset;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  float MultiEncoder::get_revolutions(uint8_t enc) const {
+    return (float)get_count(enc) / counts_per_revolution;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  float MultiEncoder::get_frequency(uint8_t enc) const {
+    return (float)TIME_UNITS_PER_SECOND / (float)channels[enc].time_since.load(std::memory_order_relaxed);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  q16_t MultiEncoder::get_frequency_q16(uint8_t enc) const {
+    int32_t time = channels[enc].time_since.load(std::memory_order_relaxed);
+    if(time == 0)
+      return INT32_MAX;
+    return (time > 0) ? q16::divide((int64_t)TIME_UNITS_PER_SECOND << 16, time)
+                      : q16::divide(-((int64_t)TIME_UNITS_PER_SECOND << 16), -time);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  void MultiEncoder::zero_count(uint8_t enc) {
+    channels[enc].count_offset = channels[enc].count.load(std::memory_order_relaxed);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  Capture MultiEncoder::perform_capture(uint8_t enc) {
+    Channel& channel = channels[enc];
+
+    //Capture the current values, starting again if the interrupt handler changed them part way through
+    int32_t captured_count;
+    uint64_t captured_total_time;
+    uint32_t start;
+    do {
+      start = seqlock.read_begin();
+      captured_count = channel.count.load(std::memory_order_relaxed);
+      captured_total_time = ((uint64_t)channel.total_time_hi.load(std::memory_order_relaxed) << 32) |
+                            channel.total_time_lo.load(std::memory_order_relaxed);
+    } while(seqlock.read_retry(start));
+
+    //Determine the change in counts and the time taken by them since the last capture was performed
+    int32_t count_change = captured_count - channel.last_captured_count;
+    channel.last_captured_count = captured_count;
+    uint64_t time_change = captured_total_time - channel.last_captured_total_time;
+    channel.last_captured_total_time = captured_total_time;
+    int32_t captured_cumulative_time = (time_change > (uint64_t)INT32_MAX) ? INT32_MAX : (int32_t)time_change;
+
+    return Capture(captured_count, count_change, captured_cumulative_time, TIME_UNITS_PER_SECOND,
+                   counts_per_revolution, revs_per_count_q24);
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  void MultiEncoder::set_event_queue(EncoderEventQueue* queue, uint8_t first_id) {
+    first_event_id = first_id;
+    event_queue = queue;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  void MultiEncoder::process_received(uint32_t received, uint32_t now_us) {
+    uint32_t last = states;
+    states = received;
+
+    //Only decode the encoders whose pins changed
+    uint32_t changed = received ^ last;
+    for(uint8_t enc = 0; changed != 0; enc++, changed >>= 2, received >>= 2, last >>= 2) {
+      if((changed & 0b11) == 0)
+        continue;
+
+      //The PIO word has A in the lower bit of each pair, but the table wants A in the upper bit
+      uint8_t index = ((received & 0b01) << 3) | ((received & 0b10) << 1) |
+                      ((last & 0b01) << 1) | ((last & 0b10) >> 1);
+      const quadrature::Transition& transition = quadrature::TRANSITIONS[index];
+      Channel& channel = channels[enc];
+
+      int32_t step = transition.step;
+      if(!count_microsteps) {
+        //Only count a detent if it finishes in the direction it started
+        if(!transition.detent_end || channel.last_travel_dir != step)
+          step = 0;
+      }
+
+      if(transition.dir != quadrature::KEEP_DIR)
+        channel.last_travel_dir = (Direction)transition.dir;
+
+      if(step != 0) {
+        //The time since the last counted step covers all the microsteps in between
+        uint32_t elapsed = std::min(now_us - channel.last_step_us, (uint32_t)INT32_MAX);
+        channel.last_step_us = now_us;
+
+        uint32_t time_lo = channel.total_time_lo.load(std::memory_order_relaxed);
+        uint32_t new_time_lo = time_lo + elapsed;
+        seqlock.write_begin();
+        channel.count.store(channel.count.load(std::memory_order_relaxed) + step, std::memory_order_relaxed);
+        channel.time_since.store((step > 0) ? (int32_t)elapsed : -(int32_t)elapsed, std::memory_order_relaxed);
+        channel.total_time_lo.store(new_time_lo, std::memory_order_relaxed);
+        if(new_time_lo < time_lo)
+          channel.total_time_hi.store(channel.total_time_hi.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        seqlock.write_end();
+
+        if(event_queue != nullptr)
+          event_queue->push(EncoderEvent{now_us, (int8_t)step, (uint8_t)(first_event_id + enc)});
+      }
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  void MultiEncoder::check_for_transition() {
+    while(enc_pio->ints1 & (PIO_IRQ1_INTS_SM0_RXNEMPTY_BITS << enc_sm)) {
+      process_received(pio_sm_get(enc_pio, enc_sm), time_us_32());
+    }
+  }
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////////////////////////////////////////////////////////////////////
+}
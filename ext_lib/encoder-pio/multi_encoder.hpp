@@ -0,0 +1,145 @@
+#pragma once
+
+#include "hardware/pio.h"
+#include "capture.hpp"
+#include "encoder_event_queue.hpp"
+#include "seqlock.hpp"
+
+namespace pimoroni {
+
+  // Reads up to MAX_ENCODERS quadrature encoders with a single PIO state machine.
+  //
+  // The encoders are wired to 2 * num_encoders consecutive pins starting at first_pin,
+  // in the order A0, B0, A1, B1, ... The PIO program pushes the state of all the pins
+  // whenever any of them changes, and the interrupt handler splits that word into
+  // per-encoder transitions. Times are measured with the microsecond timer, so
+  // captures from a MultiEncoder report frequencies in the same units as an Encoder.
+  //
+  // MultiEncoder adds a shared handler for the IRQ_1 line of its PIO, so it can share a
+  // PIO with Encoder, which uses IRQ_0, and with other drivers that share IRQ_1.
+  class MultiEncoder {
+    //--------------------------------------------------
+    // Constants
+    //--------------------------------------------------
+  public:
+    static constexpr float DEFAULT_COUNTS_PER_REV   = 24;
+    static const uint16_t DEFAULT_COUNT_MICROSTEPS  = false;
+    static const uint16_t DEFAULT_FREQ_DIVIDER      = 1;
+    static const uint8_t MAX_ENCODERS               = NUM_BANK0_GPIOS / 2;
+
+  private:
+    static const uint32_t TIME_UNITS_PER_SECOND = 1000000;
+
+
+    //--------------------------------------------------
+    // Enums
+    //--------------------------------------------------
+  private:
+    enum Direction {
+      NO_DIR        = 0,
+      CLOCKWISE     = 1,
+      COUNTERCLOCK  = -1,
+    };
+
+
+    //--------------------------------------------------
+    // Substructures
+    //--------------------------------------------------
+  private:
+    struct Channel {
+      // Written by the interrupt handler inside the MultiEncoder's seqlock
+      std::atomic<int32_t> count{0};
+      std::atomic<int32_t> time_since{0};
+      std::atomic<uint32_t> total_time_lo{0};
+      std::atomic<uint32_t> total_time_hi{0};
+
+      volatile Direction last_travel_dir  = NO_DIR;
+      uint32_t last_step_us               = 0;
+
+      int32_t count_offset                = 0;
+      int32_t last_captured_count         = 0;
+      uint64_t last_captured_total_time   = 0;
+    };
+
+
+    //--------------------------------------------------
+    // Variables
+    //--------------------------------------------------
+  private:
+    const PIO enc_pio           = pio0;
+    const uint8_t first_pin     = 0;
+    const uint8_t num_encoders  = 0;
+
+    const float counts_per_revolution   = DEFAULT_COUNTS_PER_REV;
+    const bool count_microsteps         = DEFAULT_COUNT_MICROSTEPS;
+    const uint16_t freq_divider         = DEFAULT_FREQ_DIVIDER;
+    const uint32_t revs_per_count_q24   = 0;
+
+    //--------------------------------------------------
+
+    uint enc_sm         = 0;
+    uint enc_offset     = 0;
+    bool initialised    = false;
+    pio_program_t enc_program;
+    uint16_t enc_instructions[PIO_INSTRUCTION_COUNT];
+
+    volatile uint32_t states            = 0;
+    SeqLock seqlock;
+    Channel channels[MAX_ENCODERS];
+
+    EncoderEventQueue* event_queue      = nullptr;
+    uint8_t first_event_id              = 0;
+
+
+    //--------------------------------------------------
+    // Statics
+    //--------------------------------------------------
+  public:
+    static MultiEncoder* pio_encoders[NUM_PIOS][NUM_PIO_STATE_MACHINES];
+    static uint8_t pio_claimed_sms[NUM_PIOS];
+    static void pio0_interrupt_callback();
+    static void pio1_interrupt_callback();
+  private:
+    static void dispatch_interrupt(uint pio_idx);
+
+
+    //--------------------------------------------------
+    // Constructors/Destructor
+    //--------------------------------------------------
+  public:
+    MultiEncoder(PIO pio, uint8_t first_pin, uint8_t num_encoders,
+                 float counts_per_revolution = DEFAULT_COUNTS_PER_REV, bool count_microsteps = DEFAULT_COUNT_MICROSTEPS,
+                 uint16_t freq_divider = DEFAULT_FREQ_DIVIDER);
+    ~MultiEncoder();
+
+
+    //--------------------------------------------------
+    // Methods
+    //--------------------------------------------------
+  public:
+    bool init();
+
+    uint8_t get_num_encoders() const;
+
+    // The encoder index enc is 0 for the encoder on first_pin and first_pin + 1
+    bool get_state_a(uint8_t enc) const;
+    bool get_state_b(uint8_t enc) const;
+    int32_t get_count(uint8_t enc) const;
+    float get_revolutions(uint8_t enc) const;
+
+    float get_frequency(uint8_t enc) const;
+    q16_t get_frequency_q16(uint8_t enc) const;
+
+    void zero_count(uint8_t enc);
+    Capture perform_capture(uint8_t enc);
+
+    // Also report every counted step, with its timestamp, to queue. Pass nullptr to stop.
+    // The events of encoder enc have the id first_id + enc.
+    void set_event_queue(EncoderEventQueue* queue, uint8_t first_id);
+
+  private:
+    void process_received(uint32_t received, uint32_t now_us);
+    void check_for_transition();
+  };
+
+}
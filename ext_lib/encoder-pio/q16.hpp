@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+
+namespace pimoroni {
+
+  // Signed Q16.16 fixed point: 16 integer bits and 16 fraction bits, range -32768 to 32767.99998
+  typedef int32_t q16_t;
+
+  namespace q16 {
+
+    //--------------------------------------------------
+    // Constants
+    //--------------------------------------------------
+    static constexpr q16_t ONE    = 1 << 16;
+    static constexpr q16_t TWO_PI = 411775;   // round(2 * pi * 65536)
+
+
+    //--------------------------------------------------
+    // Helpers
+    //--------------------------------------------------
+    // Clamp a wider intermediate result to the q16_t range
+    inline q16_t saturate(int64_t value) {
+      if(value > INT32_MAX)
+        return INT32_MAX;
+      if(value < INT32_MIN)
+        return INT32_MIN;
+      return (q16_t)value;
+    }
+
+    inline constexpr q16_t from_int(int32_t value) {
+      return (q16_t)((uint32_t)value << 16);
+    }
+
+    inline q16_t from_float(float value) {
+      return saturate((int64_t)(value * (float)ONE));
+    }
+
+    inline float to_float(q16_t value) {
+      return (float)value * (1.0f / (float)ONE);
+    }
+
+    // Integer part, rounded toward negative infinity
+    inline int32_t to_int(q16_t value) {
+      return value >> 16;
+    }
+
+    inline q16_t mul(q16_t a, q16_t b) {
+      return saturate(((int64_t)a * b) >> 16);
+    }
+
+    // Divide a 64-bit value whose quotient fits in 32 bits by a 32-bit value, using
+    // two 32-bit divides. The M0+ has no 64-bit divide, so the compiler calls a library
+    // routine for one, while the RP2040 does a 32-bit divide in its hardware divider.
+    // This is the long division with 16-bit digits from Hacker's Delight (divlu).
+    inline uint32_t divide_u64_u32(uint64_t dividend, uint32_t divisor) {
+      const uint32_t b = 1u << 16;
+      //Normalise so the divisor has its top bit set, then each 16-bit digit estimate is off by at most 2
+      int s = __builtin_clz(divisor);
+      uint32_t v = divisor << s;
+      uint32_t vn1 = v >> 16;
+      uint32_t vn0 = v & 0xffff;
+      uint32_t un32 = (uint32_t)((dividend << s) >> 32);
+      uint32_t un10 = (uint32_t)(dividend << s);
+      uint32_t un1 = un10 >> 16;
+      uint32_t un0 = un10 & 0xffff;
+
+      uint32_t q1 = un32 / vn1;
+      uint32_t rhat = un32 - q1 * vn1;
+      while(q1 >= b || q1 * vn0 > ((rhat << 16) | un1)) {
+        q1--;
+        rhat += vn1;
+        if(rhat >= b)
+          break;
+      }
+      uint32_t un21 = (un32 << 16) + un1 - q1 * v;
+
+      uint32_t q0 = un21 / vn1;
+      rhat = un21 - q0 * vn1;
+      while(q0 >= b || q0 * vn0 > ((rhat << 16) | un0)) {
+        q0--;
+        rhat += vn1;
+        if(rhat >= b)
+          break;
+      }
+      return (q1 << 16) | q0;
+    }
+
+    // saturate(dividend / divisor), rounded toward zero, for a divisor greater than 0.
+    // It gives the same result as the 64-bit division without doing one.
+    inline q16_t divide(int64_t dividend, uint32_t divisor) {
+      uint64_t magnitude = (dividend < 0) ? -(uint64_t)dividend : (uint64_t)dividend;
+      //A quotient of 2^32 or more is outside the q16_t range either way
+      if((magnitude >> 32) >= divisor)
+        return (dividend < 0) ? INT32_MIN : INT32_MAX;
+      uint32_t quotient = divide_u64_u32(magnitude, divisor);
+      return saturate((dividend < 0) ? -(int64_t)quotient : (int64_t)quotient);
+    }
+
+  }
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <climits>
+
+namespace pimoroni {
+
+  namespace quadrature {
+
+    //--------------------------------------------------
+    // Constants
+    //--------------------------------------------------
+    // Value of Transition::dir that leaves the direction of travel unchanged.
+    // Other values are the new direction: 1 clockwise, -1 counter-clockwise, 0 none
+    static constexpr int8_t KEEP_DIR = 2;
+
+
+    //--------------------------------------------------
+    // Transition table
+    //--------------------------------------------------
+    // The result of moving from one pair of A/B pin states to another
+    struct Transition {
+      int8_t step;      // microstep count change: -1, 0 or +1
+      int8_t dir;       // new direction of travel, or KEEP_DIR
+      bool detent_end;  // true if this transition finishes a full step in the direction of step
+    };
+
+    // Indexed by the 4 state bits pushed by the encoder PIO program:
+    // (A << 3) | (B << 2) | (A_last << 1) | B_last
+    //
+    // Microstep order clockwise is 0b00 -> 0b10 -> 0b11 -> 0b01 -> 0b00,
+    // where the upper bit is A. A clockwise detent starts with 0b11 -> 0b01
+    // and ends with 0b10 -> 0b11. Transitions that skip a state are ignored.
+    inline constexpr Transition TRANSITIONS[16] = {
+      {  0, KEEP_DIR, false },  // 00 -> 00
+      { +1, KEEP_DIR, false },  // 01 -> 00
+      { -1, KEEP_DIR, false },  // 10 -> 00
+      {  0, KEEP_DIR, false },  // 11 -> 00 (skipped a state)
+      { -1, KEEP_DIR, false },  // 00 -> 01
+      {  0, KEEP_DIR, false },  // 01 -> 01
+      {  0, KEEP_DIR, false },  // 10 -> 01 (skipped a state)
+      { +1, 1,        false },  // 11 -> 01 started turning clockwise
+      { +1, KEEP_DIR, false },  // 00 -> 10
+      {  0, KEEP_DIR, false },  // 01 -> 10 (skipped a state)
+      {  0, KEEP_DIR, false },  // 10 -> 10
+      { -1, -1,       false },  // 11 -> 10 started turning counter-clockwise
+      {  0, KEEP_DIR, false },  // 00 -> 11 (skipped a state)
+      { -1, 0,        true  },  // 01 -> 11 finished turning counter-clockwise
+      { +1, 0,        true  },  // 10 -> 11 finished turning clockwise
+      {  0, KEEP_DIR, false },  // 11 -> 11
+    };
+
+
+    //--------------------------------------------------
+    // Helpers
+    //--------------------------------------------------
+    // Add two non-negative times, clamping the result to INT32_MAX
+    inline int32_t saturating_add(int32_t a, int32_t b) {
+      uint32_t sum = (uint32_t)a + (uint32_t)b;
+      return (sum > (uint32_t)INT32_MAX) ? INT32_MAX : (int32_t)sum;
+    }
+
+  }
+
+}
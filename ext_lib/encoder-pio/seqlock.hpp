@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+
+namespace pimoroni {
+
+  // Sequence lock for data with a single writer that must never wait, such as an
+  // interrupt handler, and readers on either core.
+  //
+  // The writer wraps its updates in write_begin()/write_end(). A reader takes a copy
+  // of the data between read_begin() and read_retry(), and starts again if read_retry()
+  // returns true because a write overlapped the copy. The protected data must be
+  // std::atomic and accessed with std::memory_order_relaxed. Only atomic loads and
+  // stores are used, which the Cortex-M0+ supports without disabling interrupts.
+  class SeqLock {
+    //--------------------------------------------------
+    // Variables
+    //--------------------------------------------------
+  private:
+    std::atomic<uint32_t> sequence{0};  // odd while a write is in progress
+
+
+    //--------------------------------------------------
+    // Methods
+    //--------------------------------------------------
+  public:
+    inline void write_begin() {
+      sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    inline void write_end() {
+      sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // A reader interrupted by the writer on the same core never sees a write in progress,
+    // so this only waits for a writer on the other core
+    inline uint32_t read_begin() const {
+      uint32_t start;
+      while((start = sequence.load(std::memory_order_acquire)) & 1u) {
+      }
+      return start;
+    }
+
+    inline bool read_retry(uint32_t start) const {
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return sequence.load(std::memory_order_relaxed) != start;
+    }
+  };
+
+}
@@ -30,16 +30,23 @@
 
 rppicomidi::Button_led::Button_led(Mono_graphics& screen_, uint8_t x_, uint8_t y_, uint8_t width_, uint8_t height_,
         const char* text_, const MonoMonoFont& font_,  bool is_on_) :
-    screen(screen_), x{x_}, y{y_}, width{width_}, height{height_}, text{text_}, font{font_}, is_on{is_on_}
+    Widget{screen_, x_, y_, width_, height_}, text{text_}, font{font_}, is_on{is_on_}
 {
     text_len = strlen(text);
     x_centered_text = x + width/2 - (text_len * font.width)/2;
-    set_state(is_on);
+    draw();
 }
 
 void rppicomidi::Button_led::set_state(bool is_on_)
 {
-    is_on = is_on;
+    if (is_on_ != is_on) {
+        is_on = is_on_;
+        invalidate();
+    }
+}
+
+void rppicomidi::Button_led::draw()
+{
     Pixel_state textbg = Pixel_state::PIXEL_ZERO;
     Pixel_state textfg = is_on ? Pixel_state::PIXEL_ONE:Pixel_state::PIXEL_ZERO;
     screen.draw_rectangle(x, y, width, height, textfg, textbg);
@@ -27,10 +27,10 @@
  */
 
 #pragma once
-#include "mono_graphics_lib.h"
+#include "widget.h"
 #include <cstring>
 namespace rppicomidi {
-class Button_led {
+class Button_led : public Widget {
 public:
     /**
      * @brief Construct a new Button_led object
@@ -53,12 +53,12 @@ public:
      * @param is_on_ draw the button to reflect the text
      */
     void set_state(bool is_on_);
+
+    bool get_state() const { return is_on; }
+
+    void paint() override { draw(); }
+    void draw() override;
 protected:
-    Mono_graphics& screen;
-    uint8_t x;
-    uint8_t y;
-    uint8_t width;
-    uint8_t height;
     const char* text;
     const MonoMonoFont& font;
     bool is_on;
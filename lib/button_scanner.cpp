@@ -0,0 +1,195 @@
+/**
+ * @file button_scanner.cpp
+ * @brief This class reads a set of push buttons on consecutive GPIO pins
+ * using a PIO state machine for debouncing and reports press, release and
+ * long-press events.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdlib>
+#include "button_scanner.h"
+#include "hardware/irq.h"
+#include "button_scan.pio.h"
+
+rppicomidi::Button_scanner* rppicomidi::Button_scanner::scanners[NUM_PIOS][NUM_PIO_STATE_MACHINES] = {};
+
+rppicomidi::Button_scanner::Button_scanner(PIO pio_, uint8_t first_pin_, uint8_t num_buttons_, uint32_t debounce_us_,
+        uint32_t long_press_us_) :
+    pio{pio_}, first_pin{first_pin_}, num_buttons{num_buttons_}, debounce_us{debounce_us_}, long_press_us{long_press_us_},
+    sm{0}, offset{0}, initialized{false}, cb{nullptr}, context{nullptr}, head{0}, tail{0}, num_dropped{0},
+    pressed{0}, long_press_pending{0}
+{
+    assert(num_buttons > 0 && num_buttons <= max_buttons);
+    press_time_us = reinterpret_cast<uint32_t*>(malloc(num_buttons * sizeof(uint32_t)));
+    assert(press_time_us);
+}
+
+rppicomidi::Button_scanner::~Button_scanner()
+{
+    if (initialized) {
+        uint pio_idx = pio_get_index(pio);
+        hw_clear_bits(&pio->inte1, PIO_IRQ1_INTE_SM0_RXNEMPTY_BITS << sm);
+        pio_sm_set_enabled(pio, sm, false);
+        pio_sm_unclaim(pio, sm);
+        pio_remove_program(pio, &program, offset);
+        scanners[pio_idx][sm] = nullptr;
+        bool last_on_pio = true;
+        for (auto scanner: scanners[pio_idx]) {
+            if (scanner != nullptr)
+                last_on_pio = false;
+        }
+        if (last_on_pio)
+            irq_remove_handler(pio_idx == 0 ? PIO0_IRQ_1 : PIO1_IRQ_1, pio_idx == 0 ? pio0_irq_handler : pio1_irq_handler);
+    }
+    free(press_time_us);
+}
+
+bool rppicomidi::Button_scanner::init()
+{
+    if (initialized || first_pin + num_buttons > NUM_BANK0_GPIOS)
+        return initialized;
+
+    // Each Button_scanner loads its own copy of the program, patched to read its number of pins
+    button_scan_program_patch(instructions, num_buttons);
+    program = button_scan_program;
+    program.instructions = instructions;
+    if (!pio_can_add_program(pio, &program))
+        return false;
+    int claimed_sm = pio_claim_unused_sm(pio, false);
+    if (claimed_sm < 0)
+        return false;
+    sm = static_cast<uint>(claimed_sm);
+    offset = pio_add_program(pio, &program);
+    button_scan_program_init(pio, sm, offset, first_pin, num_buttons, button_scan_program_get_divider(debounce_us));
+
+    // The PIO IRQ_1 line may be shared with other drivers, so add a shared handler for this PIO
+    uint pio_idx = pio_get_index(pio);
+    bool first_on_pio = true;
+    for (auto scanner: scanners[pio_idx]) {
+        if (scanner != nullptr)
+            first_on_pio = false;
+    }
+    scanners[pio_idx][sm] = this;
+    if (first_on_pio) {
+        uint irq_num = pio_idx == 0 ? PIO0_IRQ_1 : PIO1_IRQ_1;
+        irq_add_shared_handler(irq_num, pio_idx == 0 ? pio0_irq_handler : pio1_irq_handler,
+            PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(irq_num, true);
+    }
+
+    // Queue the starting pin states so that the first task() call reports the
+    // buttons that are already down. The interrupt is not enabled yet.
+    queue[0].timestamp_us = time_us_32();
+    queue[0].pins = gpio_get_all() >> first_pin;
+    head.store(1, std::memory_order_release);
+    hw_set_bits(&pio->inte1, PIO_IRQ1_INTE_SM0_RXNEMPTY_BITS << sm);
+    button_scan_program_start(pio, sm, num_buttons);
+    initialized = true;
+    return true;
+}
+
+void rppicomidi::Button_scanner::pio0_irq_handler()
+{
+    dispatch_irq(0);
+}
+
+void rppicomidi::Button_scanner::pio1_irq_handler()
+{
+    dispatch_irq(1);
+}
+
+void rppicomidi::Button_scanner::dispatch_irq(uint pio_idx)
+{
+    PIO pio_instance = pio_idx == 0 ? pio0 : pio1;
+    uint32_t pending = (pio_instance->ints1 >> PIO_IRQ1_INTS_SM0_RXNEMPTY_LSB) & ((1u << NUM_PIO_STATE_MACHINES) - 1);
+    for (uint8_t idx = 0; pending != 0; idx++, pending >>= 1) {
+        if ((pending & 1u) && scanners[pio_idx][idx] != nullptr)
+            scanners[pio_idx][idx]->read_fifo();
+    }
+}
+
+void rppicomidi::Button_scanner::read_fifo()
+{
+    uint32_t now = time_us_32();
+    while (!pio_sm_is_rx_fifo_empty(pio, sm)) {
+        uint32_t pins = pio_sm_get(pio, sm);
+        uint32_t pos = head.load(std::memory_order_relaxed);
+        if (pos - tail.load(std::memory_order_acquire) >= queue_size) {
+            // Every change holds all the pin states, so the next one that fits puts things right
+            num_dropped.store(num_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            continue;
+        }
+        queue[pos & (queue_size - 1)] = Change{now, pins};
+        head.store(pos + 1, std::memory_order_release);
+    }
+}
+
+void rppicomidi::Button_scanner::task()
+{
+    uint32_t pos = tail.load(std::memory_order_relaxed);
+    uint32_t end = head.load(std::memory_order_acquire);
+    while (pos != end) {
+        const Change& change = queue[pos & (queue_size - 1)];
+        decode(change.pins, change.timestamp_us);
+        ++pos;
+    }
+    tail.store(pos, std::memory_order_release);
+
+    if (long_press_pending != 0) {
+        uint32_t now = time_us_32();
+        uint32_t pending = long_press_pending;
+        for (uint8_t button = 0; pending != 0; button++, pending >>= 1) {
+            if ((pending & 1u) && now - press_time_us[button] >= long_press_us) {
+                long_press_pending &= ~(1u << button);
+                if (cb)
+                    cb(button, Event::LONG_PRESS, press_time_us[button] + long_press_us, context);
+            }
+        }
+    }
+}
+
+void rppicomidi::Button_scanner::decode(uint32_t pins, uint32_t timestamp_us)
+{
+    uint32_t now_pressed = ~pins & ((1u << num_buttons) - 1);
+    uint32_t changed = now_pressed ^ pressed;
+    pressed = now_pressed;
+    for (uint8_t button = 0; changed != 0; button++, changed >>= 1, now_pressed >>= 1) {
+        if ((changed & 1u) == 0)
+            continue;
+        uint32_t bit = 1u << button;
+        if (now_pressed & 1u) {
+            press_time_us[button] = timestamp_us;
+            long_press_pending |= bit;
+            if (cb)
+                cb(button, Event::PRESS, timestamp_us, context);
+        }
+        else {
+            // If task() ran late, the long press may have happened before this release
+            if ((long_press_pending & bit) && timestamp_us - press_time_us[button] >= long_press_us && cb)
+                cb(button, Event::LONG_PRESS, press_time_us[button] + long_press_us, context);
+            long_press_pending &= ~bit;
+            if (cb)
+                cb(button, Event::RELEASE, timestamp_us, context);
+        }
+    }
+}
@@ -0,0 +1,147 @@
+/**
+ * @file button_scanner.h
+ * @brief This class reads a set of push buttons on consecutive GPIO pins
+ * using a PIO state machine for debouncing and reports press, release and
+ * long-press events.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The PIO program pushes the state of all the button pins only when one
+ * of them changes, and it ignores the pins for the debounce time after
+ * each change. The PIO interrupt handler time stamps each change and
+ * stores it in a small queue. The main loop calls task(), which decodes
+ * the queued changes into events and calls the event callback. Nothing
+ * polls the button pins.
+ *
+ * The buttons are active low; they short the pins to ground, and the
+ * pins have their pull-ups enabled.
+ */
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+namespace rppicomidi {
+class Button_scanner {
+public:
+    enum class Event : uint8_t {
+        PRESS,          //!< the button went down
+        RELEASE,        //!< the button went up
+        LONG_PRESS,     //!< the button has been down for the long press time; RELEASE follows later
+    };
+
+    /**
+     * @brief the event callback
+     *
+     * @param button the button number; 0 is the button on first_pin
+     * @param event what happened
+     * @param timestamp_us time_us_32() when the event happened
+     * @param context the context pointer passed to set_callback()
+     */
+    typedef void (*Event_cb)(uint8_t button, Event event, uint32_t timestamp_us, void* context);
+
+    static const uint8_t max_buttons = 30;
+
+    /**
+     * @brief Construct a new Button_scanner object
+     *
+     * @param pio_ the PIO to run the scanner program on
+     * @param first_pin_ the GPIO number of button 0
+     * @param num_buttons_ the number of buttons on consecutive GPIO pins starting at first_pin_
+     * @param debounce_us_ the time after a change when further changes are ignored
+     * @param long_press_us_ how long a button has to be held down to report LONG_PRESS
+     */
+    Button_scanner(PIO pio_, uint8_t first_pin_, uint8_t num_buttons_, uint32_t debounce_us_=5000,
+        uint32_t long_press_us_=500000);
+    ~Button_scanner();
+
+    /**
+     * @brief load the PIO program, claim a state machine and start scanning
+     *
+     * @return true if successful, false if the pins are invalid or
+     * the PIO has no room for the program
+     */
+    bool init();
+
+    /**
+     * @brief Set the function to call for every button event
+     */
+    void set_callback(Event_cb cb_, void* context_) { cb = cb_; context = context_; }
+
+    /**
+     * @brief decode the queued button changes and report the events.
+     * Also report long presses that have timed out.
+     *
+     * @note Call this from the main loop. How often it is called
+     * sets the event latency, but not the event timestamps.
+     */
+    void task();
+
+    /**
+     * @brief return true if the button was down when task() last ran
+     */
+    bool is_pressed(uint8_t button) const { return (pressed >> button) & 1u; }
+
+    /**
+     * @brief Get the number of pin changes lost because task() was not called
+     * often enough
+     */
+    uint32_t get_num_dropped() const { return num_dropped.load(std::memory_order_relaxed); }
+private:
+    struct Change {
+        uint32_t timestamp_us;
+        uint32_t pins;          // 1 bits are released buttons
+    };
+    static const uint8_t queue_size = 16;   // must be a power of 2
+
+    PIO pio;
+    uint8_t first_pin;
+    uint8_t num_buttons;
+    uint32_t debounce_us;
+    uint32_t long_press_us;
+    uint sm;
+    uint offset;
+    bool initialized;
+    pio_program_t program;
+    uint16_t instructions[PIO_INSTRUCTION_COUNT];
+    Event_cb cb;
+    void* context;
+
+    Change queue[queue_size];
+    std::atomic<uint32_t> head;         // written by the interrupt handler only
+    std::atomic<uint32_t> tail;         // written by task() only
+    std::atomic<uint32_t> num_dropped;  // written by the interrupt handler only
+
+    uint32_t pressed;                   // a 1 bit is a button that is down
+    uint32_t long_press_pending;        // a 1 bit is a button that is down and has not reported LONG_PRESS
+    uint32_t* press_time_us;            // the timestamp of the last PRESS of each button
+
+    static Button_scanner* scanners[NUM_PIOS][NUM_PIO_STATE_MACHINES];
+    static void pio0_irq_handler();
+    static void pio1_irq_handler();
+    static void dispatch_irq(uint pio_idx);
+
+    void read_fifo();
+    void decode(uint32_t pins, uint32_t timestamp_us);
+};
+}
@@ -0,0 +1,225 @@
+/**
+ * @file draw_trace.cpp
+ * @brief This class implements a compact binary recorder for the stream of
+ * Mono_graphics drawing calls and a replay function for it.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdlib>
+#include "pico/time.h"
+#include "draw_trace.h"
+#include "mono_graphics_lib.h"
+
+rppicomidi::Draw_trace::Draw_trace(uint8_t log2_nbytes) :
+    mask{(1u << log2_nbytes) - 1}, head{0}, tail{0}, num_dropped{0}, last_time_us{time_us_32()},
+    enabled{true}, num_fonts{0}
+{
+    assert(log2_nbytes >= 6 && log2_nbytes < 32);
+    buffer = reinterpret_cast<uint8_t*>(malloc(mask + 1));
+    assert(buffer);
+}
+
+rppicomidi::Draw_trace::~Draw_trace()
+{
+    free(buffer);
+}
+
+uint8_t rppicomidi::Draw_trace::add_font(const MonoMonoFont& font)
+{
+    uint8_t idx = get_font_idx(font);
+    if (idx == unknown_font && num_fonts < max_fonts) {
+        idx = num_fonts++;
+        fonts[idx] = &font;
+    }
+    return idx;
+}
+
+void rppicomidi::Draw_trace::record_string(const MonoMonoFont& font, uint8_t x, uint8_t y, const char* str, size_t len,
+        Pixel_state fg, Pixel_state bg)
+{
+    do {
+        uint8_t nchars = len > UINT8_MAX ? UINT8_MAX : static_cast<uint8_t>(len);
+        const uint8_t args[] = {get_font_idx(font), x, y, pack_colors(fg, bg), nchars};
+        write_record(Op::STRING, args, sizeof(args), reinterpret_cast<const uint8_t*>(str), nchars);
+        x += nchars * font.width;
+        str += nchars;
+        len -= nchars;
+    } while (len > 0);
+}
+
+void rppicomidi::Draw_trace::record_sprite(uint8_t x, uint8_t y, const Mono_sprite& sprite)
+{
+    uint16_t nbytes = sprite.width * ((sprite.height + 7) / 8);
+    const uint8_t args[] = {x, y, sprite.width, sprite.height, static_cast<uint8_t>(sprite.mask != nullptr)};
+    write_record(Op::SPRITE, args, sizeof(args), sprite.bits, nbytes, sprite.mask, sprite.mask ? nbytes : 0);
+}
+
+void rppicomidi::Draw_trace::write_record(Op op, const uint8_t* args, uint8_t nargs, const uint8_t* extra, uint16_t nextra,
+        const uint8_t* extra2, uint16_t nextra2)
+{
+    if (!enabled)
+        return;
+    uint32_t now = time_us_32();
+    uint32_t elapsed = now - last_time_us;
+    uint32_t pos = head.load(std::memory_order_relaxed);
+    uint32_t nfree = (mask + 1) - (pos - tail.load(std::memory_order_acquire));
+    uint32_t needed = 3u + nargs + nextra + nextra2 + ((elapsed > UINT16_MAX) ? 7u : 0u);
+    if (needed > nfree) {
+        ++num_dropped;
+        return;
+    }
+    last_time_us = now;
+    if (elapsed > UINT16_MAX) {
+        put(pos, static_cast<uint8_t>(Op::TIME));
+        put(pos, 0);
+        put(pos, 0);
+        for (int shift = 0; shift < 32; shift += 8)
+            put(pos, static_cast<uint8_t>(elapsed >> shift));
+        elapsed = 0;
+    }
+    put(pos, static_cast<uint8_t>(op));
+    put(pos, static_cast<uint8_t>(elapsed));
+    put(pos, static_cast<uint8_t>(elapsed >> 8));
+    while (nargs--)
+        put(pos, *args++);
+    while (nextra--)
+        put(pos, *extra++);
+    while (nextra2--)
+        put(pos, *extra2++);
+    head.store(pos, std::memory_order_release);
+}
+
+size_t rppicomidi::Draw_trace::read(uint8_t* dest, size_t max_bytes)
+{
+    assert(dest);
+    uint32_t pos = tail.load(std::memory_order_relaxed);
+    size_t nbytes = head.load(std::memory_order_acquire) - pos;
+    if (nbytes > max_bytes)
+        nbytes = max_bytes;
+    for (size_t idx = 0; idx < nbytes; idx++)
+        dest[idx] = buffer[pos++ & mask];
+    tail.store(pos, std::memory_order_release);
+    return nbytes;
+}
+
+size_t rppicomidi::Draw_trace::get_record_len(const uint8_t* trace, size_t nbytes)
+{
+    // number of argument bytes for each Op, not counting STRING characters or SPRITE bitmaps
+    static const uint8_t nargs[] = {4, 0, 4, 3, 5, 5, 4, 5, 5, 0, 5, 7};
+    if (nbytes < 3 || trace[0] >= sizeof(nargs))
+        return 0;
+    const uint8_t* args = trace + 3;
+    size_t len = 3 + nargs[trace[0]];
+    if (len > nbytes)
+        return 0;
+    Op op = static_cast<Op>(trace[0]);
+    if (op == Op::STRING)
+        len += args[4];
+    else if (op == Op::SPRITE)
+        len += args[2] * ((args[3] + 7) / 8) * (args[4] ? 2 : 1);
+    return len > nbytes ? 0 : len;
+}
+
+bool rppicomidi::Draw_trace::contains(const uint8_t* trace, size_t nbytes, Op op)
+{
+    size_t idx = 0;
+    size_t len;
+    while ((len = get_record_len(trace + idx, nbytes - idx)) != 0) {
+        if (trace[idx] == static_cast<uint8_t>(op))
+            return true;
+        idx += len;
+    }
+    return false;
+}
+
+size_t rppicomidi::Draw_trace::replay(const uint8_t* trace, size_t nbytes, Mono_graphics& screen,
+        const MonoMonoFont* const* fonts, uint8_t num_fonts, uint32_t* total_us)
+{
+    size_t idx = 0;
+    size_t nrecords = 0;
+    uint32_t elapsed = 0;
+    size_t len;
+    while ((len = get_record_len(trace + idx, nbytes - idx)) != 0) {
+        const uint8_t* args = trace + idx + 3;
+        Op op = static_cast<Op>(trace[idx]);
+        elapsed += trace[idx+1] | (trace[idx+2] << 8);
+        auto fg = [](uint8_t colors) { return static_cast<Pixel_state>(colors & 3); };
+        auto bg = [](uint8_t colors) { return static_cast<Pixel_state>((colors >> 2) & 3); };
+        switch (op) {
+            case Op::TIME:
+                elapsed += args[0] | (args[1] << 8) | (args[2] << 16) | (static_cast<uint32_t>(args[3]) << 24);
+                break;
+            case Op::CLEAR_CANVAS:
+                screen.clear_canvas();
+                break;
+            case Op::SET_CLIP_RECT:
+                screen.set_clip_rect(args[0], args[1], args[2], args[3]);
+                break;
+            case Op::DOT:
+                screen.draw_dot(args[0], args[1], fg(args[2]));
+                break;
+            case Op::LINE:
+                screen.draw_line(args[0], args[1], args[2], args[3], fg(args[4]));
+                break;
+            case Op::RECTANGLE:
+                screen.draw_rectangle(args[0], args[1], args[2], args[3], fg(args[4]), bg(args[4]));
+                break;
+            case Op::CIRCLE:
+                screen.draw_centered_circle(args[0], args[1], args[2], fg(args[3]), bg(args[3]));
+                break;
+            case Op::CHARACTER:
+                if (args[0] < num_fonts)
+                    screen.draw_character(*fonts[args[0]], args[1], args[2], static_cast<char>(args[3]), fg(args[4]), bg(args[4]));
+                break;
+            case Op::STRING:
+                if (args[0] < num_fonts) {
+                    uint8_t x = args[1];
+                    for (uint8_t chr = 0; chr < args[4]; chr++) {
+                        screen.draw_character(*fonts[args[0]], x, args[2], static_cast<char>(args[5+chr]), fg(args[3]), bg(args[3]));
+                        x += fonts[args[0]]->width;
+                    }
+                }
+                break;
+            case Op::RENDER:
+                // A band's parent sends the whole canvas after all bands are drawn
+                if (!screen.is_band())
+                    screen.render();
+                break;
+            case Op::SPRITE:
+            {
+                size_t nbitmap = args[2] * ((args[3] + 7) / 8);
+                Mono_sprite sprite{args[2], args[3], args + 5, args[4] ? args + 5 + nbitmap : nullptr};
+                screen.draw_sprite(args[0], args[1], sprite);
+                break;
+            }
+            case Op::SCROLL:
+                screen.scroll(args[0], args[1], args[2], args[3], static_cast<int8_t>(args[4]), static_cast<int8_t>(args[5]), fg(args[6]));
+                break;
+        }
+        idx += len;
+        ++nrecords;
+    }
+    if (total_us)
+        *total_us = elapsed;
+    return nrecords;
+}
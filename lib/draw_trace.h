@@ -0,0 +1,200 @@
+/**
+ * @file draw_trace.h
+ * @brief This class implements a compact binary recorder for the stream of
+ * Mono_graphics drawing calls and a replay function for it.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Every record in the trace is an opcode byte, a 16-bit little-endian
+ * time delta in microseconds since the previous record, and then the
+ * opcode arguments. If more than 65535 microseconds pass between two records,
+ * a TIME record with a 32-bit elapsed time is inserted before the second one.
+ * Two Pixel_state values are packed into one byte (fg in bits 0-1, bg
+ * in bits 2-3). Fonts are stored as an index into a small font table that
+ * the application fills using add_font(); the replay caller has to supply
+ * the same table.
+ *
+ * The trace buffer is a single producer, single consumer ring buffer. The
+ * drawing code is the producer. A task that sends the bytes somewhere (UART,
+ * USB, flash) is the consumer and calls read(). If a record does not fit,
+ * it is dropped whole and counted so the trace stays parsable.
+ */
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include "ssd1306.h"
+namespace rppicomidi {
+class Mono_graphics;
+class MonoMonoFont;
+struct Mono_sprite;
+
+class Draw_trace {
+public:
+    enum class Op : uint8_t {
+        TIME,           //!< args: uint32_t elapsed microseconds
+        CLEAR_CANVAS,   //!< no args
+        SET_CLIP_RECT,  //!< args: x_upper_left, y_upper_left, x_lower_right, y_lower_right
+        DOT,            //!< args: x, y, colors
+        LINE,           //!< args: x0, y0, x1, y1, colors
+        RECTANGLE,      //!< args: x0, y0, width, height, colors
+        CIRCLE,         //!< args: x_center, y_center, radius, colors (fg, fill)
+        CHARACTER,      //!< args: font index, x, y, chr, colors
+        STRING,         //!< args: font index, x, y, colors, len, len characters
+        RENDER,         //!< no args
+        SPRITE,         //!< args: x, y, width, height, has_mask, the bits bytes, then the mask bytes if has_mask
+        SCROLL,         //!< args: x, y, width, height, dx, dy, fill color
+    };
+
+    static const uint8_t max_fonts = 8;
+    static const uint8_t unknown_font = 0xFF;
+
+    /**
+     * @brief Construct a new Draw_trace object
+     *
+     * @param log2_nbytes the trace ring buffer is 2^log2_nbytes bytes long
+     */
+    Draw_trace(uint8_t log2_nbytes);
+    ~Draw_trace();
+
+    /**
+     * @brief add a font to the font table so records can refer to it
+     *
+     * @return the font index or unknown_font if the table is full
+     */
+    uint8_t add_font(const MonoMonoFont& font);
+
+    /**
+     * @brief start or stop recording. Recording is on after construction.
+     */
+    void set_enabled(bool enabled_) { enabled = enabled_; }
+    bool is_enabled() const { return enabled; }
+
+    //-------------------------------------------------------------------------
+    // Recording functions called by Mono_graphics
+    //-------------------------------------------------------------------------
+    void record(Op op) { write_record(op, nullptr, 0, nullptr, 0); }
+    void record(Op op, uint8_t a0, uint8_t a1, uint8_t a2) {
+        const uint8_t args[] = {a0, a1, a2};
+        write_record(op, args, sizeof(args), nullptr, 0);
+    }
+    void record(Op op, uint8_t a0, uint8_t a1, uint8_t a2, uint8_t a3) {
+        const uint8_t args[] = {a0, a1, a2, a3};
+        write_record(op, args, sizeof(args), nullptr, 0);
+    }
+    void record(Op op, uint8_t a0, uint8_t a1, uint8_t a2, uint8_t a3, uint8_t a4) {
+        const uint8_t args[] = {a0, a1, a2, a3, a4};
+        write_record(op, args, sizeof(args), nullptr, 0);
+    }
+    void record_character(const MonoMonoFont& font, uint8_t x, uint8_t y, char chr, Pixel_state fg, Pixel_state bg) {
+        const uint8_t args[] = {get_font_idx(font), x, y, static_cast<uint8_t>(chr), pack_colors(fg, bg)};
+        write_record(Op::CHARACTER, args, sizeof(args), nullptr, 0);
+    }
+    /**
+     * @brief record a draw_string() call
+     *
+     * A STRING record holds at most 255 characters, so a longer string is
+     * recorded as several STRING records. Each one starts where the previous
+     * one ended, with the same 8-bit x wrap-around as draw_string().
+     */
+    void record_string(const MonoMonoFont& font, uint8_t x, uint8_t y, const char* str, size_t len,
+            Pixel_state fg, Pixel_state bg);
+
+    void record_sprite(uint8_t x, uint8_t y, const Mono_sprite& sprite);
+    void record_scroll(uint8_t x, uint8_t y, uint8_t width, uint8_t height, int8_t dx, int8_t dy, Pixel_state fill) {
+        const uint8_t args[] = {x, y, width, height, static_cast<uint8_t>(dx), static_cast<uint8_t>(dy), pack_colors(fill, Pixel_state::PIXEL_ZERO)};
+        write_record(Op::SCROLL, args, sizeof(args), nullptr, 0);
+    }
+
+    static inline uint8_t pack_colors(Pixel_state fg, Pixel_state bg) {
+        return static_cast<uint8_t>(fg) | (static_cast<uint8_t>(bg) << 2);
+    }
+
+    //-------------------------------------------------------------------------
+    // Consumer functions
+    //-------------------------------------------------------------------------
+    /**
+     * @brief copy up to max_bytes of the oldest trace bytes to dest and
+     * remove them from the ring buffer. Records may be split across calls.
+     *
+     * @return the number of bytes copied
+     */
+    size_t read(uint8_t* dest, size_t max_bytes);
+
+    /**
+     * @brief Get the number of bytes waiting to be read
+     */
+    size_t get_num_pending() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Get the number of records dropped because the ring buffer was full
+     */
+    uint32_t get_num_dropped() const { return num_dropped; }
+
+    /**
+     * @brief draw every complete record in trace[0:nbytes-1] on screen
+     *
+     * Mono_graphics call timing is not reproduced; replay runs as fast
+     * as possible so the caller can time the rendering work.
+     *
+     * @param trace the trace bytes as returned by read()
+     * @param nbytes the number of trace bytes
+     * @param screen the screen to draw on. It should not have a trace attached.
+     * If it is a band of another screen, only the records that draw on the band
+     * draw anything and RENDER records are skipped.
+     * @param fonts the font table in the same order as the add_font() calls
+     * @param num_fonts the number of entries in fonts
+     * @param total_us if not nullptr, it is set to the sum of the recorded time deltas
+     * @return the number of records replayed
+     */
+    static size_t replay(const uint8_t* trace, size_t nbytes, Mono_graphics& screen,
+        const MonoMonoFont* const* fonts, uint8_t num_fonts, uint32_t* total_us=nullptr);
+
+    /**
+     * @brief return true if any complete record in trace[0:nbytes-1] has opcode op
+     */
+    static bool contains(const uint8_t* trace, size_t nbytes, Op op);
+private:
+    uint8_t* buffer;
+    uint32_t mask;
+    std::atomic<uint32_t> head;  // written by the producer only
+    std::atomic<uint32_t> tail;  // written by the consumer only
+    uint32_t num_dropped;
+    uint32_t last_time_us;
+    bool enabled;
+    uint8_t num_fonts;
+    const MonoMonoFont* fonts[max_fonts];
+
+    uint8_t get_font_idx(const MonoMonoFont& font) const {
+        for (uint8_t idx = 0; idx < num_fonts; idx++) {
+            if (fonts[idx] == &font)
+                return idx;
+        }
+        return unknown_font;
+    }
+    // Return the length of the record at the start of trace[0:nbytes-1] or 0 if it is incomplete or corrupt
+    static size_t get_record_len(const uint8_t* trace, size_t nbytes);
+    inline void put(uint32_t& pos, uint8_t byte) { buffer[pos++ & mask] = byte; }
+    void write_record(Op op, const uint8_t* args, uint8_t nargs, const uint8_t* extra, uint16_t nextra, const uint8_t* extra2=nullptr, uint16_t nextra2=0);
+};
+}
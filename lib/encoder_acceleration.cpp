@@ -0,0 +1,102 @@
+/**
+ * @file encoder_acceleration.cpp
+ * @brief This class converts encoder count changes to larger "effective"
+ * count changes when the encoder turns quickly so long value ranges can
+ * be swept with a few turns.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cmath>
+#include "encoder_acceleration.h"
+#include "pico/assert.h"
+
+rppicomidi::Encoder_acceleration::Encoder_acceleration(uint16_t engage_rate_, uint16_t release_rate_, uint16_t max_rate_,
+        uint8_t max_multiplier_, uint8_t exponent_) :
+    engaged{false}, remainder_q8{0}, last_multiplier_q8{256}, last_event_us{0}
+{
+    set_curve(engage_rate_, release_rate_, max_rate_, max_multiplier_, exponent_);
+}
+
+void rppicomidi::Encoder_acceleration::set_curve(uint16_t engage_rate_, uint16_t release_rate_, uint16_t max_rate_,
+        uint8_t max_multiplier_, uint8_t exponent_)
+{
+    assert(release_rate_ <= engage_rate_);
+    assert(engage_rate_ < max_rate_);
+    assert(max_multiplier_ >= 1);
+    engage_rate = engage_rate_;
+    release_rate = release_rate_;
+    // the last table entry is the first one at or above max_rate
+    bucket_width = (max_rate_ + table_size - 2) / (table_size - 1);
+    // The curve only gets computed here, so floating point is OK
+    for (uint8_t idx = 0; idx < table_size; idx++) {
+        float rate = static_cast<float>(idx * bucket_width);
+        float mult = 1.0f;
+        if (rate >= max_rate_) {
+            mult = max_multiplier_;
+        }
+        else if (rate > release_rate_) {
+            float fraction = (rate - release_rate_) / static_cast<float>(max_rate_ - release_rate_);
+            mult = 1.0f + (max_multiplier_ - 1) * std::pow(fraction, static_cast<float>(exponent_));
+        }
+        multiplier_q8[idx] = static_cast<uint16_t>(mult * 256.0f + 0.5f);
+    }
+    reset();
+}
+
+int32_t rppicomidi::Encoder_acceleration::get_effective_delta(const pimoroni::EncoderEvent& event)
+{
+    uint32_t elapsed = event.timestamp_us - last_event_us;
+    last_event_us = event.timestamp_us;
+    uint32_t rate = (elapsed == 0) ? UINT16_MAX : 1000000u / elapsed;
+    return get_effective_delta(event.delta, rate);
+}
+
+int32_t rppicomidi::Encoder_acceleration::get_effective_delta(int32_t delta, uint32_t rate)
+{
+    if (delta == 0)
+        return 0;
+    if (engaged) {
+        if (rate < release_rate)
+            engaged = false;
+    }
+    else if (rate >= engage_rate) {
+        engaged = true;
+    }
+    if (!engaged) {
+        remainder_q8 = 0;
+        last_multiplier_q8 = 256;
+        return delta;
+    }
+    uint32_t idx = rate / bucket_width;
+    if (idx >= table_size)
+        idx = table_size - 1;
+    last_multiplier_q8 = multiplier_q8[idx];
+    // Carry the fraction of an effective count so that the total does not depend
+    // on how the counts are split between calls. Drop it on a direction change.
+    if ((remainder_q8 < 0) != (delta < 0))
+        remainder_q8 = 0;
+    int32_t effective_q8 = delta * static_cast<int32_t>(last_multiplier_q8) + remainder_q8;
+    int32_t effective = effective_q8 / 256; // round toward 0
+    remainder_q8 = static_cast<int16_t>(effective_q8 - effective * 256);
+    return effective;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file encoder_acceleration.h
+ * @brief This class converts encoder count changes to larger "effective"
+ * count changes when the encoder turns quickly so long value ranges can
+ * be swept with a few turns.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+#include <cstdint>
+#include "capture.hpp"
+#include "encoder_event_queue.hpp"
+namespace rppicomidi {
+class Encoder_acceleration {
+public:
+    /**
+     * @brief Construct a new Encoder_acceleration object
+     *
+     * The step rate is the number of counts per second reported by the
+     * encoder. Every count is one effective count until the rate reaches
+     * engage_rate. Once engaged, the acceleration stays on until the rate drops
+     * below release_rate so a slowing sweep does not flip between 1:1 and
+     * accelerated. While engaged, the multiplier rises from 1 at release_rate
+     * to max_multiplier at max_rate along a power curve and stays at
+     * max_multiplier above max_rate.
+     *
+     * @param engage_rate the step rate where acceleration starts
+     * @param release_rate the step rate below which acceleration stops; must be <= engage_rate
+     * @param max_rate the step rate where the multiplier reaches max_multiplier
+     * @param max_multiplier the largest number of effective counts per count
+     * @param exponent the curve shape: 1 is linear, 2 is quadratic, etc.
+     */
+    Encoder_acceleration(uint16_t engage_rate=10, uint16_t release_rate=6, uint16_t max_rate=100,
+        uint8_t max_multiplier=8, uint8_t exponent=2);
+
+    /**
+     * @brief change the curve and recompute the lookup table. See the constructor
+     * for the parameter descriptions.
+     */
+    void set_curve(uint16_t engage_rate, uint16_t release_rate, uint16_t max_rate, uint8_t max_multiplier, uint8_t exponent);
+
+    /**
+     * @brief Get the effective count change for the count change since the last capture
+     * using the average step rate over the capture interval
+     */
+    int32_t get_effective_delta(const pimoroni::Capture& capture) {
+        int32_t rate = pimoroni::q16::to_int(capture.get_frequency_q16());
+        return get_effective_delta(capture.get_count_change(), rate < 0 ? -rate : rate);
+    }
+
+    /**
+     * @brief Get the effective count change for one event from an EncoderEventQueue
+     * using the time since the previous event from this encoder
+     */
+    int32_t get_effective_delta(const pimoroni::EncoderEvent& event);
+
+    /**
+     * @brief Get the effective count change for a count change at a given step rate
+     *
+     * @param delta the count change
+     * @param rate the step rate in counts per second
+     */
+    int32_t get_effective_delta(int32_t delta, uint32_t rate);
+
+    /**
+     * @brief drop acceleration state so the next count is 1:1
+     */
+    void reset() { engaged = false; remainder_q8 = 0; }
+
+    /**
+     * @brief Get the multiplier used for the last count change in Q8.8 fixed point
+     */
+    uint16_t get_multiplier_q8() const { return last_multiplier_q8; }
+private:
+    static const uint8_t table_size = 32;
+    uint16_t multiplier_q8[table_size]; // Q8.8 multiplier for each rate bucket
+    uint16_t bucket_width;  // step rate per table entry
+    uint16_t engage_rate;
+    uint16_t release_rate;
+    bool engaged;
+    int16_t remainder_q8;   // fraction of an effective count carried to the next delta
+    uint16_t last_multiplier_q8;
+    uint32_t last_event_us;
+};
+}
@@ -0,0 +1,164 @@
+/**
+ * @file frame_scheduler.cpp
+ * @brief This class runs the main loop of a UI as a sequence of
+ * fixed length frames.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstring>
+#include "frame_scheduler.h"
+
+rppicomidi::Frame_scheduler::Frame_scheduler(uint32_t frame_us_) :
+    frame_us{frame_us_}, input_cb{nullptr}, input_context{nullptr}, model_cb{nullptr}, model_context{nullptr},
+    num_displays{0}
+{
+    assert(frame_us > 0);
+    next_frame_us = time_us_32();
+    reset_stats();
+}
+
+void rppicomidi::Frame_scheduler::set_stage_cb(Stage stage, Stage_cb cb, void* context)
+{
+    if (stage == Stage::INPUT) {
+        input_cb = cb;
+        input_context = context;
+    }
+    else {
+        assert(stage == Stage::MODEL);
+        model_cb = cb;
+        model_context = context;
+    }
+}
+
+bool rppicomidi::Frame_scheduler::add_display(Widget_root& root, Render_pipeline* pipeline)
+{
+    if (num_displays >= max_displays)
+        return false;
+    Display& display = displays[num_displays++];
+    display.root = &root;
+    display.pipeline = pipeline;
+    display.frames_to_skip = 0;
+    memset(&display.stats, 0, sizeof(display.stats));
+    display.stats.frames_per_flush = 1;
+    return true;
+}
+
+void rppicomidi::Frame_scheduler::reset_stats()
+{
+    memset(&stats, 0, sizeof(stats));
+    for (uint8_t idx = 0; idx < num_displays; idx++) {
+        displays[idx].stats.num_flushed = 0;
+        displays[idx].stats.num_skipped = 0;
+    }
+}
+
+uint32_t rppicomidi::Frame_scheduler::get_time_to_next_frame_us() const
+{
+    int32_t wait = static_cast<int32_t>(next_frame_us - time_us_32());
+    return wait > 0 ? wait : 0;
+}
+
+void rppicomidi::Frame_scheduler::run_display(Display& display, uint32_t* stage_us)
+{
+    bool skip = display.frames_to_skip > 0;
+    if (skip) {
+        --display.frames_to_skip;
+        ++display.stats.num_skipped;
+        if (!display.root->has_invalid(true))
+            return;
+    }
+    Mono_graphics& screen = display.root->get_screen();
+    uint32_t start = time_us_32();
+    display.root->paint(skip);
+    uint32_t painted = time_us_32();
+    if (display.pipeline)
+        display.pipeline->publish();
+    else
+        screen.render_dirty();
+    uint32_t flushed = time_us_32();
+    stage_us[static_cast<int>(Stage::PAINT)] += painted - start;
+    stage_us[static_cast<int>(Stage::FLUSH)] += flushed - painted;
+    if (skip)
+        return;
+    // Flush no more often than the bus can send the changes of a typical flush
+    Display_stats& ds = display.stats;
+    ++ds.num_flushed;
+    uint32_t flush_us = flushed - painted;
+    ds.flush_avg_us = ds.num_flushed == 1 ? flush_us : ds.flush_avg_us - ds.flush_avg_us / 4 + flush_us / 4;
+    uint32_t frames = (ds.flush_avg_us + frame_us - 1) / frame_us;
+    if (frames < 1)
+        frames = 1;
+    else if (frames > UINT8_MAX)
+        frames = UINT8_MAX;
+    ds.frames_per_flush = frames;
+    display.frames_to_skip = frames - 1;
+}
+
+bool rppicomidi::Frame_scheduler::task()
+{
+    uint32_t start = time_us_32();
+    if (static_cast<int32_t>(start - next_frame_us) < 0)
+        return false;
+    uint32_t stage_us[num_stages] = {0};
+    if (input_cb)
+        input_cb(input_context);
+    uint32_t now = time_us_32();
+    stage_us[static_cast<int>(Stage::INPUT)] = now - start;
+    if (model_cb)
+        model_cb(model_context);
+    stage_us[static_cast<int>(Stage::MODEL)] = time_us_32() - now;
+    for (uint8_t idx = 0; idx < num_displays; idx++)
+        run_display(displays[idx], stage_us);
+    uint32_t end = time_us_32();
+
+    uint32_t used = end - start;
+    ++stats.num_frames;
+    stats.last_us = used;
+    if (used > stats.max_us)
+        stats.max_us = used;
+    stats.avg_us = stats.num_frames == 1 ? used : stats.avg_us - stats.avg_us / 16 + used / 16;
+    if (used > frame_us)
+        ++stats.num_overruns;
+    for (uint8_t stage = 0; stage < num_stages; stage++) {
+        if (stage_us[stage] > stats.stage_max_us[stage])
+            stats.stage_max_us[stage] = stage_us[stage];
+    }
+
+    // Start the next frame on time if this one fit. Otherwise, start it at once
+    // and drop the frames that did not fit instead of running them back to back.
+    next_frame_us += frame_us;
+    int32_t late = static_cast<int32_t>(end - next_frame_us);
+    if (late >= 0) {
+        stats.num_dropped += late / frame_us;
+        next_frame_us = end;
+    }
+    return true;
+}
+
+void rppicomidi::Frame_scheduler::run()
+{
+    for (;;) {
+        if (!task())
+            sleep_us(get_time_to_next_frame_us());
+    }
+}
@@ -0,0 +1,155 @@
+/**
+ * @file frame_scheduler.h
+ * @brief This class runs the main loop of a UI as a sequence of
+ * fixed length frames.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Each frame runs four stages in order:
+ * - INPUT: the application callback that polls the encoders and buttons
+ * - MODEL: the application callback that updates the widget states, for
+ *   example from MIDI messages
+ * - PAINT: every display's Widget_root paints its invalid widgets
+ * - FLUSH: every display sends the dirty parts of its canvas
+ *
+ * The frame scheduler measures each stage. A display whose flush takes
+ * longer than a frame cannot be flushed every frame, so its frames are
+ * skipped: its widgets stay invalid, and all their changes are painted
+ * and flushed together in the next frame the display gets. Only the high
+ * priority widgets of a skipped display are painted and flushed, so they
+ * keep up with the user. A display flushed through a Render_pipeline sends
+ * its canvas from the other core, so its FLUSH stage only copies the canvas
+ * and the pipeline coalesces the frames the bus cannot keep up with. If a
+ * frame runs long, the next frame starts at once and the frames that did
+ * not fit are dropped, not run back to back.
+ */
+#pragma once
+#include <cstdint>
+#include "widget.h"
+#include "render_pipeline.h"
+#include "pico/stdlib.h"
+#include "pico/assert.h"
+namespace rppicomidi {
+class Frame_scheduler {
+public:
+    enum class Stage : uint8_t {
+        INPUT,
+        MODEL,
+        PAINT,
+        FLUSH,
+    };
+    static const uint8_t num_stages = 4;
+    static const uint8_t max_displays = 4;
+
+    /**
+     * @brief the function called for the INPUT and MODEL stages
+     */
+    typedef void (*Stage_cb)(void* context);
+
+    struct Stats {
+        uint32_t num_frames;        //!< number of frames run
+        uint32_t num_dropped;       //!< number of frames that did not fit after a long frame
+        uint32_t num_overruns;      //!< number of frames that took longer than frame_us
+        uint32_t last_us;           //!< time the last frame took
+        uint32_t max_us;            //!< longest frame time
+        uint32_t avg_us;            //!< frame time moving average over about 16 frames
+        uint32_t stage_max_us[num_stages]; //!< longest time of each stage
+    };
+
+    struct Display_stats {
+        uint32_t num_flushed;       //!< number of frames the display was flushed
+        uint32_t num_skipped;       //!< number of frames only its high priority widgets got
+        uint32_t flush_avg_us;      //!< flush time moving average over about 4 flushes
+        uint8_t frames_per_flush;   //!< the current number of frames between full flushes
+    };
+
+    /**
+     * @brief Construct a new Frame_scheduler object
+     *
+     * @param frame_us_ the frame period in microseconds
+     */
+    Frame_scheduler(uint32_t frame_us_=20000);
+
+    /**
+     * @brief set the callback for the INPUT or MODEL stage
+     *
+     * @param stage Stage::INPUT or Stage::MODEL
+     * @param cb the callback or nullptr for none
+     * @param context passed to the callback
+     */
+    void set_stage_cb(Stage stage, Stage_cb cb, void* context);
+
+    /**
+     * @brief paint and flush a display every frame it can keep up with
+     *
+     * @param root the widgets on the display
+     * @param pipeline if not nullptr, the FLUSH stage publishes the canvas to
+     * this pipeline, which sends it from the other core, instead of sending it
+     * @return false if there are already max_displays displays
+     */
+    bool add_display(Widget_root& root, Render_pipeline* pipeline=nullptr);
+
+    void set_frame_us(uint32_t frame_us_) { frame_us = frame_us_; }
+    uint32_t get_frame_us() const { return frame_us; }
+
+    /**
+     * @brief run a frame if one is due
+     *
+     * @note Call this from the main loop as often as possible
+     * @return true if a frame ran
+     */
+    bool task();
+
+    /**
+     * @brief run frames forever, sleeping between them
+     */
+    void run();
+
+    /**
+     * @brief Get the number of microseconds until the next frame is due or 0 if it is due
+     */
+    uint32_t get_time_to_next_frame_us() const;
+
+    const Stats& get_stats() const { return stats; }
+    const Display_stats& get_display_stats(uint8_t display) const { assert(display < num_displays); return displays[display].stats; }
+    void reset_stats();
+private:
+    struct Display {
+        Widget_root* root;
+        Render_pipeline* pipeline;
+        uint8_t frames_to_skip;     // frames left before the next full paint and flush
+        Display_stats stats;
+    };
+    void run_display(Display& display, uint32_t* stage_us);
+
+    uint32_t frame_us;
+    uint32_t next_frame_us;
+    Stage_cb input_cb;
+    void* input_context;
+    Stage_cb model_cb;
+    void* model_context;
+    Display displays[max_displays];
+    uint8_t num_displays;
+    Stats stats;
+};
+}
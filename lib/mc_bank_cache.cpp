@@ -0,0 +1,103 @@
+/**
+ * @file mc_bank_cache.cpp
+ * @brief This class remembers the control surface state of recently
+ * used Mackie Control banks so a bank switch can repaint at once.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdlib>
+#include "mc_bank_cache.h"
+
+rppicomidi::Mc_bank_cache::Mc_bank_cache(Mc_midi_parser& parser_, size_t max_bytes_, uint16_t initial_bank_) :
+    parser{parser_}, current_bank{initial_bank_}, use_count{0}, num_hits{0}, num_misses{0}
+{
+    size_t nentries = max_bytes_ / sizeof(Entry);
+    assert(nentries >= 1);
+    max_entries = nentries > UINT8_MAX ? UINT8_MAX : nentries;
+    entries = reinterpret_cast<Entry*>(malloc(max_entries * sizeof(Entry)));
+    assert(entries);
+    clear();
+}
+
+rppicomidi::Mc_bank_cache::~Mc_bank_cache()
+{
+    free(entries);
+}
+
+void rppicomidi::Mc_bank_cache::clear()
+{
+    for (uint8_t idx = 0; idx < max_entries; idx++)
+        entries[idx].last_used = 0;
+}
+
+rppicomidi::Mc_bank_cache::Entry* rppicomidi::Mc_bank_cache::find(uint16_t bank)
+{
+    for (uint8_t idx = 0; idx < max_entries; idx++) {
+        if (entries[idx].last_used != 0 && entries[idx].bank == bank)
+            return entries + idx;
+    }
+    return nullptr;
+}
+
+rppicomidi::Mc_bank_cache::Entry* rppicomidi::Mc_bank_cache::get_entry_to_replace(const Entry* keep)
+{
+    Entry* oldest = nullptr;
+    for (uint8_t idx = 0; idx < max_entries; idx++) {
+        if (entries + idx == keep)
+            continue;
+        if (entries[idx].last_used == 0)
+            return entries + idx;
+        if (oldest == nullptr || entries[idx].last_used < oldest->last_used)
+            oldest = entries + idx;
+    }
+    return oldest;
+}
+
+bool rppicomidi::Mc_bank_cache::switch_bank(uint16_t bank)
+{
+    if (bank == current_bank)
+        return true;
+    Entry* next = find(bank);
+    // Never replace the bank being switched to with the one being left
+    Entry* entry = find(current_bank);
+    if (entry == nullptr)
+        entry = get_entry_to_replace(next);
+    if (entry) {
+        parser.save_state(entry->state);
+        entry->bank = current_bank;
+        entry->last_used = ++use_count;
+    }
+    current_bank = bank;
+
+    if (next) {
+        ++num_hits;
+        next->last_used = ++use_count;
+        parser.restore_state(next->state);
+        return true;
+    }
+    ++num_misses;
+    Mc_midi_parser::State blank;
+    Mc_midi_parser::clear_state(blank);
+    parser.restore_state(blank);
+    return false;
+}
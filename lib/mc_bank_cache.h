@@ -0,0 +1,98 @@
+/**
+ * @file mc_bank_cache.h
+ * @brief This class remembers the control surface state of recently
+ * used Mackie Control banks so a bank switch can repaint at once.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * When the user changes the bank, the DAW resends the LCD, V-pot rings
+ * and strip button LEDs for the new bank a few messages at a time. Until it is
+ * done, the strips would show the old bank. switch_bank() saves the
+ * Mc_midi_parser state for the bank being left and restores the state
+ * last seen for the new bank, or a blank surface if the new bank is not
+ * cached. The DAW messages that follow are parsed as usual; the widgets
+ * only redraw what differs, so a correct cached state costs almost
+ * nothing to reconcile.
+ *
+ * The cache holds as many banks as fit in the memory budget given to the
+ * constructor. When it is full, the least recently used bank is replaced.
+ * With room for one bank only, the bank being left is not saved if the
+ * new bank is the cached one.
+ */
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "mc_midi_parser.h"
+namespace rppicomidi {
+class Mc_bank_cache {
+public:
+    /**
+     * @brief Construct a new Mc_bank_cache object
+     *
+     * @param parser_ the parser that holds the current state
+     * @param max_bytes_ the memory budget for cached banks; it must fit at least one bank
+     * @param initial_bank_ the bank the parser state belongs to now
+     */
+    Mc_bank_cache(Mc_midi_parser& parser_, size_t max_bytes_, uint16_t initial_bank_=0);
+    ~Mc_bank_cache();
+
+    /**
+     * @brief save the current bank's state and show the new bank's state
+     *
+     * @param bank the new bank number
+     * @return true if the new bank was in the cache
+     */
+    bool switch_bank(uint16_t bank);
+
+    /**
+     * @brief forget every cached bank, for example when the DAW project changes
+     */
+    void clear();
+
+    uint16_t get_current_bank() const { return current_bank; }
+    uint8_t get_max_banks() const { return max_entries; }
+    uint32_t get_num_hits() const { return num_hits; }
+    uint32_t get_num_misses() const { return num_misses; }
+
+    /**
+     * @brief Get the number of bytes one cached bank uses
+     */
+    static constexpr size_t get_bytes_per_bank() { return sizeof(Entry); }
+private:
+    struct Entry {
+        Mc_midi_parser::State state;
+        uint32_t last_used;     // 0 if the entry is empty
+        uint16_t bank;
+    };
+    Entry* find(uint16_t bank);
+    Entry* get_entry_to_replace(const Entry* keep);
+
+    Mc_midi_parser& parser;
+    Entry* entries;
+    uint8_t max_entries;
+    uint16_t current_bank;
+    uint32_t use_count;
+    uint32_t num_hits;
+    uint32_t num_misses;
+};
+}
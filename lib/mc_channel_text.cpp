@@ -3,7 +3,7 @@
 #include "pico/assert.h"
 
 rppicomidi::Mc_channel_text::Mc_channel_text(Mono_graphics& screen_, uint8_t x_, uint8_t y_, uint8_t channel_, const MonoMonoFont& font_) :
-    screen{screen_}, x{x_}, y{y_}, channel{channel_}, font{font_}
+    Widget{screen_, x_, y_, static_cast<uint8_t>(7*font_.width), static_cast<uint8_t>(2*font_.height)}, channel{channel_}, font{font_}, num_cells_drawn{0}, num_cells_skipped{0}
 {
     // pad with ' '  1234567
     strcpy(text[0], "       ");
@@ -15,7 +15,27 @@ void rppicomidi::Mc_channel_text::draw()
 {
     for (int idx = 0; idx < 2; idx++) {
         screen.draw_string(font, x, y + idx* font.height, text[idx], 7, Pixel_state::PIXEL_ONE, Pixel_state::PIXEL_ZERO);
+        memcpy(drawn[idx], text[idx], 7);
     }
+    num_cells_drawn += 14;
+}
+
+uint8_t rppicomidi::Mc_channel_text::flush()
+{
+    uint8_t ndrawn = 0;
+    for (int line = 0; line < 2; line++) {
+        for (int column = 0; column < 7; column++) {
+            if (drawn[line][column] != text[line][column]) {
+                screen.draw_character(font, x + column * font.width, y + line * font.height, text[line][column],
+                    Pixel_state::PIXEL_ONE, Pixel_state::PIXEL_ZERO);
+                drawn[line][column] = text[line][column];
+                ++ndrawn;
+            }
+        }
+    }
+    num_cells_drawn += ndrawn;
+    num_cells_skipped += 14 - ndrawn;
+    return ndrawn;
 }
 
 void rppicomidi::Mc_channel_text::set_text(uint8_t line, uint8_t offset, const char* text_)
@@ -24,8 +44,7 @@ void rppicomidi::Mc_channel_text::set_text(uint8_t line, uint8_t offset, const c
     assert(offset < 7);
     // non-destructive (don't add null termination) strncpy
     for (int idx=offset; idx < 7 && text_[idx] != '\0'; idx++)
-        text[line][idx] =  text_[idx];
-    draw();
+        set_character(line, idx, text_[idx]);
 }
 
 void rppicomidi::Mc_channel_text::set_text_by_mc_sysex(const uint8_t* sysex_message, uint8_t num_chars)
@@ -39,10 +58,9 @@ void rppicomidi::Mc_channel_text::set_text_by_mc_sysex(const uint8_t* sysex_mess
             // then there may be characters for this field
             uint8_t message_char_idx = 1+line_offset-offset;
             for (int ch_idx = 0; ch_idx < 7 && message_char_idx <= num_chars; ch_idx++) {
-                text[line][ch_idx] = sysex_message[message_char_idx++];
+                set_character(line, ch_idx, static_cast<char>(sysex_message[message_char_idx++]));
             }
         }
         line_offset+=56;
     }
-    draw();
 }
\ No newline at end of file
@@ -25,9 +25,10 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE. 
  */
-#include "mono_graphics_lib.h"
+#pragma once
+#include "widget.h"
 namespace rppicomidi {
-class Mc_channel_text
+class Mc_channel_text : public Widget
 {
 public:
     /**
@@ -40,7 +41,19 @@ public:
      */
     Mc_channel_text(Mono_graphics& screen_, uint8_t x_, uint8_t y_, uint8_t channel_, const MonoMonoFont& font_);
 
-    void draw();
+    /**
+     * @brief draw all 14 characters to the screen buffer
+     */
+    void draw() override;
+
+    void paint() override { flush(); }
+
+    /**
+     * @brief draw only the characters that changed since they were last drawn
+     *
+     * @return the number of characters drawn
+     */
+    uint8_t flush();
 
     /**
      * @brief Set the text in one of the two lines to be displayed
@@ -66,15 +79,50 @@ public:
      * oo is display line offset 0-55 for the first line and and 56-111
      * for the second line.
      * 
+     * @note Mc_lcd_model applies each message once for all 8 strips. Use it
+     * instead of calling this for every strip.
+     *
      * @param sysex_message A pointer to the sysex message body starting at the oo byte
      * @param num_chars the number of characters to write (excludes the oo byte)
      */
     void set_text_by_mc_sysex(const uint8_t* sysex_message, uint8_t num_chars);
+
+    /**
+     * @brief Set one character of the text
+     *
+     * A changed character is drawn like any other Widget change: in the
+     * next frame of the Widget_root, or at once if there is no root.
+     *
+     * @param line line number either 0 or 1
+     * @param column the character position in the line 0-6
+     * @param chr the character
+     */
+    void set_character(uint8_t line, uint8_t column, char chr) {
+        assert(line < 2 && column < 7);
+        if (text[line][column] != chr) {
+            text[line][column] = chr;
+            invalidate();
+        }
+    }
+
+    /**
+     * @brief Get the number of character cells flush() and draw() drew
+     */
+    uint32_t get_num_cells_drawn() const { return num_cells_drawn; }
+
+    /**
+     * @brief Get the number of character cells flush() skipped because
+     * they already showed the right character
+     */
+    uint32_t get_num_cells_skipped() const { return num_cells_skipped; }
+
+    void reset_counters() { num_cells_drawn = 0; num_cells_skipped = 0; }
 private:
-    Mono_graphics screen;
-    uint8_t x,y;
     uint8_t channel;
     char text[2][8]; // An array of 2 7-character null-terminated strings always right padded with spaces
+    char drawn[2][7]; // the characters in the screen buffer
     const MonoMonoFont& font;
+    uint32_t num_cells_drawn;
+    uint32_t num_cells_skipped;
 };
 }
\ No newline at end of file
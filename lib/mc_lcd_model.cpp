@@ -0,0 +1,86 @@
+/**
+ * @file mc_lcd_model.cpp
+ * @brief This class holds the Mackie Control 2x56 character LCD and
+ * passes the changed characters to the channel strips.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstring>
+#include "mc_lcd_model.h"
+
+rppicomidi::Mc_lcd_model::Mc_lcd_model() :
+    write_idx{num_chars}, changed_first{num_chars}, changed_last{0}, strips_changed{0}, texts{}
+{
+    memset(chars, ' ', sizeof(chars));
+}
+
+void rppicomidi::Mc_lcd_model::set_channel_text(uint8_t strip, Mc_channel_text* text_)
+{
+    assert(strip < num_strips);
+    texts[strip] = text_;
+    copy_strip(strip);
+}
+
+void rppicomidi::Mc_lcd_model::copy_strip(uint8_t strip)
+{
+    Mc_channel_text* text = texts[strip];
+    if (text == nullptr)
+        return;
+    for (uint8_t line = 0; line < num_lines; line++) {
+        const char* src = chars + line * line_length + strip * strip_width;
+        for (uint8_t column = 0; column < strip_width; column++)
+            text->set_character(line, column, src[column]);
+    }
+}
+
+uint8_t rppicomidi::Mc_lcd_model::end_write()
+{
+    uint8_t changed = strips_changed;
+    for (uint8_t strip = 0; strips_changed != 0; strip++, strips_changed >>= 1) {
+        if (strips_changed & 1)
+            copy_strip(strip);
+    }
+    changed_first = num_chars;
+    changed_last = 0;
+    write_idx = num_chars;
+    return changed;
+}
+
+uint8_t rppicomidi::Mc_lcd_model::write(uint8_t offset, const uint8_t* chars_, uint8_t nchars)
+{
+    assert(chars_);
+    begin_write(offset);
+    while (nchars--)
+        put(static_cast<char>(*chars_++));
+    return end_write();
+}
+
+void rppicomidi::Mc_lcd_model::save_snapshot(Snapshot& snapshot) const
+{
+    memcpy(snapshot.chars, chars, num_chars);
+}
+
+uint8_t rppicomidi::Mc_lcd_model::restore_snapshot(const Snapshot& snapshot)
+{
+    return write(0, reinterpret_cast<const uint8_t*>(snapshot.chars), num_chars);
+}
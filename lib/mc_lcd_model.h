@@ -0,0 +1,150 @@
+/**
+ * @file mc_lcd_model.h
+ * @brief This class holds the Mackie Control 2x56 character LCD and
+ * passes the changed characters to the channel strips.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The Mackie Control LCD is one 2 line by 56 character display shown as
+ * 7 characters for each of 8 channel strips. Each LCD system exclusive
+ * message is applied to the character buffer once. The characters that
+ * really change mark their strip, and only the marked strips get their
+ * 14 characters copied to the attached Mc_channel_text when the message
+ * ends.
+ *
+ * A Snapshot is a copy of the whole LCD. Saving one before a bank switch
+ * and restoring it after switching back redraws only the strips whose
+ * text differs.
+ */
+#pragma once
+#include <cstdint>
+#include "mc_channel_text.h"
+namespace rppicomidi {
+class Mc_lcd_model {
+public:
+    static const uint8_t num_strips = 8;
+    static const uint8_t num_lines = 2;
+    static const uint8_t strip_width = 7;
+    static const uint8_t line_length = num_strips * strip_width;
+    static const uint8_t num_chars = num_lines * line_length;
+
+    struct Snapshot {
+        char chars[num_chars];
+    };
+
+    /**
+     * @brief Construct a new Mc_lcd_model object with every character a space
+     */
+    Mc_lcd_model();
+
+    /**
+     * @brief show one channel strip's text on a Mc_channel_text
+     *
+     * The strip's current characters are copied to the text.
+     *
+     * @param strip the channel strip 0-7
+     * @param text_ the text object or nullptr to stop updating one
+     */
+    void set_channel_text(uint8_t strip, Mc_channel_text* text_);
+
+    /**
+     * @brief start writing characters at an LCD offset
+     *
+     * @param offset 0-55 for the first line and 56-111 for the second line
+     */
+    void begin_write(uint8_t offset) { write_idx = offset; }
+
+    /**
+     * @brief write the next character. Characters past the end of the
+     * LCD are ignored. Characters outside the printable range ' ' to '~'
+     * are stored as ' ', so the channel strips never draw a character
+     * that is not in the font.
+     */
+    void put(char chr) {
+        if (chr < ' ' || chr > '~')
+            chr = ' ';
+        if (write_idx < num_chars) {
+            if (chars[write_idx] != chr) {
+                chars[write_idx] = chr;
+                mark_changed(write_idx);
+            }
+            ++write_idx;
+        }
+    }
+
+    /**
+     * @brief copy the characters of the channel strips that changed since the
+     * last end_write() to their Mc_channel_text objects
+     *
+     * @return a bit mask of the strips that changed; bit n is strip n
+     */
+    uint8_t end_write();
+
+    /**
+     * @brief write nchars characters starting at offset and copy the changes
+     */
+    uint8_t write(uint8_t offset, const uint8_t* chars_, uint8_t nchars);
+
+    char get_character(uint8_t line, uint8_t column) const {
+        assert(line < num_lines && column < line_length);
+        return chars[line * line_length + column];
+    }
+
+    /**
+     * @brief Get the index of the first and last character changed since
+     * the last end_write()
+     *
+     * @return false if no character changed
+     */
+    bool get_changed_range(uint8_t& first, uint8_t& last) const {
+        first = changed_first;
+        last = changed_last;
+        return changed_first <= changed_last;
+    }
+
+    void save_snapshot(Snapshot& snapshot) const;
+
+    /**
+     * @brief make the LCD show a snapshot and copy the strips that changed
+     *
+     * @return a bit mask of the strips that changed; bit n is strip n
+     */
+    uint8_t restore_snapshot(const Snapshot& snapshot);
+private:
+    void mark_changed(uint8_t idx) {
+        if (idx < changed_first)
+            changed_first = idx;
+        if (idx > changed_last)
+            changed_last = idx;
+        strips_changed |= 1u << ((idx % line_length) / strip_width);
+    }
+    void copy_strip(uint8_t strip);
+
+    char chars[num_chars];
+    uint8_t write_idx;
+    uint8_t changed_first;      // num_chars if nothing changed
+    uint8_t changed_last;       // 0 if nothing changed
+    uint8_t strips_changed;     // bit n is set if the characters for strip n changed
+    Mc_channel_text* texts[num_strips];
+};
+}
@@ -28,39 +28,107 @@
 
 #include "mc_meter.h"
 
-rppicomidi::Mc_meter::Mc_meter(Mono_graphics& screen_, uint8_t x_, uint8_t y_, uint8_t meter_channel_) :
-        screen{screen_}, x{x_}, y{y_}, meter_channel{meter_channel_}, value{0}, overload{false}
+rppicomidi::Mc_meter::Mc_meter(Mono_graphics& screen_, uint8_t x_, uint8_t y_, uint8_t meter_channel_, Timer_wheel* wheel_) :
+        Widget{screen_, x_, y_, meter_width, meter_height}, meter_channel{meter_channel_}, value{0}, overload{false},
+        drawn_value{0}, drawn_overload{false}, wheel{wheel_}, decay_timer{decay, this}
 {
     time_last_value_set = get_absolute_time();
     draw();
 }
 
+rppicomidi::Mc_meter::~Mc_meter()
+{
+    if (wheel)
+        wheel->cancel(decay_timer);
+}
+
+void rppicomidi::Mc_meter::draw_segment(uint8_t idx)
+{
+    // Segment 0 is the top one. Neighboring segments share their borders,
+    // which are always on, so a segment can be drawn without the others.
+    Pixel_state fill = (value > (11-idx)) ? Pixel_state::PIXEL_ONE:Pixel_state::PIXEL_ZERO;
+    screen.draw_rectangle(x,7+y+idx*7, 8, 8, Pixel_state::PIXEL_ONE, fill);
+}
+
 void rppicomidi::Mc_meter::draw()
 {
     screen.draw_rectangle(x,y, 8, 8, Pixel_state::PIXEL_ONE, overload ? Pixel_state::PIXEL_ONE:Pixel_state::PIXEL_ZERO);
     for (int idx = 0; idx < 12; idx++) {
-        Pixel_state fill = (value > (11-idx)) ? Pixel_state::PIXEL_ONE:Pixel_state::PIXEL_ZERO;
-        screen.draw_rectangle(x,7+y+idx*7, 8, 8, Pixel_state::PIXEL_ONE, fill);
+        draw_segment(idx);
+    }
+    drawn_value = value;
+    drawn_overload = overload;
+}
+
+bool rppicomidi::Mc_meter::flush()
+{
+    if (value == drawn_value && overload == drawn_overload)
+        return false;
+    if (overload != drawn_overload) {
+        screen.draw_rectangle(x,y, 8, 8, Pixel_state::PIXEL_ONE, overload ? Pixel_state::PIXEL_ONE:Pixel_state::PIXEL_ZERO);
+        drawn_overload = overload;
+    }
+    // Only the segments between the old and new value change state
+    uint8_t lo = value < drawn_value ? value : drawn_value;
+    uint8_t hi = value < drawn_value ? drawn_value : value;
+    for (uint8_t level = lo; level < hi; level++) {
+        draw_segment(11-level);
     }
+    drawn_value = value;
+    return true;
 }
 
 void rppicomidi::Mc_meter::set_value(uint8_t value_, bool overload_)
 {
+    if (value_ > 14)
+        value_ = 0;
+    else if (value_ > 12)
+        value_ = 12;
     value = value_;
     overload = overload_;
-    draw();
-    time_last_value_set = get_absolute_time();
+    invalidate();
+    if (wheel) {
+        if (value > 0)
+            wheel->schedule(decay_timer, decay_us);
+        else
+            wheel->cancel(decay_timer);
+    }
+    else {
+        time_last_value_set = get_absolute_time();
+    }
+}
+
+void rppicomidi::Mc_meter::decay(Timer_wheel::Timer&, void* context)
+{
+    auto meter = reinterpret_cast<Mc_meter*>(context);
+    if (meter->value > 0) {
+        if (--meter->value > 0)
+            meter->wheel->schedule(meter->decay_timer, decay_us);
+        meter->invalidate();
+    }
+}
+
+void rppicomidi::Mc_meter::set_value_by_channel_pressure(uint8_t message)
+{
+    uint8_t level = message & 0xf;
+    if (level == 14)
+        set_value(12, true);
+    else if (level == 15)
+        set_value(0, false);
+    else
+        set_value(level > 12 ? 12 : level, overload);
 }
 
 void rppicomidi::Mc_meter::mc_meter_task()
 {
-    if (value > 0) {
+    if (!wheel && value > 0) {
         absolute_time_t now = get_absolute_time();
         
         int64_t diff = absolute_time_diff_us(time_last_value_set, now);
-        if (diff > 300000 /* 300 ms */) {
+        if (diff > decay_us) {
             --value;
-            draw();
+            time_last_value_set = now;
+            invalidate();
         }
     }
 }
\ No newline at end of file
@@ -26,14 +26,34 @@
  * SOFTWARE. 
  */
 #pragma once
-#include "mono_graphics_lib.h"
+#include "widget.h"
+#include "timer_wheel.h"
 #include "pico/stdlib.h"
 namespace rppicomidi {
-class Mc_meter {
+class Mc_meter : public Widget {
 public:
-    Mc_meter(Mono_graphics& screen_, uint8_t x_, uint8_t y_, uint8_t meter_channel_);
+    /**
+     * @brief Construct a new Mc_meter object
+     *
+     * @param screen_ The screen object to render the meter
+     * @param x_ horizontal coordinate of the upper left corner
+     * @param y_ vertical coordinate of the upper left corner
+     * @param meter_channel_ the Mackie Control channel 0-7
+     * @param wheel_ if not nullptr, the meter decays using a timer on this
+     * timer wheel and mc_meter_task() does nothing
+     */
+    Mc_meter(Mono_graphics& screen_, uint8_t x_, uint8_t y_, uint8_t meter_channel_, Timer_wheel* wheel_=nullptr);
+
+    /**
+     * @brief Destroy the Mc_meter object and cancel its decay timer, so the
+     * timer wheel never runs the timer of a meter that is gone
+     */
+    ~Mc_meter();
     /**
      * @brief Set the current meter value and restart the decay timer
+     *
+     * The value is latched. If the meter is in a Widget_root, it is drawn
+     * in the root's next frame; otherwise, it is drawn at once.
      * 
      * @param value is the meter value 0 -12. Value 13 is the same as 12.
      * Value 14 is the same as 12. Value 15 or greater is the same as 0.
@@ -43,10 +63,10 @@ public:
     void set_value(uint8_t value, bool overload);
 
     /**
-     * @brief clear the overload flag and redraw
+     * @brief clear the overload flag. It is drawn like a set_value() change.
      * 
      */
-    void clear_overload() { overload = false; draw(); }
+    void clear_overload() { overload = false; invalidate(); }
 
     /**
      * @brief Set the value by channel pressure object
@@ -61,13 +81,27 @@ public:
     void set_value_by_channel_pressure(uint8_t message);
 
     /**
-     * @brief draw the meter to the screen buffer
+     * @brief draw the whole meter to the screen buffer
      * 
      */
-    void draw();
+    void draw() override;
+
+    void paint() override { flush(); }
+
+    /**
+     * @brief draw the segments and overload flag that changed since
+     * they were last drawn
+     *
+     * @note A Widget_root calls this once per display frame. Any number
+     * of set_value() calls between two frames cost one redraw at most,
+     * and none if the value ends up the same.
+     *
+     * @return true if anything was drawn
+     */
+    bool flush();
 
     /**
-     * @brief handle meter level decay.
+     * @brief handle meter level decay if the meter has no timer wheel.
      * 
      * @note This function should be called
      * frequently enough so that it looks like meter segments decay
@@ -75,12 +109,19 @@ public:
      * 
      */
     void mc_meter_task();
+    static const uint8_t meter_width = 8;
+    static const uint8_t meter_height = 92;
 private:
-    Mono_graphics screen;
-    uint8_t x,y;
     uint8_t meter_channel;
     uint8_t value;
     bool overload;
+    uint8_t drawn_value;    // the value the screen buffer shows
+    bool drawn_overload;    // the overload flag the screen buffer shows
+    void draw_segment(uint8_t idx);
     absolute_time_t time_last_value_set;
+    static const uint32_t decay_us = 300000;
+    Timer_wheel* wheel;
+    Timer_wheel::Timer decay_timer;
+    static void decay(Timer_wheel::Timer& timer, void* context);
 };
 }
\ No newline at end of file
@@ -0,0 +1,200 @@
+/**
+ * @file mc_midi_parser.cpp
+ * @brief This class parses a Mackie Control MIDI byte stream one byte at
+ * a time and sends each message to the channel strip object that displays it
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstring>
+#include "mc_midi_parser.h"
+
+rppicomidi::Mc_midi_parser::Mc_midi_parser(uint8_t device_id_) :
+    device_id{device_id_}, running_status{0}, data{0, 0}, num_data{0}, num_data_needed{0},
+    sysex_state{Sysex_state::NONE}, sysex_idx{0},
+    vpots{}, meters{}, leds{}, timecode_cb{nullptr}, timecode_context{nullptr}, vpot_cc{}, led_bits{}
+{
+}
+
+void rppicomidi::Mc_midi_parser::save_state(State& state) const
+{
+    lcd.save_snapshot(state.lcd);
+    memcpy(state.vpot_cc, vpot_cc, sizeof(vpot_cc));
+    memcpy(state.led_bits, led_bits, sizeof(state.led_bits));
+}
+
+void rppicomidi::Mc_midi_parser::restore_state(const State& state)
+{
+    lcd.restore_snapshot(state.lcd);
+    for (uint8_t strip = 0; strip < num_strips; strip++) {
+        vpot_cc[strip] = state.vpot_cc[strip];
+        if (vpots[strip])
+            vpots[strip]->set_by_cc_value(vpot_cc[strip]);
+        if (meters[strip])
+            meters[strip]->set_value(0, false);
+    }
+    for (uint8_t note = 0; note < num_strip_notes; note++) {
+        uint8_t mask = 1u << (note % 8);
+        if ((led_bits[note / 8] ^ state.led_bits[note / 8]) & mask) {
+            led_bits[note / 8] ^= mask;
+            if (leds[note])
+                leds[note]->set_state((led_bits[note / 8] & mask) != 0);
+        }
+    }
+}
+
+void rppicomidi::Mc_midi_parser::clear_state(State& state)
+{
+    memset(state.lcd.chars, ' ', sizeof(state.lcd.chars));
+    memset(state.vpot_cc, 0, sizeof(state.vpot_cc));
+    memset(state.led_bits, 0, sizeof(state.led_bits));
+}
+
+void rppicomidi::Mc_midi_parser::parse(uint8_t byte)
+{
+    if (byte >= 0xF8) {
+        // Real-time bytes do not change the parser state
+        return;
+    }
+    if (byte & 0x80) {
+        if (byte == 0xF7) {
+            if (sysex_state == Sysex_state::LCD)
+                lcd.end_write();
+            sysex_state = Sysex_state::NONE;
+            return;
+        }
+        // Any other status byte ends an unterminated system exclusive message without drawing it.
+        // Its LCD characters are drawn at the end of the next LCD message.
+        sysex_state = Sysex_state::NONE;
+        num_data = 0;
+        if (byte == 0xF0) {
+            sysex_state = Sysex_state::HEADER;
+            sysex_idx = 0;
+            running_status = 0;
+        }
+        else if (byte < 0xF0) {
+            static const uint8_t data_bytes[] = {2, 2, 2, 2, 1, 1, 2}; // 8n, 9n, An, Bn, Cn, Dn, En
+            running_status = byte;
+            num_data_needed = data_bytes[(byte >> 4) - 8];
+        }
+        else {
+            // System common messages cancel running status; their data bytes are skipped
+            static const uint8_t data_bytes[] = {0, 1, 2, 1, 0, 0, 0}; // F0-F6
+            running_status = data_bytes[byte & 0xF] ? byte : 0;
+            num_data_needed = data_bytes[byte & 0xF];
+        }
+        return;
+    }
+
+    // Data byte
+    switch (sysex_state) {
+        case Sysex_state::NONE:
+            break;
+        case Sysex_state::HEADER:
+        {
+            const uint8_t header[] = {0x00, 0x00, 0x66, device_id};
+            if (byte != header[sysex_idx])
+                sysex_state = Sysex_state::IGNORE;
+            else if (++sysex_idx == sizeof(header))
+                sysex_state = Sysex_state::COMMAND;
+            return;
+        }
+        case Sysex_state::COMMAND:
+            if (byte == 0x12) {
+                sysex_state = Sysex_state::LCD_OFFSET;
+            }
+            else if (byte == 0x10) {
+                sysex_state = Sysex_state::TIMECODE;
+                sysex_idx = 0;
+            }
+            else {
+                sysex_state = Sysex_state::IGNORE;
+            }
+            return;
+        case Sysex_state::LCD_OFFSET:
+            lcd.begin_write(byte);
+            sysex_state = Sysex_state::LCD;
+            return;
+        case Sysex_state::LCD:
+            lcd.put(static_cast<char>(byte));
+            return;
+        case Sysex_state::TIMECODE:
+            if (sysex_idx < 10 && timecode_cb)
+                timecode_cb(sysex_idx, byte, timecode_context);
+            ++sysex_idx;
+            return;
+        case Sysex_state::IGNORE:
+            return;
+    }
+
+    if (running_status == 0)
+        return; // no status to go with this data byte
+    data[num_data++] = byte;
+    if (num_data == num_data_needed) {
+        num_data = 0;
+        if (running_status < 0xF0)
+            dispatch_channel_message();
+        else
+            running_status = 0;
+    }
+}
+
+void rppicomidi::Mc_midi_parser::dispatch_channel_message()
+{
+    // Mackie Control only uses MIDI channel 1 for the messages handled here
+    switch (running_status) {
+        case 0x90: // note on: button LED
+            if (data[1] != 0)
+                led_bits[data[0] / 8] |= 1u << (data[0] % 8);
+            else
+                led_bits[data[0] / 8] &= ~(1u << (data[0] % 8));
+            if (leds[data[0]])
+                leds[data[0]]->set_state(data[1] != 0);
+            break;
+        case 0x80: // note off: button LED off
+            led_bits[data[0] / 8] &= ~(1u << (data[0] % 8));
+            if (leds[data[0]])
+                leds[data[0]]->set_state(false);
+            break;
+        case 0xB0: // control change
+            if (data[0] >= 0x30 && data[0] <= 0x37) {
+                vpot_cc[data[0] - 0x30] = data[1];
+                if (vpots[data[0] - 0x30])
+                    vpots[data[0] - 0x30]->set_by_cc_value(data[1]);
+            }
+            else if (data[0] >= 0x40 && data[0] <= 0x4B) {
+                // timecode and assignment display digits from right to left
+                if (timecode_cb)
+                    timecode_cb(data[0] - 0x40, data[1], timecode_context);
+            }
+            break;
+        case 0xD0: // channel pressure: meter
+        {
+            uint8_t strip = (data[0] >> 4) & 0x7;
+            if (meters[strip])
+                meters[strip]->set_value_by_channel_pressure(data[0]);
+            break;
+        }
+        default:
+            break;
+    }
+}
@@ -0,0 +1,153 @@
+/**
+ * @file mc_midi_parser.h
+ * @brief This class parses a Mackie Control MIDI byte stream one byte at
+ * a time and sends each message to the channel strip object that displays it
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The parser keeps at most the two data bytes of one channel message. LCD
+ * system exclusive characters are written to an Mc_lcd_model as they arrive
+ * and the changed strips are updated when the message ends, so a long LCD
+ * message is never copied. MIDI real-time bytes may appear
+ * anywhere, including inside a system exclusive message, and are ignored.
+ */
+#pragma once
+#include <cstdint>
+#include "vpot_display.h"
+#include "mc_meter.h"
+#include "mc_lcd_model.h"
+#include "button_led.h"
+namespace rppicomidi {
+class Mc_midi_parser {
+public:
+    static const uint8_t num_strips = 8;
+    static const uint8_t num_notes = 128;
+    static const uint8_t num_strip_notes = 32;  //!< the rec, solo, mute and select LED notes 0x00-0x1F
+
+    /**
+     * @brief the function called for each timecode or assignment display character
+     *
+     * @param position 0-9 are the timecode digits from right to left;
+     * 10 and 11 are the assignment display characters from right to left
+     * @param chr the 7-segment display character code; bit 6 is the decimal point
+     * @param context the context pointer passed to set_timecode_cb()
+     */
+    typedef void (*Timecode_cb)(uint8_t position, uint8_t chr, void* context);
+
+    /**
+     * @brief the control surface state that the DAW sends for one bank of strips.
+     * Meters are not included because they decay to 0 on their own. The
+     * button LEDs outside the strips, such as transport and assignment,
+     * do not change with the bank and are not included either.
+     */
+    struct State {
+        Mc_lcd_model::Snapshot lcd;
+        uint8_t vpot_cc[num_strips];            //!< the last V-pot LED CC value for each strip
+        uint8_t led_bits[num_strip_notes / 8];  //!< bit n%8 of byte n/8 is set if strip LED note n is on
+    };
+
+    /**
+     * @brief Construct a new Mc_midi_parser object
+     *
+     * @param device_id_ the Mackie Control device ID in system exclusive messages:
+     * 0x14 for the main unit or 0x15 for an extender
+     */
+    Mc_midi_parser(uint8_t device_id_=0x14);
+
+    //-------------------------------------------------------------------------
+    // Routing set up. Pass nullptr to stop routing to an object.
+    //-------------------------------------------------------------------------
+    void set_vpot(uint8_t strip, Vpot_display* vpot) { assert(strip < num_strips); vpots[strip] = vpot; }
+    void set_meter(uint8_t strip, Mc_meter* meter) { assert(strip < num_strips); meters[strip] = meter; }
+    void set_channel_text(uint8_t strip, Mc_channel_text* text) { lcd.set_channel_text(strip, text); }
+    void set_button_led(uint8_t note, Button_led* led) { assert(note < num_notes); leds[note] = led; }
+    void set_timecode_cb(Timecode_cb cb, void* context) { timecode_cb = cb; timecode_context = context; }
+
+    /**
+     * @brief Get the LCD contents, for example to save and restore snapshots
+     */
+    Mc_lcd_model& get_lcd_model() { return lcd; }
+
+    /**
+     * @brief copy the current control surface state
+     */
+    void save_state(State& state) const;
+
+    /**
+     * @brief show a saved control surface state on the routed objects
+     *
+     * Only the LCD strips and strip button LEDs that differ from the
+     * current state are redrawn. Every meter is set to 0 without overload.
+     * The other button LEDs keep their state.
+     */
+    void restore_state(const State& state);
+
+    /**
+     * @brief make state the state of a surface that has received nothing:
+     * a blank LCD, V-pot value 0 and every strip button LED off
+     */
+    static void clear_state(State& state);
+
+    /**
+     * @brief parse the next byte of the MIDI stream
+     */
+    void parse(uint8_t byte);
+
+    /**
+     * @brief parse nbytes bytes of the MIDI stream
+     */
+    void parse(const uint8_t* bytes, size_t nbytes) {
+        while (nbytes--)
+            parse(*bytes++);
+    }
+private:
+    enum class Sysex_state : uint8_t {
+        NONE,           //!< not in a system exclusive message
+        HEADER,         //!< matching the 0x00 0x00 0x66 device_id header
+        COMMAND,        //!< the next byte is the command
+        LCD_OFFSET,     //!< the next byte is the LCD character offset
+        LCD,            //!< LCD characters
+        TIMECODE,       //!< timecode characters
+        IGNORE,         //!< some other system exclusive message
+    };
+
+    void dispatch_channel_message();
+
+    uint8_t device_id;
+    uint8_t running_status;     // 0 if there is no running status
+    uint8_t data[2];
+    uint8_t num_data;           // number of data bytes received for running_status
+    uint8_t num_data_needed;    // number of data bytes running_status needs
+    Sysex_state sysex_state;
+    uint8_t sysex_idx;          // HEADER: header bytes matched; TIMECODE: next position
+
+    Vpot_display* vpots[num_strips];
+    Mc_meter* meters[num_strips];
+    Mc_lcd_model lcd;
+    Button_led* leds[num_notes];
+    Timecode_cb timecode_cb;
+    void* timecode_context;
+    uint8_t vpot_cc[num_strips];        // the state the DAW sent, for save_state()
+    uint8_t led_bits[num_notes / 8];
+};
+}
@@ -31,27 +31,302 @@
 #include "mono_graphics_lib.h"
 
 rppicomidi::Mono_graphics::Mono_graphics(rppicomidi::Ssd1306* display_, Display_rotation initial_rotation_) :
-    display{display_}
+    parent{nullptr}, display{display_}, trace{nullptr}, start_line{0}, pending_start_line{-1},
+    hw_scroll{}, hw_scroll_pending{false}, num_dirty_pages{0}
 {
     canvas_nbytes = display->get_minimum_canvas_size();
     canvas = reinterpret_cast<uint8_t*>(malloc(canvas_nbytes));
     assert(canvas);
-    clear_canvas();
+    num_pages = display->get_num_pages();
+    dirty_first_col = reinterpret_cast<uint8_t*>(malloc(num_pages * 2));
+    assert(dirty_first_col);
+    dirty_last_col = dirty_first_col + num_pages;
+    clear_dirty();
     display->init(initial_rotation_);
+	band_rect = {0, 0, static_cast<uint8_t>(get_screen_width()-1), static_cast<uint8_t>(get_screen_height()-1)};
+    clear_canvas();
 	set_clip_rect(0, 0, display->get_screen_width()-1, display->get_screen_height()-1);
 }
 
-void rppicomidi::Mono_graphics::draw_dot(uint8_t x, uint8_t y, Pixel_state fg_color)
+rppicomidi::Mono_graphics::Mono_graphics(Mono_graphics& parent_, uint8_t first_page_, uint8_t last_page_) :
+    parent{&parent_}, display{parent_.display}, canvas{parent_.canvas}, canvas_nbytes{parent_.canvas_nbytes},
+    trace{nullptr}, num_pages{parent_.num_pages}, start_line{0}, pending_start_line{-1},
+    hw_scroll{}, hw_scroll_pending{false}, num_dirty_pages{0}
+{
+	assert(!parent_.parent);
+	assert(first_page_ <= last_page_ && last_page_ < num_pages);
+	dirty_first_col = reinterpret_cast<uint8_t*>(malloc(num_pages * 2));
+	assert(dirty_first_col);
+	dirty_last_col = dirty_first_col + num_pages;
+	clear_dirty();
+	// Pages are rows of 8 pixels in landscape rotations and columns of 8 pixels in portrait
+	band_rect = {0, 0, static_cast<uint8_t>(get_screen_width()-1), static_cast<uint8_t>(get_screen_height()-1)};
+	if (display->is_portrait_rotation()) {
+		band_rect.x_upper_left = first_page_ * 8;
+		band_rect.x_lower_right = last_page_ * 8 + 7;
+	}
+	else {
+		band_rect.y_upper_left = first_page_ * 8;
+		band_rect.y_lower_right = last_page_ * 8 + 7;
+	}
+	set_clip_rect(0, 0, display->get_screen_width()-1, display->get_screen_height()-1);
+}
+
+rppicomidi::Mono_graphics::~Mono_graphics()
+{
+	if (!parent)
+		free(canvas);
+	free(dirty_first_col);
+}
+
+void rppicomidi::Mono_graphics::clear_band()
+{
+	if (display->is_portrait_rotation()) {
+		// Each canvas row of num_pages bytes holds one byte of every page
+		uint8_t first_page = band_rect.x_upper_left / 8;
+		uint8_t npages = band_rect.x_lower_right / 8 - first_page + 1;
+		for (size_t row = first_page; row < canvas_nbytes; row += num_pages)
+			memset(canvas + row, 0, npages);
+	}
+	else {
+		uint8_t width = get_screen_width();
+		memset(canvas + (band_rect.y_upper_left / 8) * width, 0, (band_rect.y_lower_right - band_rect.y_upper_left + 1) / 8 * width);
+	}
+}
+
+bool rppicomidi::Mono_graphics::mark_dirty(int x0, int y0, int x1, int y1, bool ignore_clip)
 {
-	// only draw the dot if x and y are within the clipping rectangle
-	if (x >= clip_rect.x_upper_left && x <= clip_rect.x_lower_right &&
-		y >= clip_rect.y_upper_left && y <= clip_rect.y_lower_right) {
-    	display->set_pixel_on_canvas(canvas, canvas_nbytes, x, y, fg_color);
+	Rectangle limit = ignore_clip ? band_rect : clip_rect;
+	if (x1 < x0) {
+		int tmp = x0; x0 = x1; x1 = tmp;
+	}
+	if (y1 < y0) {
+		int tmp = y0; y0 = y1; y1 = tmp;
+	}
+	if (x0 < 0 || y0 < 0 || x1 > UINT8_MAX || y1 > UINT8_MAX) {
+		x0 = limit.x_upper_left;
+		y0 = limit.y_upper_left;
+		x1 = limit.x_lower_right;
+		y1 = limit.y_lower_right;
 	}
+	if (x0 < limit.x_upper_left)
+		x0 = limit.x_upper_left;
+	if (y0 < limit.y_upper_left)
+		y0 = limit.y_upper_left;
+	if (x1 > limit.x_lower_right)
+		x1 = limit.x_lower_right;
+	if (y1 > limit.y_lower_right)
+		y1 = limit.y_lower_right;
+	if (x0 > x1 || y0 > y1)
+		return false;
+	// Convert to display memory pages and columns
+	int first_page, last_page, first_col, last_col;
+	if (display->is_portrait_rotation()) {
+		first_page = x0 / 8;
+		last_page = x1 / 8;
+		first_col = y0;
+		last_col = y1;
+	}
+	else {
+		first_page = y0 / 8;
+		last_page = y1 / 8;
+		first_col = x0;
+		last_col = x1;
+	}
+	for (int page = first_page; page <= last_page; page++) {
+		if (dirty_first_col[page] > dirty_last_col[page]) {
+			++num_dirty_pages;
+			dirty_first_col[page] = first_col;
+			dirty_last_col[page] = last_col;
+		}
+		else {
+			if (first_col < dirty_first_col[page])
+				dirty_first_col[page] = first_col;
+			if (last_col > dirty_last_col[page])
+				dirty_last_col[page] = last_col;
+		}
+	}
+	return true;
+}
+
+void rppicomidi::Mono_graphics::clear_dirty()
+{
+	num_dirty_pages = 0;
+	for (uint8_t page = 0; page < num_pages; page++) {
+		if (!is_page_held(page)) {
+			dirty_first_col[page] = UINT8_MAX;
+			dirty_last_col[page] = 0;
+		}
+		else if (dirty_first_col[page] <= dirty_last_col[page]) {
+			++num_dirty_pages;
+		}
+	}
+}
+
+bool rppicomidi::Mono_graphics::has_unheld_dirty_page() const
+{
+	for (uint8_t page = 0; page < num_pages; page++) {
+		if (!is_page_held(page) && dirty_first_col[page] <= dirty_last_col[page])
+			return true;
+	}
+	return false;
+}
+
+void rppicomidi::Mono_graphics::mark_pages_dirty(uint8_t first_page, uint8_t last_page)
+{
+	for (uint8_t page = first_page; page <= last_page; page++) {
+		if (dirty_first_col[page] > dirty_last_col[page])
+			++num_dirty_pages;
+		dirty_first_col[page] = 0;
+		dirty_last_col[page] = display->get_num_columns() - 1;
+	}
+}
+
+uint8_t rppicomidi::Mono_graphics::take_dirty(uint8_t* first_col, uint8_t* last_col)
+{
+	uint8_t ndirty = 0;
+	for (uint8_t page = 0; page < num_pages; page++) {
+		if (is_page_held(page)) {
+			first_col[page] = UINT8_MAX;
+			last_col[page] = 0;
+		}
+		else {
+			first_col[page] = dirty_first_col[page];
+			last_col[page] = dirty_last_col[page];
+			if (first_col[page] <= last_col[page])
+				++ndirty;
+		}
+	}
+	clear_dirty();
+	return ndirty;
+}
+
+void rppicomidi::Mono_graphics::start_hw_scroll(const Ssd1306::Scroll_cfg& cfg)
+{
+	assert(!parent);
+	assert(cfg.first_page <= cfg.last_page && cfg.last_page < num_pages);
+	// Setting up a scroll stops the old one, so its pages must be sent again
+	stop_hw_scroll();
+	hw_scroll = cfg;
+	hw_scroll.active = true;
+	hw_scroll_pending = true;
+}
+
+void rppicomidi::Mono_graphics::stop_hw_scroll()
+{
+	assert(!parent);
+	if (!hw_scroll.active)
+		return;
+	hw_scroll.active = false;
+	hw_scroll_pending = true;
+	mark_pages_dirty(hw_scroll.first_page, hw_scroll.last_page);
+	// A vertical scroll leaves the display offset where it stopped
+	if (hw_scroll.dir == Ssd1306::Scroll_dir::VERTICAL_RIGHT || hw_scroll.dir == Ssd1306::Scroll_dir::VERTICAL_LEFT)
+		pending_start_line = start_line;
+}
+
+bool rppicomidi::Mono_graphics::take_hw_scroll(Ssd1306::Scroll_cfg& cfg)
+{
+	if (!hw_scroll_pending)
+		return false;
+	cfg = hw_scroll;
+	hw_scroll_pending = false;
+	return true;
+}
+
+void rppicomidi::Mono_graphics::merge_dirty(Mono_graphics& band)
+{
+	assert(band.parent == this);
+	for (uint8_t page = 0; page < num_pages; page++) {
+		if (band.dirty_first_col[page] > band.dirty_last_col[page])
+			continue;
+		if (dirty_first_col[page] > dirty_last_col[page]) {
+			++num_dirty_pages;
+			dirty_first_col[page] = band.dirty_first_col[page];
+			dirty_last_col[page] = band.dirty_last_col[page];
+		}
+		else {
+			if (band.dirty_first_col[page] < dirty_first_col[page])
+				dirty_first_col[page] = band.dirty_first_col[page];
+			if (band.dirty_last_col[page] > dirty_last_col[page])
+				dirty_last_col[page] = band.dirty_last_col[page];
+		}
+	}
+	band.clear_dirty();
+}
+
+bool rppicomidi::Mono_graphics::render_dirty()
+{
+	assert(!parent);
+	if (!is_dirty())
+		return true;
+	if (trace)
+		trace->record(Draw_trace::Op::RENDER);
+	bool success = true;
+	if (hw_scroll_pending)
+		success = display->stop_scroll();
+	if (success && pending_start_line >= 0)
+		success = display->set_start_line(take_start_line());
+	for (uint8_t page = 0; page < num_pages && success; page++) {
+		if (!is_page_held(page) && dirty_first_col[page] <= dirty_last_col[page])
+			success = display->write_canvas_span(canvas, canvas_nbytes, page, dirty_first_col[page], dirty_last_col[page]);
+	}
+	clear_dirty();
+	// Start the scroll after its pages are in the display memory
+	Ssd1306::Scroll_cfg cfg;
+	if (take_hw_scroll(cfg) && success && cfg.active)
+		success = display->set_scroll(cfg);
+	return success;
+}
+
+void rppicomidi::Mono_graphics::draw_dot(uint8_t x, uint8_t y, Pixel_state fg_color)
+{
+	if (trace)
+		trace->record(Draw_trace::Op::DOT, x, y, Draw_trace::pack_colors(fg_color, Pixel_state::PIXEL_TRANSPARENT));
+	if (mark_dirty(x, y, x, y))
+		plot_dot(x, y, fg_color);
 }
 
 void rppicomidi::Mono_graphics::draw_line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, Pixel_state fg_color)
 {
+	if (trace)
+		trace->record(Draw_trace::Op::LINE, x0, y0, x1, y1, Draw_trace::pack_colors(fg_color, Pixel_state::PIXEL_TRANSPARENT));
+	if (mark_dirty(x0, y0, x1, y1))
+		plot_line(x0, y0, x1, y1, fg_color);
+}
+
+void rppicomidi::Mono_graphics::plot_line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, Pixel_state fg_color)
+{
+	if (x0 == x1 || y0 == y1) {
+		// Horizontal and vertical lines only need to visit the part inside the
+		// clipping rectangle. This is most of the work of filled shapes.
+		int first, last;
+		if (y0 == y1) {
+			if (y0 < clip_rect.y_upper_left || y0 > clip_rect.y_lower_right)
+				return;
+			first = x0 < x1 ? x0 : x1;
+			last = x0 < x1 ? x1 : x0;
+			if (first < clip_rect.x_upper_left)
+				first = clip_rect.x_upper_left;
+			if (last > clip_rect.x_lower_right)
+				last = clip_rect.x_lower_right;
+			for (int x = first; x <= last; x++)
+				display->set_pixel_on_canvas(canvas, canvas_nbytes, x, y0, fg_color);
+		}
+		else {
+			if (x0 < clip_rect.x_upper_left || x0 > clip_rect.x_lower_right)
+				return;
+			first = y0 < y1 ? y0 : y1;
+			last = y0 < y1 ? y1 : y0;
+			if (first < clip_rect.y_upper_left)
+				first = clip_rect.y_upper_left;
+			if (last > clip_rect.y_lower_right)
+				last = clip_rect.y_lower_right;
+			for (int y = first; y <= last; y++)
+				display->set_pixel_on_canvas(canvas, canvas_nbytes, x0, y, fg_color);
+		}
+		return;
+	}
 	// Uses Bresenham's line algorithm as described in Wikipedia
 	int dx = abs(x1-x0);
 	int sx = (x0<x1) ? 1 : -1;
@@ -59,7 +334,7 @@ void rppicomidi::Mono_graphics::draw_line(uint8_t x0, uint8_t y0, uint8_t x1, ui
 	int sy = (y0<y1) ? 1 : -1;
 	int err = dx+dy; // error value e_xy
 	while(true) {
-		draw_dot(x0, y0, fg_color);
+		plot_dot(x0, y0, fg_color);
 		if (x0 == x1 && y0 == y1) {
 			break; //done
 		}
@@ -77,27 +352,57 @@ void rppicomidi::Mono_graphics::draw_line(uint8_t x0, uint8_t y0, uint8_t x1, ui
 
 void rppicomidi::Mono_graphics::draw_rectangle(uint8_t x0, uint8_t y0, uint8_t width, uint8_t height, Pixel_state fg_color, Pixel_state bg_color)
 {
+	if (trace)
+		trace->record(Draw_trace::Op::RECTANGLE, x0, y0, width, height, Draw_trace::pack_colors(fg_color, bg_color));
+	if (!mark_dirty(x0, y0, x0 + width - 1, y0 + height - 1))
+		return;
 	uint8_t x1 = x0 + width - 1;
 	uint8_t y1 = y0 + height - 1;
-	draw_line(x0,y0, x1, y0, fg_color); // top of the rectangle
-	draw_line(x0,y1, x1, y1, fg_color); // bottom of the rectangle
-	draw_line(x0,y0, x0, y1, fg_color); // left edge
-	draw_line(x1,y0, x1, y1, fg_color); // right edge
+	plot_line(x0,y0, x1, y0, fg_color); // top of the rectangle
+	plot_line(x0,y1, x1, y1, fg_color); // bottom of the rectangle
+	plot_line(x0,y0, x0, y1, fg_color); // left edge
+	plot_line(x1,y0, x1, y1, fg_color); // right edge
 	if (bg_color != Pixel_state::PIXEL_TRANSPARENT) {
-		// fill the rectangle using horizontal lines
-		++x0;
-		--x1;
-		if (x0 <= x1) {
-			++y0;
-			for (uint8_t y = y0; y < y1; y++)
-				draw_line(x0,y, x1, y, bg_color);
+		// fill the rectangle using horizontal lines; only the part inside
+		// the clipping rectangle changes anything, so only draw that part.
+		// Use int so a 1 pixel wide rectangle at x = 0 does not wrap to a
+		// fill across the whole screen.
+		int fill_x0 = x0 + 1;
+		int fill_x1 = x1 - 1;
+		int fill_y0 = y0 + 1;
+		int fill_y1 = y1 - 1;
+		if (fill_x0 < clip_rect.x_upper_left)
+			fill_x0 = clip_rect.x_upper_left;
+		if (fill_x1 > clip_rect.x_lower_right)
+			fill_x1 = clip_rect.x_lower_right;
+		if (fill_y0 < clip_rect.y_upper_left)
+			fill_y0 = clip_rect.y_upper_left;
+		if (fill_y1 > clip_rect.y_lower_right)
+			fill_y1 = clip_rect.y_lower_right;
+		if (fill_x0 <= fill_x1) {
+			for (int y = fill_y0; y <= fill_y1; y++)
+				plot_line(fill_x0, y, fill_x1, y, bg_color);
 		}
 	}
 }
 
 void rppicomidi::Mono_graphics::draw_character(const MonoMonoFont& font, uint8_t x, uint8_t y, char chr,  Pixel_state fg_color, Pixel_state bg_color)
+{
+	if (trace)
+		trace->record_character(font, x, y, chr, fg_color, bg_color);
+	if (mark_dirty(x, y, x + font.width - 1, y + font.height - 1))
+		plot_character(font, x, y, chr, fg_color, bg_color);
+}
+
+void rppicomidi::Mono_graphics::plot_character(const MonoMonoFont& font, uint8_t x, uint8_t y, char chr,  Pixel_state fg_color, Pixel_state bg_color)
 {
 	assert(chr <= font.last_char && chr >= font.first_char);
+	// Skip characters of a string that are all outside the clipping rectangle
+	// unless they wrap around to the other side of the screen
+	if (x + font.width <= UINT8_MAX + 1 && y + font.height <= UINT8_MAX + 1 &&
+			(x > clip_rect.x_lower_right || y > clip_rect.y_lower_right ||
+			x + font.width <= clip_rect.x_upper_left || y + font.height <= clip_rect.y_upper_left))
+		return;
 
 	uint8_t nrows = font.height;
 	uint8_t ncols = font.width;
@@ -113,7 +418,7 @@ void rppicomidi::Mono_graphics::draw_character(const MonoMonoFont& font, uint8_t
 		uint8_t ypixel = y;
 		uint8_t column_byte = 0;
 		for (uint8_t row = 0; row < nrows; row++) {
-			draw_dot(xpixel, ypixel, (rowbits & mask)!= 0 ? fg_color : bg_color);
+			plot_dot(xpixel, ypixel, (rowbits & mask)!= 0 ? fg_color : bg_color);
             if (font.msb_is_top)
 			    mask >>= 1;
             else
@@ -133,36 +438,197 @@ void rppicomidi::Mono_graphics::draw_character(const MonoMonoFont& font, uint8_t
     }
 }
 
+void rppicomidi::Mono_graphics::draw_sprite(uint8_t x, uint8_t y, const Mono_sprite& sprite)
+{
+	if (trace)
+		trace->record_sprite(x, y, sprite);
+	if (mark_dirty(x, y, x + sprite.width - 1, y + sprite.height - 1))
+		plot_sprite(x, y, sprite);
+}
+
+// Return the bits of old after they are drawn with fill
+static inline uint64_t get_fill_bits(uint64_t old, rppicomidi::Pixel_state fill)
+{
+	switch (fill) {
+		case rppicomidi::Pixel_state::PIXEL_ZERO:
+			return 0;
+		case rppicomidi::Pixel_state::PIXEL_ONE:
+			return UINT64_MAX;
+		case rppicomidi::Pixel_state::PIXEL_XOR:
+			return ~old;
+		default:
+			return old;
+	}
+}
+
+void rppicomidi::Mono_graphics::scroll(uint8_t x, uint8_t y, uint8_t width, uint8_t height, int8_t dx, int8_t dy, Pixel_state fill)
+{
+	if (trace)
+		trace->record_scroll(x, y, width, height, dx, dy, fill);
+	if (width == 0 || height == 0)
+		return;
+	// Only the part inside the clipping rectangle moves. Unlike drawing, a
+	// rectangle that runs past coordinate 255 does not wrap around.
+	int x0 = x > clip_rect.x_upper_left ? x : clip_rect.x_upper_left;
+	int y0 = y > clip_rect.y_upper_left ? y : clip_rect.y_upper_left;
+	int x1 = x + width - 1 < clip_rect.x_lower_right ? x + width - 1 : clip_rect.x_lower_right;
+	int y1 = y + height - 1 < clip_rect.y_lower_right ? y + height - 1 : clip_rect.y_lower_right;
+	if (x0 > x1 || y0 > y1)
+		return;
+	mark_dirty(x0, y0, x1, y1);
+
+	// Work in display memory terms: columns are bytes and bits run across pages.
+	// The canvas layouts of the 180 and 270 degree rotations are the same as
+	// those of the 0 and 90 degree rotations.
+	bool portrait = display->is_portrait_rotation();
+	int first_col = portrait ? y0 : x0;
+	int last_col = portrait ? y1 : x1;
+	int first_bit = portrait ? x0 : y0;
+	int last_bit = portrait ? x1 : y1;
+	int dcol = portrait ? dy : dx;
+	int dbit = portrait ? dx : dy;
+	size_t col_stride = portrait ? num_pages : 1;
+	size_t page_stride = portrait ? 1 : display->get_num_columns();
+	uint8_t first_page = first_bit / 8;
+	uint8_t last_page = last_bit / 8;
+	int ncols = last_col - first_col + 1;
+	int nbits = last_bit - first_bit + 1;
+
+	if (dbit == 0 && first_bit % 8 == 0 && last_bit % 8 == 7 && (!portrait || (first_page == 0 && last_page == num_pages - 1))) {
+		// Whole bytes move along the columns. In a landscape rotation each page
+		// is a row of bytes; in a portrait rotation all pages of a column are.
+		int nmoved = ncols - (dcol < 0 ? -dcol : dcol);
+		int first_exposed = first_col;
+		if (nmoved > 0) {
+			int dst = dcol > 0 ? first_col + dcol : first_col;
+			int src = dst - dcol;
+			if (portrait) {
+				memmove(canvas + dst*col_stride, canvas + src*col_stride, nmoved*num_pages);
+			}
+			else {
+				for (uint8_t page = first_page; page <= last_page; page++)
+					memmove(canvas + page*page_stride + dst, canvas + page*page_stride + src, nmoved);
+			}
+			if (dcol < 0)
+				first_exposed = first_col + nmoved;
+		}
+		else {
+			nmoved = 0;
+		}
+		for (int col = first_exposed; col < first_exposed + ncols - nmoved; col++) {
+			for (uint8_t page = first_page; page <= last_page; page++) {
+				uint8_t& byte = canvas[page*page_stride + col*col_stride];
+				byte = static_cast<uint8_t>(get_fill_bits(byte, fill));
+			}
+		}
+		return;
+	}
+
+	// Each column of up to 8 pages is one 64-bit word with page 0 in the low byte
+	auto get_column = [&](int col) {
+		uint64_t bits = 0;
+		const uint8_t* bytes = canvas + col*col_stride;
+		for (uint8_t page = first_page; page <= last_page; page++)
+			bits |= static_cast<uint64_t>(bytes[page*page_stride]) << (page*8);
+		return bits;
+	};
+	uint64_t region = (nbits == 64 ? UINT64_MAX : (UINT64_C(1) << nbits) - 1) << first_bit;
+	// The bits of the region whose source is also in the region
+	uint64_t moved = 0;
+	if (dbit > -nbits && dbit < nbits)
+		moved = dbit >= 0 ? region & (region << dbit) : region & (region >> -dbit);
+	// Visit the columns in the order that reads each one before it is written
+	int step = dcol > 0 ? -1 : 1;
+	int col = dcol > 0 ? last_col : first_col;
+	for (int n = 0; n < ncols; n++, col += step) {
+		uint64_t dst = get_column(col);
+		uint64_t exposed = region;
+		uint64_t bits = dst & ~region;
+		int src_col = col - dcol;
+		if (moved != 0 && src_col >= first_col && src_col <= last_col) {
+			uint64_t src = src_col == col ? dst : get_column(src_col);
+			bits |= (dbit >= 0 ? src << dbit : src >> -dbit) & moved;
+			exposed &= ~moved;
+		}
+		bits |= get_fill_bits(dst, fill) & exposed;
+		uint8_t* bytes = canvas + col*col_stride;
+		for (uint8_t page = first_page; page <= last_page; page++)
+			bytes[page*page_stride] = static_cast<uint8_t>(bits >> (page*8));
+	}
+}
+
+void rppicomidi::Mono_graphics::plot_sprite(uint8_t x, uint8_t y, const Mono_sprite& sprite)
+{
+	if (sprite.width == 0 || sprite.height == 0)
+		return;
+	const uint8_t* mask = sprite.mask ? sprite.mask : sprite.bits;
+	int num_sprite_pages = (sprite.height + 7) / 8;
+	Display_rotation rotation = display->get_display_rotation();
+	bool is_landscape = rotation == Display_rotation::Landscape0 || rotation == Display_rotation::Landscape180;
+	if (is_landscape && x >= clip_rect.x_upper_left && x + sprite.width - 1 <= clip_rect.x_lower_right &&
+			y >= clip_rect.y_upper_left && y + sprite.height - 1 <= clip_rect.y_lower_right) {
+		// The sprite and the canvas have the same layout, so each sprite byte
+		// lands in at most two canvas bytes in the same column
+		uint8_t screen_width = display->get_screen_width();
+		uint8_t shift = y % 8;
+		for (int page = 0; page < num_sprite_pages; page++) {
+			const uint8_t* src_bits = sprite.bits + page * sprite.width;
+			const uint8_t* src_mask = mask + page * sprite.width;
+			uint8_t* dest = canvas + (y / 8 + page) * screen_width + x;
+			for (int col = 0; col < sprite.width; col++) {
+				uint16_t col_mask = src_mask[col] << shift;
+				uint16_t col_bits = (src_bits[col] & src_mask[col]) << shift;
+				dest[col] = (dest[col] & ~col_mask) | col_bits;
+				// Mask bits only exist inside the sprite, so the next page is on the canvas
+				if (col_mask >> 8)
+					dest[col + screen_width] = (dest[col + screen_width] & ~(col_mask >> 8)) | (col_bits >> 8);
+			}
+		}
+		return;
+	}
+	// Coordinates wrap like the other drawing functions, so a sprite that
+	// starts above or left of the screen shows its lower right part
+	for (int col = 0; col < sprite.width; col++) {
+		for (int row = 0; row < sprite.height; row++) {
+			int idx = (row / 8) * sprite.width + col;
+			uint8_t bit = 1 << (row % 8);
+			if (mask[idx] & bit)
+				plot_dot(static_cast<uint8_t>(x + col), static_cast<uint8_t>(y + row), (sprite.bits[idx] & bit) ? Pixel_state::PIXEL_ONE : Pixel_state::PIXEL_ZERO);
+		}
+	}
+}
+
 void rppicomidi::Mono_graphics::circle_points(int cx, int cy, int x, int y, Pixel_state fg_color, Pixel_state fill_color)
 {
 	if (x == 0) {
-		draw_dot(cx, cy + y, fg_color);
-		draw_dot(cx, cy - y, fg_color);
-		draw_dot(cx + y, cy, fg_color);
-		draw_dot(cx - y, cy, fg_color);
-		draw_line(cx-y+1,cy, cx+y-1, cy, fill_color);
+		plot_dot(cx, cy + y, fg_color);
+		plot_dot(cx, cy - y, fg_color);
+		plot_dot(cx + y, cy, fg_color);
+		plot_dot(cx - y, cy, fg_color);
+		if (y > 0) // a radius 0 circle has no inside to fill
+			plot_line(cx-y+1,cy, cx+y-1, cy, fill_color);
 	}
 	else if (x == y) {
-		draw_dot(cx + x, cy + y, fg_color);
-		draw_dot(cx - x, cy + y, fg_color);
-		draw_line(cx-x+1,cy+y, cx+x-1, cy+y, fill_color);
-		draw_dot(cx + x, cy - y, fg_color);
-		draw_dot(cx - x, cy - y, fg_color);
-		draw_line(cx-x+1,cy-y, cx+x-1, cy-y, fill_color);
+		plot_dot(cx + x, cy + y, fg_color);
+		plot_dot(cx - x, cy + y, fg_color);
+		plot_line(cx-x+1,cy+y, cx+x-1, cy+y, fill_color);
+		plot_dot(cx + x, cy - y, fg_color);
+		plot_dot(cx - x, cy - y, fg_color);
+		plot_line(cx-x+1,cy-y, cx+x-1, cy-y, fill_color);
 	}
 	else if (x < y) {
-		draw_dot(cx + x, cy + y, fg_color);
-		draw_dot(cx - x, cy + y, fg_color);
-		draw_line(cx-x+1,cy+y, cx+x-1, cy+y, fill_color);
-		draw_dot(cx + x, cy - y, fg_color);
-		draw_dot(cx - x, cy - y, fg_color);
-		draw_line(cx-x+1,cy-y, cx+x-1, cy-y, fill_color);
-		draw_dot(cx + y, cy + x, fg_color);
-		draw_dot(cx - y, cy + x, fg_color);
-		draw_line(cx-y+1,cy+x, cx+y-1, cy+x, fill_color);
-		draw_dot(cx + y, cy - x, fg_color);
-		draw_dot(cx - y, cy - x, fg_color);
-		draw_line(cx-y+1,cy-x, cx+y-1, cy-x, fill_color);
+		plot_dot(cx + x, cy + y, fg_color);
+		plot_dot(cx - x, cy + y, fg_color);
+		plot_line(cx-x+1,cy+y, cx+x-1, cy+y, fill_color);
+		plot_dot(cx + x, cy - y, fg_color);
+		plot_dot(cx - x, cy - y, fg_color);
+		plot_line(cx-x+1,cy-y, cx+x-1, cy-y, fill_color);
+		plot_dot(cx + y, cy + x, fg_color);
+		plot_dot(cx - y, cy + x, fg_color);
+		plot_line(cx-y+1,cy+x, cx+y-1, cy+x, fill_color);
+		plot_dot(cx + y, cy - x, fg_color);
+		plot_dot(cx - y, cy - x, fg_color);
+		plot_line(cx-y+1,cy-x, cx+y-1, cy-x, fill_color);
 	}
 }
 
@@ -176,6 +642,10 @@ void rppicomidi::Mono_graphics::draw_circle(uint8_t x0, uint8_t y0, uint8_t diam
 
 void rppicomidi::Mono_graphics::draw_centered_circle(uint8_t x_center, uint8_t y_center, uint8_t radius, Pixel_state fg_color, Pixel_state fill_color)
 {
+	if (trace)
+		trace->record(Draw_trace::Op::CIRCLE, x_center, y_center, radius, Draw_trace::pack_colors(fg_color, fill_color));
+	if (!mark_dirty(x_center - radius, y_center - radius, x_center + radius, y_center + radius))
+		return;
 	int x = 0;
 	int y = radius;
 	int p = (5 - radius*4)/4;
@@ -32,6 +32,7 @@
 #include <cstdint>
 #include <cstring>
 #include "ssd1306.h"
+#include "draw_trace.h"
 #include "assert.h"
 namespace rppicomidi {
 
@@ -43,6 +44,21 @@ struct Rectangle {
     uint8_t x_upper_left, y_upper_left, x_lower_right, y_lower_right;
 };
 
+/**
+ * @brief a small bitmap image stored in the same page layout as a landscape canvas
+ *
+ * Byte page*width + x holds rows page*8 through page*8+7 of column x with the
+ * top row in the LSB. Pixels with a 1 in mask are set to the value of the same
+ * bit in bits and the other pixels are left alone. If mask is nullptr, the 1
+ * bits are drawn as PIXEL_ONE and the 0 bits are transparent. Mask bits below
+ * the last row of the sprite must be 0.
+ */
+struct Mono_sprite {
+    uint8_t width, height;
+    const uint8_t* bits;
+    const uint8_t* mask;
+};
+
 /**
  * @brief Monospace Monochrome font
  *
@@ -86,6 +102,26 @@ public:
      */
     Mono_graphics(Ssd1306* display_, Display_rotation initial_rotation_);
 
+    /**
+     * @brief Construct a band of another Mono_graphics object's canvas
+     *
+     * A band draws on the canvas of parent_ but only on display memory pages
+     * first_page_ through last_page_; drawing outside them is clipped. Bands
+     * that share no pages can draw at the same time on different cores with
+     * no locking because they never write the same canvas byte. A band does
+     * not send anything to the display; call the parent's merge_dirty() to
+     * add what the band drew to the parent's dirty spans.
+     *
+     * @param parent_ the Mono_graphics object that owns the canvas
+     * @param first_page_ the first display memory page of the band
+     * @param last_page_ the last display memory page of the band
+     */
+    Mono_graphics(Mono_graphics& parent_, uint8_t first_page_, uint8_t last_page_);
+    ~Mono_graphics();
+
+    Mono_graphics(const Mono_graphics&) = delete;
+    Mono_graphics& operator=(const Mono_graphics&) = delete;
+
     /**
      * @brief Set the clipping rectangle to the rectangle with the upper
      * left and lower right coordinates
@@ -96,10 +132,13 @@ public:
         assert(x_lower_right < display->get_screen_width());
         assert(y_upper_left < display->get_screen_height());
         assert(y_lower_right < display->get_screen_height());
-        clip_rect.x_upper_left = x_upper_left;
-	    clip_rect.y_upper_left = y_upper_left;
-	    clip_rect.x_lower_right = x_lower_right;
-	    clip_rect.y_lower_right = y_lower_right;
+        // A band's clipping rectangle never leaves the band. It may be empty.
+        clip_rect.x_upper_left = x_upper_left > band_rect.x_upper_left ? x_upper_left : band_rect.x_upper_left;
+	    clip_rect.y_upper_left = y_upper_left > band_rect.y_upper_left ? y_upper_left : band_rect.y_upper_left;
+	    clip_rect.x_lower_right = x_lower_right < band_rect.x_lower_right ? x_lower_right : band_rect.x_lower_right;
+	    clip_rect.y_lower_right = y_lower_right < band_rect.y_lower_right ? y_lower_right : band_rect.y_lower_right;
+        if (trace)
+            trace->record(Draw_trace::Op::SET_CLIP_RECT, x_upper_left, y_upper_left, x_lower_right, y_lower_right);
     }
 
     /**
@@ -123,9 +162,16 @@ public:
     /**
      * @brief set every byte in the canvas buffer to 0
      * 
+     * A band only clears its own pages.
      */
     inline void clear_canvas() {
-        memset(canvas, 0, canvas_nbytes);
+        if (trace)
+            trace->record(Draw_trace::Op::CLEAR_CANVAS);
+        if (parent)
+            clear_band();
+        else
+            memset(canvas, 0, canvas_nbytes);
+        mark_dirty(0, 0, get_screen_width()-1, get_screen_height()-1, true);
     }
 
     /**
@@ -183,6 +229,36 @@ public:
      */
     void draw_centered_circle(uint8_t x_center, uint8_t y_center, uint8_t radius, Pixel_state fg_color, Pixel_state fill_color=Pixel_state::PIXEL_TRANSPARENT);
 
+    /**
+     * @brief draw a sprite with its upper left corner at (x,y)
+     *
+     * If the display is in a landscape rotation and the sprite is entirely
+     * inside the clipping rectangle, the sprite is copied to the canvas a byte
+     * at a time. Otherwise, it is drawn one pixel at a time.
+     */
+    void draw_sprite(uint8_t x, uint8_t y, const Mono_sprite& sprite);
+
+    /**
+     * @brief move the pixels inside a rectangle of the screen by (dx, dy)
+     *
+     * Only the part of the rectangle inside the clipping rectangle moves.
+     * Pixels that move out of it are lost, and the strip the pixels moved
+     * away from is drawn with fill, so only that strip has to be drawn again.
+     * Moves along display memory columns copy whole bytes (one memmove per
+     * page if the rectangle covers whole pages); moves across pages shift
+     * each column of the canvas as one 64-bit word.
+     *
+     * @param x the left edge of the rectangle
+     * @param y the top edge of the rectangle
+     * @param width the width of the rectangle
+     * @param height the height of the rectangle
+     * @param dx the number of pixels to move right; negative moves left
+     * @param dy the number of pixels to move down; negative moves up
+     * @param fill how to draw the exposed strip. PIXEL_TRANSPARENT leaves the
+     * pixels that were there.
+     */
+    void scroll(uint8_t x, uint8_t y, uint8_t width, uint8_t height, int8_t dx, int8_t dy, Pixel_state fill=Pixel_state::PIXEL_ZERO);
+
     /**
      * @brief draw a single character to the screen based on the pixel_state.
      * 
@@ -210,8 +286,12 @@ public:
      */
     void draw_string(const MonoMonoFont& font, uint8_t x, uint8_t y, const char* str, size_t len, Pixel_state fg_color, Pixel_state bg_color) {
         assert(strlen(str) <= len);
+        if (trace)
+            trace->record_string(font, x, y, str, len, fg_color, bg_color);
+        if (!mark_dirty(x, y, x + len*font.width - 1, y + font.height - 1))
+            return;
         while (len--) {
-            draw_character(font, x, y, *str++, fg_color, bg_color);
+            plot_character(font, x, y, *str++, fg_color, bg_color);
             x+=font.width;
         }
     }
@@ -221,21 +301,203 @@ public:
      * 
      */
     inline void render() {
+        if (hw_scroll.active || hw_scroll_pending) {
+            // Writing all of the display memory would write the scrolling pages too
+            mark_dirty(0, 0, get_screen_width()-1, get_screen_height()-1, true);
+            render_dirty();
+            return;
+        }
+        if (trace)
+            trace->record(Draw_trace::Op::RENDER);
+        assert(!parent);
+        if (pending_start_line >= 0)
+            display->set_start_line(take_start_line());
         assert(display->write_display_mem(canvas, canvas_nbytes));
+        clear_dirty();
     }
 
+    /**
+     * @brief write only the parts of the canvas drawn since the last render
+     * to the display memory
+     *
+     * Every draw_* call and clear_canvas() marks the part of the screen it
+     * covered, clipped to the clipping rectangle, as dirty. The marks are
+     * kept as one span of columns for each display memory page, so marks on
+     * the same page merge into the span that covers them all. If you change
+     * the canvas another way, call invalidate_rect() for the changed part.
+     * The pages of a running hardware scroll are kept dirty and sent after
+     * stop_hw_scroll().
+     *
+     * @return true if successful, false otherwise
+     */
+    bool render_dirty();
+
+    /**
+     * @brief mark a rectangle of the screen dirty so render_dirty() sends it
+     */
+    inline void invalidate_rect(uint8_t x, uint8_t y, uint8_t width, uint8_t height) {
+        if (width != 0 && height != 0)
+            mark_dirty(x, y, x + width - 1, y + height - 1, true);
+    }
+
+    /**
+     * @brief return true if any part of the canvas that can be sent now is
+     * dirty or a start line or hardware scroll change is waiting to be sent
+     */
+    inline bool is_dirty() const {
+        return pending_start_line >= 0 || hw_scroll_pending ||
+            (num_dirty_pages != 0 && (!hw_scroll.active || has_unheld_dirty_page()));
+    }
+
+    /**
+     * @brief scroll the display by setting the display memory row shown at
+     * the top of the screen; see Ssd1306::set_start_line()
+     *
+     * The command is sent by the next render() or render_dirty(), before the
+     * canvas changes, so a widget can change the start line and draw the rows
+     * that scroll in during the same frame. Drawing coordinates are display
+     * memory coordinates, so screen row r shows canvas row (r + line) modulo
+     * Ssd1306::num_display_mem_rows. The canvas only wraps around with the
+     * display if it is that high.
+     */
+    inline void set_start_line(uint8_t line) {
+        assert(!parent);
+        if (line != start_line) {
+            start_line = line;
+            pending_start_line = line;
+        }
+    }
+    inline uint8_t get_start_line() const { return start_line; }
+
+    /**
+     * @brief return the start line set since the last render and forget it, or
+     * return -1 if there is none. Use with take_dirty().
+     */
+    inline int16_t take_start_line() {
+        int16_t line = pending_start_line;
+        pending_start_line = -1;
+        return line;
+    }
+
+    /**
+     * @brief start the display's continuous scroll of a range of display
+     * memory pages or change its settings; see Ssd1306::set_scroll()
+     *
+     * The command is sent by the next render() or render_dirty() after the
+     * dirty parts of the scrolled pages, so the display scrolls what the
+     * canvas shows. While the pages scroll, drawing on them still changes
+     * the canvas, but their dirty spans are held back until stop_hw_scroll()
+     * because the display would put the bytes in the wrong columns. The
+     * other pages are sent as usual.
+     *
+     * @param cfg the scroll settings; cfg.active is ignored
+     */
+    void start_hw_scroll(const Ssd1306::Scroll_cfg& cfg);
+
+    /**
+     * @brief stop the display's continuous scroll
+     *
+     * The next render() or render_dirty() stops the scroll and sends the
+     * scrolled pages again so the display shows the canvas.
+     */
+    void stop_hw_scroll();
+    inline bool is_hw_scrolling() const { return hw_scroll.active; }
+
+    /**
+     * @brief copy the hardware scroll settings changed since the last render
+     * to cfg and forget the change, or return false if there is none
+     *
+     * Use with take_dirty() and call it after take_dirty(). To send the
+     * change, stop the display's scroll, send the dirty spans and then call
+     * Ssd1306::set_scroll() if cfg.active is true.
+     */
+    bool take_hw_scroll(Ssd1306::Scroll_cfg& cfg);
+
+    /**
+     * @brief copy the dirty column span of each display memory page to
+     * first_col and last_col and clear the dirty marks
+     *
+     * Use this instead of render_dirty() to send the canvas some other way,
+     * for example from the other core. A clean page gets first > last, and
+     * so does a page that is held back by a running hardware scroll.
+     *
+     * @param first_col an array of get_num_pages() bytes
+     * @param last_col an array of get_num_pages() bytes
+     * @return the number of dirty pages
+     */
+    uint8_t take_dirty(uint8_t* first_col, uint8_t* last_col);
+
+    /**
+     * @brief add the dirty spans of a band of this object's canvas to this
+     * object's dirty spans and clear the band's dirty spans
+     */
+    void merge_dirty(Mono_graphics& band);
+
+    inline bool is_band() const { return parent != nullptr; }
+    inline const Rectangle& get_clip_rect() const { return clip_rect; }
+    inline const uint8_t* get_canvas() const { return canvas; }
+    inline size_t get_canvas_nbytes() const { return canvas_nbytes; }
+    inline uint8_t get_num_pages() const { return num_pages; }
+    inline Ssd1306* get_display() { return display; }
+
     /**
      * @brief Get the display rotation object
      * 
      * @return Display_rotation 
      */
     inline Display_rotation get_display_rotation() {return display->get_display_rotation(); }
+
+    /**
+     * @brief record every drawing call to a trace buffer
+     *
+     * @param trace_ the trace recorder or nullptr to stop recording
+     */
+    inline void set_trace(Draw_trace* trace_) { trace = trace_; }
 private:
+    Mono_graphics* parent;  // the owner of the canvas if this is a band; otherwise nullptr
     Ssd1306* display;
     uint8_t* canvas;
     size_t canvas_nbytes;
+    Draw_trace* trace;
+    uint8_t num_pages;
+    uint8_t start_line;
+    int16_t pending_start_line; // the start line to send or -1
+    Ssd1306::Scroll_cfg hw_scroll;
+    bool hw_scroll_pending;     // true if hw_scroll changed since the last render
+    uint8_t num_dirty_pages;
+    uint8_t* dirty_first_col;  // dirty columns of each display memory page; first > last if clean
+    uint8_t* dirty_last_col;
     void circle_points(int cx, int cy, int x, int y, Pixel_state bg_color, Pixel_state fill_color);
     Rectangle clip_rect;
+    Rectangle band_rect;    // the screen area of the band or the whole screen
+
+    // The plot_* functions do the drawing work for the public draw_* functions.
+    // Drawing functions use them internally so only the outermost call is traced.
+    inline void plot_dot(uint8_t x, uint8_t y, Pixel_state fg_color) {
+        // only draw the dot if x and y are within the clipping rectangle
+        if (x >= clip_rect.x_upper_left && x <= clip_rect.x_lower_right &&
+            y >= clip_rect.y_upper_left && y <= clip_rect.y_lower_right) {
+            display->set_pixel_on_canvas(canvas, canvas_nbytes, x, y, fg_color);
+        }
+    }
+    void plot_line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, Pixel_state fg_color);
+
+    // Mark the screen rectangle with corners (x0,y0) and (x1,y1) dirty. Drawing
+    // outside 0-255 wraps around, so then the whole clipping rectangle is marked.
+    // If ignore_clip is true, the rectangle is clipped to the band (usually the
+    // whole screen) instead. Returns false if none of the rectangle is visible,
+    // so the drawing functions can skip drawing it.
+    bool mark_dirty(int x0, int y0, int x1, int y1, bool ignore_clip=false);
+    // Clear the dirty marks of every page that is not held back by a running hardware scroll
+    void clear_dirty();
+    void clear_band();
+    inline bool is_page_held(uint8_t page) const {
+        return hw_scroll.active && !hw_scroll_pending && page >= hw_scroll.first_page && page <= hw_scroll.last_page;
+    }
+    bool has_unheld_dirty_page() const;
+    void mark_pages_dirty(uint8_t first_page, uint8_t last_page);
+    void plot_sprite(uint8_t x, uint8_t y, const Mono_sprite& sprite);
+    void plot_character(const MonoMonoFont& font, uint8_t x, uint8_t y, char chr, Pixel_state fg_color, Pixel_state bg_color);
 };
 
 }
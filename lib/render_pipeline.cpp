@@ -0,0 +1,200 @@
+/**
+ * @file render_pipeline.cpp
+ * @brief This class sends the canvas of a Mono_graphics object to its
+ * display from the other RP2040 core.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdlib>
+#include <cstring>
+#include "render_pipeline.h"
+#include "pico/assert.h"
+#if PICO_ON_DEVICE
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+rppicomidi::Render_pipeline* rppicomidi::Render_pipeline::core1_pipeline = nullptr;
+#endif
+
+rppicomidi::Render_pipeline::Render_pipeline(Mono_graphics& screen_) :
+    screen{screen_}, display{screen_.get_display()}, num_pages{screen_.get_num_pages()},
+    published{0}, acquired{no_slot}, taken_seq{0}, running{false}, last_published_seq{0}, last_taken_seq{0},
+    num_published{0}, num_flushed{0}, num_coalesced{0}, last_latency_us{0}, max_latency_us{0}
+{
+    for (auto& slot: slots) {
+        slot.canvas = static_cast<uint8_t*>(malloc(screen.get_canvas_nbytes()));
+        assert(slot.canvas);
+        slot.first_col = static_cast<uint8_t*>(malloc(num_pages));
+        assert(slot.first_col);
+        slot.last_col = static_cast<uint8_t*>(malloc(num_pages));
+        assert(slot.last_col);
+        slot.seq = 0;
+        slot.publish_us = 0;
+        slot.start_line = -1;
+        slot.scroll_changed = false;
+    }
+}
+
+rppicomidi::Render_pipeline::~Render_pipeline()
+{
+    stop();
+    for (auto& slot: slots) {
+        free(slot.canvas);
+        free(slot.first_col);
+        free(slot.last_col);
+    }
+}
+
+bool rppicomidi::Render_pipeline::publish()
+{
+    uint32_t last = published.load();
+    bool carry = last_published_seq != 0 && taken_seq.load() != last_published_seq;
+    if (!screen.is_dirty() && !carry)
+        return false;
+    // Find the slot that is neither the last one published nor the one the flush core holds
+    uint32_t held = acquired.load();
+    uint32_t back = 0;
+    while (back == get_index(last) || back == held)
+        ++back;
+    assert(back < num_slots);
+    Slot& slot = slots[back];
+    memcpy(slot.canvas, screen.get_canvas(), screen.get_canvas_nbytes());
+    screen.take_dirty(slot.first_col, slot.last_col);
+    slot.start_line = screen.take_start_line();
+    slot.scroll_changed = screen.take_hw_scroll(slot.scroll);
+    if (carry) {
+        // The flush core has not taken the last frame yet, and might skip it,
+        // so send its dirty spans, start line and scroll change with this frame too
+        const Slot& prev = slots[get_index(last)];
+        if (slot.start_line < 0)
+            slot.start_line = prev.start_line;
+        if (!slot.scroll_changed && prev.scroll_changed) {
+            slot.scroll_changed = true;
+            slot.scroll = prev.scroll;
+        }
+        for (uint8_t page = 0; page < num_pages; page++) {
+            if (prev.first_col[page] < slot.first_col[page])
+                slot.first_col[page] = prev.first_col[page];
+            if (prev.last_col[page] > slot.last_col[page])
+                slot.last_col[page] = prev.last_col[page];
+        }
+    }
+    slot.seq = ++last_published_seq;
+    if (last_published_seq > (UINT32_MAX >> 2))
+        last_published_seq = slot.seq = 1;
+    slot.publish_us = time_us_32();
+    published.store(slot.seq << 2 | back);
+    ++num_published;
+#if PICO_ON_DEVICE
+    __sev();
+#endif
+    return true;
+}
+
+bool rppicomidi::Render_pipeline::flush()
+{
+    // Hold the newest slot. If the producer published again before it could
+    // see the hold, it may be reusing the slot, so hold the newer one instead.
+    uint32_t newest;
+    do {
+        newest = published.load();
+        if (get_seq(newest) == last_taken_seq)
+            return false;
+        acquired.store(get_index(newest));
+    } while (published.load() != newest);
+    uint32_t seq = get_seq(newest);
+    taken_seq.store(seq);
+    if (seq > last_taken_seq + 1)
+        num_coalesced.store(num_coalesced.load(std::memory_order_relaxed) + seq - last_taken_seq - 1, std::memory_order_relaxed);
+    last_taken_seq = seq;
+
+    const Slot& slot = slots[get_index(newest)];
+    size_t canvas_nbytes = screen.get_canvas_nbytes();
+    if (slot.scroll_changed)
+        display->stop_scroll();
+    if (slot.start_line >= 0)
+        display->set_start_line(slot.start_line);
+    for (uint8_t page = 0; page < num_pages; page++) {
+        if (slot.first_col[page] <= slot.last_col[page])
+            display->write_canvas_span(slot.canvas, canvas_nbytes, page, slot.first_col[page], slot.last_col[page]);
+    }
+    if (slot.scroll_changed && slot.scroll.active)
+        display->set_scroll(slot.scroll);
+    uint32_t latency = time_us_32() - slot.publish_us;
+    last_latency_us.store(latency, std::memory_order_relaxed);
+    if (latency > max_latency_us.load(std::memory_order_relaxed))
+        max_latency_us.store(latency, std::memory_order_relaxed);
+    num_flushed.store(num_flushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return true;
+}
+
+void rppicomidi::Render_pipeline::flush_loop()
+{
+    while (running.load(std::memory_order_relaxed)) {
+        if (!flush()) {
+#if PICO_ON_DEVICE
+            __wfe();
+#else
+            std::this_thread::yield();
+#endif
+        }
+    }
+}
+
+#if PICO_ON_DEVICE
+void rppicomidi::Render_pipeline::core1_entry()
+{
+    core1_pipeline->flush_loop();
+}
+
+void rppicomidi::Render_pipeline::start()
+{
+    assert(core1_pipeline == nullptr);
+    core1_pipeline = this;
+    running = true;
+    multicore_launch_core1(core1_entry);
+}
+
+void rppicomidi::Render_pipeline::stop()
+{
+    if (running && core1_pipeline == this) {
+        running = false;
+        multicore_reset_core1();
+        core1_pipeline = nullptr;
+    }
+}
+#else
+void rppicomidi::Render_pipeline::start()
+{
+    assert(!running);
+    running = true;
+    flush_thread = std::thread(&Render_pipeline::flush_loop, this);
+}
+
+void rppicomidi::Render_pipeline::stop()
+{
+    if (running) {
+        running = false;
+        flush_thread.join();
+    }
+}
+#endif
@@ -0,0 +1,151 @@
+/**
+ * @file render_pipeline.h
+ * @brief This class sends the canvas of a Mono_graphics object to its
+ * display from the other RP2040 core.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Core 0 paints into the Mono_graphics canvas as usual and calls publish()
+ * at the end of each frame instead of render_dirty(). publish() copies the
+ * canvas, its dirty spans and any start line or hardware scroll change to
+ * a free slot of a triple buffer and hands the slot to core 1, which sends the changes of
+ * the newest slot to the display. Neither core ever waits for the other. If core 0 publishes
+ * frames faster than the bus can send them, core 1 skips to the newest one
+ * and the dirty spans of the skipped frames are merged into it.
+ *
+ * The slots are handed over with atomic loads and stores only because the
+ * Cortex-M0+ has no atomic read-modify-write instructions. The producer
+ * never writes the slot it last published or the slot the consumer holds,
+ * which leaves it one of the three. The consumer holds a slot by storing its
+ * index and checking that it is still the published slot.
+ *
+ * When built for the host instead of the RP2040, the flush loop runs in a
+ * std::thread so the handoff can be tested and benchmarked on a PC.
+ */
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include "mono_graphics_lib.h"
+#include "ssd1306.h"
+#include "pico/stdlib.h"
+#if !PICO_ON_DEVICE
+#include <thread>
+#endif
+namespace rppicomidi {
+class Render_pipeline {
+public:
+    static const uint8_t num_slots = 3;
+
+    /**
+     * @brief Construct a new Render_pipeline object
+     *
+     * @param screen_ the graphics object that core 0 draws on. After start(),
+     * do not call its render() or render_dirty() functions because the display
+     * belongs to the flush core.
+     */
+    Render_pipeline(Mono_graphics& screen_);
+    ~Render_pipeline();
+
+    Render_pipeline(const Render_pipeline&) = delete;
+    Render_pipeline& operator=(const Render_pipeline&) = delete;
+
+    /**
+     * @brief start the flush loop on core 1 (on the host, in a new thread)
+     *
+     * @note only one Render_pipeline can run on the RP2040 because it uses all of core 1
+     */
+    void start();
+
+    /**
+     * @brief stop the flush loop
+     */
+    void stop();
+
+    /**
+     * @brief hand the canvas and its dirty spans to the flush core
+     *
+     * Call this from the core that draws on the screen
+     * @return true if a frame was published, false if nothing was dirty
+     */
+    bool publish();
+
+    /**
+     * @brief send the dirty spans of the newest published frame to the display
+     *
+     * The flush loop calls this. Call it directly to flush from a loop of your own.
+     * @return true if a frame was sent, false if there was no new frame
+     */
+    bool flush();
+
+    // Statistics. The producer counts get_num_published(); the flush core counts the rest.
+    uint32_t get_num_published() const { return num_published; }
+    uint32_t get_num_flushed() const { return num_flushed.load(std::memory_order_relaxed); }
+    /**
+     * @brief Get the number of published frames that were merged into a newer frame instead of sent
+     */
+    uint32_t get_num_coalesced() const { return num_coalesced.load(std::memory_order_relaxed); }
+    /**
+     * @brief Get the time from publish() until the frame was sent in microseconds
+     */
+    uint32_t get_last_latency_us() const { return last_latency_us.load(std::memory_order_relaxed); }
+    uint32_t get_max_latency_us() const { return max_latency_us.load(std::memory_order_relaxed); }
+private:
+    struct Slot {
+        uint8_t* canvas;
+        uint8_t* first_col;
+        uint8_t* last_col;
+        uint32_t seq;
+        uint32_t publish_us;
+        int16_t start_line;     // the start line to send first or -1
+        bool scroll_changed;    // true to stop the hardware scroll first and then set it to scroll
+        Ssd1306::Scroll_cfg scroll;
+    };
+    static const uint32_t no_slot = 3;
+    // published holds seq << 2 | slot index; seq 0 means nothing was published yet
+    static uint32_t get_index(uint32_t packed) { return packed & 3; }
+    static uint32_t get_seq(uint32_t packed) { return packed >> 2; }
+    void flush_loop();
+
+    Mono_graphics& screen;
+    Ssd1306* display;
+    uint8_t num_pages;
+    Slot slots[num_slots];
+    std::atomic<uint32_t> published;
+    std::atomic<uint32_t> acquired;     // the index of the slot the flush core holds
+    std::atomic<uint32_t> taken_seq;    // the seq of the last frame the flush core took
+    std::atomic<bool> running;
+    uint32_t last_published_seq;        // only the producer uses this
+    uint32_t last_taken_seq;            // only the flush core uses this
+    uint32_t num_published;
+    std::atomic<uint32_t> num_flushed;
+    std::atomic<uint32_t> num_coalesced;
+    std::atomic<uint32_t> last_latency_us;
+    std::atomic<uint32_t> max_latency_us;
+#if PICO_ON_DEVICE
+    static Render_pipeline* core1_pipeline;
+    static void core1_entry();
+#else
+    std::thread flush_thread;
+#endif
+};
+}
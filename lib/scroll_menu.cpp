@@ -0,0 +1,177 @@
+/**
+ * @file scroll_menu.cpp
+ * @brief This class displays a scrollable list of text items with one
+ * selected item.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdlib>
+#include <cstring>
+#include "scroll_menu.h"
+
+rppicomidi::Scroll_menu::Scroll_menu(Mono_graphics& screen_, uint8_t x_, uint8_t y_, uint8_t width_, uint8_t height_,
+        const MonoMonoFont& font_, Item_text_cb text_cb_, void* context_, uint16_t num_items_) :
+    Widget{screen_, x_, y_, width_, height_}, font{font_}, text_cb{text_cb_}, context{context_},
+    num_items{num_items_}, selected{0}, first{0}, num_rows_drawn{0}, num_text_requests{0}
+{
+    assert(text_cb);
+    assert(num_items < no_item);
+    row_height = (font.height + 7) / 8 * 8;
+    num_rows = height / row_height;
+    assert(num_rows > 0);
+    max_chars = width / font.width;
+    Display_rotation rotation = screen.get_display_rotation();
+    bool is_landscape = rotation == Display_rotation::Landscape0 || rotation == Display_rotation::Landscape180;
+    // The start line scrolls every column of the display, so the menu has
+    // to own the whole screen, and the rows have to tile display memory
+    hardware_scroll = is_landscape && x == 0 && y == 0 && width == screen.get_screen_width() &&
+        height == screen.get_screen_height() && height == Ssd1306::num_display_mem_rows &&
+        height % row_height == 0;
+    rows = reinterpret_cast<Row*>(malloc(num_rows * sizeof(Row)));
+    assert(rows);
+    texts = reinterpret_cast<char*>(malloc(num_rows * (max_chars + 1)));
+    assert(texts);
+    for (uint8_t row = 0; row < num_rows; row++) {
+        rows[row].text_item = no_item;
+        rows[row].drawn_item = no_item;
+        rows[row].drawn_selected = false;
+    }
+    if (hardware_scroll)
+        screen.set_start_line(0);
+    draw();
+}
+
+rppicomidi::Scroll_menu::~Scroll_menu()
+{
+    // Leave the display unscrolled for whatever draws on the screen next
+    if (hardware_scroll)
+        screen.set_start_line(0);
+    free(rows);
+    free(texts);
+}
+
+const char* rppicomidi::Scroll_menu::get_text(uint16_t item)
+{
+    uint8_t row = get_text_row(item);
+    char* text = texts + row * (max_chars + 1);
+    if (rows[row].text_item != item) {
+        ++num_text_requests;
+        const char* item_text = text_cb(item, context);
+        strncpy(text, item_text ? item_text : "", max_chars);
+        text[max_chars] = '\0';
+        rows[row].text_item = item;
+    }
+    return text;
+}
+
+void rppicomidi::Scroll_menu::draw_row(uint8_t row, uint16_t item)
+{
+    uint8_t row_y = y + row * row_height;
+    bool is_selected = item == selected;
+    Pixel_state fg = is_selected ? Pixel_state::PIXEL_ZERO : Pixel_state::PIXEL_ONE;
+    Pixel_state bg = is_selected ? Pixel_state::PIXEL_ONE : Pixel_state::PIXEL_ZERO;
+    screen.draw_rectangle(x, row_y, width, row_height, bg, bg);
+    if (item != no_item) {
+        const char* text = get_text(item);
+        screen.draw_string(font, x, row_y + (row_height - font.height) / 2, text, strlen(text), fg, bg);
+    }
+    rows[row].drawn_item = item;
+    rows[row].drawn_selected = is_selected;
+    ++num_rows_drawn;
+}
+
+void rppicomidi::Scroll_menu::scroll_to_selected()
+{
+    if (selected < first)
+        first = selected;
+    else if (selected >= first + num_rows)
+        first = selected - num_rows + 1;
+    // Do not leave empty rows at the bottom when items are removed
+    if (num_items <= num_rows)
+        first = 0;
+    else if (first > num_items - num_rows)
+        first = num_items - num_rows;
+}
+
+void rppicomidi::Scroll_menu::paint()
+{
+    scroll_to_selected();
+    if (hardware_scroll)
+        screen.set_start_line((first % num_rows) * row_height);
+    for (uint16_t item = first; item < first + num_rows; item++) {
+        uint8_t row = get_draw_row(item);
+        uint16_t shown = item < num_items ? item : no_item;
+        bool is_selected = shown == selected;
+        if (rows[row].drawn_item != shown || rows[row].drawn_selected != is_selected)
+            draw_row(row, shown);
+    }
+}
+
+void rppicomidi::Scroll_menu::draw()
+{
+    for (uint8_t row = 0; row < num_rows; row++)
+        rows[row].drawn_item = no_item - 1;  // not an item and not an empty row
+    paint();
+}
+
+void rppicomidi::Scroll_menu::set_num_items(uint16_t num_items_)
+{
+    assert(num_items_ < no_item);
+    num_items = num_items_;
+    if (selected >= num_items)
+        selected = num_items > 0 ? num_items - 1 : 0;
+    for (uint8_t row = 0; row < num_rows; row++) {
+        rows[row].text_item = no_item;
+        rows[row].drawn_item = no_item - 1;
+    }
+    invalidate();
+}
+
+void rppicomidi::Scroll_menu::invalidate_item(uint16_t item)
+{
+    uint8_t row = get_text_row(item);
+    if (rows[row].text_item == item) {
+        rows[row].text_item = no_item;
+        if (item >= first && item < first + num_rows)
+            rows[get_draw_row(item)].drawn_item = no_item - 1;
+        invalidate();
+    }
+}
+
+void rppicomidi::Scroll_menu::set_selected(uint16_t item)
+{
+    if (item >= num_items)
+        item = num_items > 0 ? num_items - 1 : 0;
+    if (item != selected) {
+        selected = item;
+        invalidate();
+    }
+}
+
+void rppicomidi::Scroll_menu::move_selection(int32_t delta)
+{
+    int32_t item = static_cast<int32_t>(selected) + delta;
+    if (item < 0)
+        item = 0;
+    set_selected(static_cast<uint16_t>(item));
+}
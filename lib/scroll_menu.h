@@ -0,0 +1,160 @@
+/**
+ * @file scroll_menu.h
+ * @brief This class displays a scrollable list of text items with one
+ * selected item.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The menu does not store its items. It asks a callback for the text of
+ * the items it shows and keeps the text of the visible rows only, so a
+ * menu of hundreds of items, such as a MIDI port or preset list, uses the
+ * same memory as a menu of a few. Each row is a whole number of display
+ * memory pages high, and a row is drawn again only if it shows a
+ * different item or its selection state changed.
+ *
+ * If the menu covers the whole screen of a 64-row display in a landscape
+ * rotation, scrolling changes the display start line instead of redrawing
+ * the visible rows.
+ * Each item then has a fixed place in display memory, and only the rows
+ * that scroll in are drawn and sent. Other rotations and smaller menus
+ * draw all of the rows that moved.
+ */
+#pragma once
+#include <cstdint>
+#include "widget.h"
+namespace rppicomidi {
+class Scroll_menu : public Widget
+{
+public:
+    /**
+     * @brief the function that returns the text of an item
+     *
+     * @param item the item index
+     * @param context the context passed to the Scroll_menu constructor
+     * @return a null-terminated string. The menu copies the characters that fit.
+     */
+    typedef const char* (*Item_text_cb)(uint16_t item, void* context);
+
+    static const uint16_t no_item = UINT16_MAX;
+
+    /**
+     * @brief Construct a new Scroll_menu object
+     *
+     * @param screen_ The screen object to render the widget
+     * @param x_ horizontal coordinate of the upper left corner
+     * @param y_ vertical coordinate of the upper left corner
+     * @param width_ width of the menu
+     * @param height_ height of the menu. It should be a multiple of the row height,
+     * which is the font height rounded up to a multiple of 8.
+     * @param font_ the font for the item text
+     * @param text_cb_ the function that returns the text of an item
+     * @param context_ passed to text_cb_
+     * @param num_items_ the number of items
+     */
+    Scroll_menu(Mono_graphics& screen_, uint8_t x_, uint8_t y_, uint8_t width_, uint8_t height_,
+        const MonoMonoFont& font_, Item_text_cb text_cb_, void* context_, uint16_t num_items_);
+    ~Scroll_menu();
+
+    void draw() override;
+    void paint() override;
+
+    /**
+     * @brief change the number of items
+     *
+     * The text of every item is requested again and the selection is
+     * moved to the last item if it is past the end.
+     */
+    void set_num_items(uint16_t num_items_);
+    uint16_t get_num_items() const { return num_items; }
+
+    /**
+     * @brief request the text of an item again because it changed
+     */
+    void invalidate_item(uint16_t item);
+
+    /**
+     * @brief select an item and scroll it into view
+     */
+    void set_selected(uint16_t item);
+
+    /**
+     * @brief move the selection by delta items, for example by an encoder
+     * count change, and stop at the first and the last item
+     */
+    void move_selection(int32_t delta);
+
+    uint16_t get_selected() const { return selected; }
+
+    /**
+     * @brief Get the index of the item in the top row
+     */
+    uint16_t get_first_visible() const { return first; }
+    uint8_t get_num_rows() const { return num_rows; }
+    uint8_t get_row_height() const { return row_height; }
+
+    /**
+     * @brief return true if the menu scrolls with the display start line
+     */
+    bool uses_start_line() const { return hardware_scroll; }
+
+    /**
+     * @brief Get the number of rows drawn since the last reset_counters()
+     */
+    uint32_t get_num_rows_drawn() const { return num_rows_drawn; }
+
+    /**
+     * @brief Get the number of times the menu requested item text since the last reset_counters()
+     */
+    uint32_t get_num_text_requests() const { return num_text_requests; }
+    void reset_counters() { num_rows_drawn = 0; num_text_requests = 0; }
+private:
+    struct Row {
+        uint16_t text_item;     // the item whose text is in the row's text buffer
+        uint16_t drawn_item;    // the item drawn in the row
+        bool drawn_selected;
+    };
+    // The text cache row of an item. The visible items are consecutive, so
+    // they never share a row.
+    uint8_t get_text_row(uint16_t item) const { return item % num_rows; }
+    // The screen row, or the display memory row if the menu uses the start line
+    uint8_t get_draw_row(uint16_t item) const { return hardware_scroll ? item % num_rows : item - first; }
+    const char* get_text(uint16_t item);
+    void draw_row(uint8_t row, uint16_t item);
+    void scroll_to_selected();
+
+    const MonoMonoFont& font;
+    Item_text_cb text_cb;
+    void* context;
+    uint16_t num_items;
+    uint16_t selected;
+    uint16_t first;
+    uint8_t row_height;
+    uint8_t num_rows;
+    uint8_t max_chars;
+    bool hardware_scroll;
+    Row* rows;
+    char* texts;            // num_rows null-terminated strings of up to max_chars characters
+    uint32_t num_rows_drawn;
+    uint32_t num_text_requests;
+};
+}
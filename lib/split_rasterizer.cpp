@@ -0,0 +1,153 @@
+/**
+ * @file split_rasterizer.cpp
+ * @brief This class draws a Draw_trace command list on a Mono_graphics
+ * canvas using both RP2040 cores.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "split_rasterizer.h"
+#include "pico/assert.h"
+#if PICO_ON_DEVICE
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+rppicomidi::Split_rasterizer* rppicomidi::Split_rasterizer::core1_rasterizer = nullptr;
+#endif
+
+rppicomidi::Split_rasterizer::Split_rasterizer(Mono_graphics& screen_, const MonoMonoFont* const* fonts_, uint8_t num_fonts_) :
+    screen{screen_},
+    first_band{screen_, 0, static_cast<uint8_t>(screen_.get_num_pages() / 2 - 1)},
+    second_band{screen_, static_cast<uint8_t>(screen_.get_num_pages() / 2), static_cast<uint8_t>(screen_.get_num_pages() - 1)},
+    whole_band{screen_, 0, static_cast<uint8_t>(screen_.get_num_pages() - 1)},
+    fonts{fonts_}, num_fonts{num_fonts_}, job_trace{nullptr}, job_nbytes{0}, job_nrecords{0},
+    job_seq{0}, done_seq{0}, running{false}, band_us{{0}, {0}}
+{
+}
+
+rppicomidi::Split_rasterizer::~Split_rasterizer()
+{
+    stop();
+}
+
+void rppicomidi::Split_rasterizer::draw_band(Mono_graphics& band_screen, uint8_t band)
+{
+    const Rectangle& clip = screen.get_clip_rect();
+    band_screen.set_clip_rect(clip.x_upper_left, clip.y_upper_left, clip.x_lower_right, clip.y_lower_right);
+    uint32_t start = time_us_32();
+    size_t nrecords = Draw_trace::replay(job_trace, job_nbytes, band_screen, fonts, num_fonts);
+    band_us[band].store(time_us_32() - start, std::memory_order_relaxed);
+    if (band == 1)
+        job_nrecords = nrecords;
+}
+
+size_t rppicomidi::Split_rasterizer::rasterize(const uint8_t* trace, size_t nbytes)
+{
+    job_trace = trace;
+    job_nbytes = nbytes;
+    if (Draw_trace::contains(trace, nbytes, Draw_trace::Op::SCROLL)) {
+        band_us[0].store(0, std::memory_order_relaxed);
+        draw_band(whole_band, 1);
+        screen.merge_dirty(whole_band);
+        return job_nrecords;
+    }
+    if (running) {
+        uint32_t seq = job_seq.load(std::memory_order_relaxed) + 1;
+        job_seq.store(seq);
+#if PICO_ON_DEVICE
+        __sev();
+#endif
+        draw_band(second_band, 1);
+        while (done_seq.load() != seq) {
+#if PICO_ON_DEVICE
+            __wfe();
+#else
+            std::this_thread::yield();
+#endif
+        }
+    }
+    else {
+        draw_band(first_band, 0);
+        draw_band(second_band, 1);
+    }
+    screen.merge_dirty(first_band);
+    screen.merge_dirty(second_band);
+    return job_nrecords;
+}
+
+void rppicomidi::Split_rasterizer::worker_loop()
+{
+    uint32_t seq = done_seq.load(std::memory_order_relaxed);
+    while (running.load(std::memory_order_relaxed)) {
+        if (job_seq.load() == seq) {
+#if PICO_ON_DEVICE
+            __wfe();
+#else
+            std::this_thread::yield();
+#endif
+            continue;
+        }
+        draw_band(first_band, 0);
+        done_seq.store(++seq);
+#if PICO_ON_DEVICE
+        __sev();
+#endif
+    }
+}
+
+#if PICO_ON_DEVICE
+void rppicomidi::Split_rasterizer::core1_entry()
+{
+    core1_rasterizer->worker_loop();
+}
+
+void rppicomidi::Split_rasterizer::start()
+{
+    assert(core1_rasterizer == nullptr);
+    core1_rasterizer = this;
+    running = true;
+    multicore_launch_core1(core1_entry);
+}
+
+void rppicomidi::Split_rasterizer::stop()
+{
+    if (running && core1_rasterizer == this) {
+        running = false;
+        multicore_reset_core1();
+        core1_rasterizer = nullptr;
+    }
+}
+#else
+void rppicomidi::Split_rasterizer::start()
+{
+    assert(!running);
+    running = true;
+    worker_thread = std::thread(&Split_rasterizer::worker_loop, this);
+}
+
+void rppicomidi::Split_rasterizer::stop()
+{
+    if (running) {
+        running = false;
+        worker_thread.join();
+    }
+}
+#endif
@@ -0,0 +1,121 @@
+/**
+ * @file split_rasterizer.h
+ * @brief This class draws a Draw_trace command list on a Mono_graphics
+ * canvas using both RP2040 cores.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The canvas is split into two bands of display memory pages. Core 1
+ * replays the command list on the first band while core 0 replays it on
+ * the second. Each draw call that misses a band is skipped by that band,
+ * and a band never writes a canvas byte of the other band, so the cores
+ * need no locking while they draw. When both are done, the dirty spans of
+ * both bands are merged into the screen's, so one render_dirty() call
+ * sends the whole frame.
+ *
+ * This is worth it for full-screen redraws such as menu transitions, bank
+ * changes and splash animations. Small updates are faster on one core.
+ * A trace with a SCROLL record is drawn on one core because a scroll can
+ * move pixels from one band to the other.
+ *
+ * When built for the host instead of the RP2040, core 1 is a std::thread
+ * so the scaling can be measured on a PC.
+ */
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include "mono_graphics_lib.h"
+#include "draw_trace.h"
+#include "pico/stdlib.h"
+#if !PICO_ON_DEVICE
+#include <thread>
+#endif
+namespace rppicomidi {
+class Split_rasterizer {
+public:
+    static const uint8_t num_bands = 2;
+
+    /**
+     * @brief Construct a new Split_rasterizer object
+     *
+     * @param screen_ the screen to draw on
+     * @param fonts_ the font table of the traces as described in Draw_trace::replay()
+     * @param num_fonts_ the number of entries in fonts_
+     */
+    Split_rasterizer(Mono_graphics& screen_, const MonoMonoFont* const* fonts_, uint8_t num_fonts_);
+    ~Split_rasterizer();
+
+    /**
+     * @brief start the band worker on core 1 (on the host, in a new thread)
+     *
+     * @note The worker uses all of core 1, so it cannot run at the same
+     * time as a Render_pipeline. Until start() is called, rasterize()
+     * draws both bands on the calling core.
+     */
+    void start();
+
+    /**
+     * @brief stop the band worker
+     */
+    void stop();
+
+    /**
+     * @brief draw every complete record in trace[0:nbytes-1] on the screen
+     *
+     * The bands start with the screen's clipping rectangle. Clipping rectangle
+     * changes in the trace only apply while it is drawn.
+     *
+     * @return the number of records drawn
+     */
+    size_t rasterize(const uint8_t* trace, size_t nbytes);
+
+    /**
+     * @brief Get the time the last rasterize() call spent drawing a band in microseconds
+     */
+    uint32_t get_band_us(uint8_t band) const { assert(band < num_bands); return band_us[band].load(std::memory_order_relaxed); }
+private:
+    void draw_band(Mono_graphics& band_screen, uint8_t band);
+    void worker_loop();
+
+    Mono_graphics& screen;
+    Mono_graphics first_band;       // core 1 draws this band
+    Mono_graphics second_band;      // the caller's core draws this band
+    Mono_graphics whole_band;       // all pages, for traces that must be drawn on one core
+    const MonoMonoFont* const* fonts;
+    uint8_t num_fonts;
+    // The current job. The caller writes these before it stores job_seq.
+    const uint8_t* job_trace;
+    size_t job_nbytes;
+    size_t job_nrecords;
+    std::atomic<uint32_t> job_seq;
+    std::atomic<uint32_t> done_seq;
+    std::atomic<bool> running;
+    std::atomic<uint32_t> band_us[num_bands];
+#if PICO_ON_DEVICE
+    static Split_rasterizer* core1_rasterizer;
+    static void core1_entry();
+#else
+    std::thread worker_thread;
+#endif
+};
+}
@@ -38,6 +38,10 @@
 
 #define SET_DISP_START_LINE(first) (0x40+(first)) /* where first is 0-63 */
 
+#define SET_VERT_SCROLL_AREA 0xA3 /* follow this byte by 2 bytes: the number of fixed rows at the top & the number of scrolled rows */
+#define DEACTIVATE_SCROLL 0x2E  /* stop scrolling; rewrite the scrolled display memory afterwards */
+#define ACTIVATE_SCROLL 0x2F    /* start scrolling as set up by the last scroll setup command */
+
 #define SET_CONTRAST 0x81   /* follow this byte by 1 byte: the contrast value 0-0xFF */
 #define SET_SEGMENT_REMAP(remap) ((remap)?0xA1:0xA0) /* remap is true to map col 127 to SEG0, false to map col 0 to SEG0 */
 #define SET_ENTIRE_ON 0xA4  /* make the pixels follow the display memory */
@@ -69,7 +73,8 @@
 
 rppicomidi::Ssd1306::Ssd1306(Ssd1306hw* port_, Com_pin_cfg com_pin_cfg_, uint8_t landscape_width_, uint8_t landscape_height_, uint8_t first_column_, uint8_t first_page_)
     : port{port_}, com_pin_cfg{com_pin_cfg_}, landscape_width{landscape_width_}, landscape_height{landscape_height_},
-  first_column{first_column_}, first_page{first_page_}, num_pages{static_cast<uint8_t>(landscape_height_/8)}, contrast{255}
+  first_column{first_column_}, first_page{first_page_}, num_pages{static_cast<uint8_t>(landscape_height_/8)}, contrast{255},
+  scrolling{false}
 {
 }
 
@@ -126,6 +131,7 @@ bool rppicomidi::Ssd1306::init(Display_rotation rotation_)
     uint8_t init_commands[] = {
         // total number of bytes in command followed by all of the bytes
         1, SET_DISP_OFF,
+        1, DEACTIVATE_SCROLL,
         2, SET_MEM_ADDR_MODE, addr_mode,
         1, SET_DISP_START_LINE(0),
         1, remap_cmd,
@@ -147,6 +153,7 @@ bool rppicomidi::Ssd1306::init(Display_rotation rotation_)
         nbytes = init_commands[idx++];
         success = port->write_command(init_commands+idx, nbytes);
     }
+    scrolling = false;
     return success;
 }
 
@@ -157,6 +164,52 @@ bool rppicomidi::Ssd1306::set_contrast(uint8_t contrast_)
     return port->write_command(cmd, sizeof(cmd));
 }
 
+bool rppicomidi::Ssd1306::set_start_line(uint8_t line)
+{
+    assert(line < 64);
+    uint8_t cmd[] = {static_cast<uint8_t>(SET_DISP_START_LINE(line))};
+    return port->write_command(cmd, sizeof(cmd));
+}
+
+bool rppicomidi::Ssd1306::set_scroll(const Scroll_cfg& cfg)
+{
+    // The datasheet requires stopping the scroll before setting it up again
+    if (!stop_scroll())
+        return false;
+    if (!cfg.active)
+        return true;
+    assert(cfg.first_page <= cfg.last_page && cfg.last_page < num_pages);
+    bool success;
+    if (cfg.dir == Scroll_dir::RIGHT || cfg.dir == Scroll_dir::LEFT) {
+        const uint8_t cmd_list[] = {
+            7, static_cast<uint8_t>(cfg.dir), 0, cfg.first_page, static_cast<uint8_t>(cfg.interval), cfg.last_page, 0, 0xFF,
+            1, ACTIVATE_SCROLL,
+        };
+        success = write_command_list(cmd_list, sizeof(cmd_list));
+    }
+    else {
+        assert(cfg.first_vertical_row + cfg.num_vertical_rows <= landscape_height);
+        assert(cfg.vertical_offset < cfg.num_vertical_rows);
+        const uint8_t cmd_list[] = {
+            3, SET_VERT_SCROLL_AREA, cfg.first_vertical_row, cfg.num_vertical_rows,
+            6, static_cast<uint8_t>(cfg.dir), 0, cfg.first_page, static_cast<uint8_t>(cfg.interval), cfg.last_page, cfg.vertical_offset,
+            1, ACTIVATE_SCROLL,
+        };
+        success = write_command_list(cmd_list, sizeof(cmd_list));
+    }
+    scrolling = success;
+    return success;
+}
+
+bool rppicomidi::Ssd1306::stop_scroll()
+{
+    uint8_t cmd[] = {DEACTIVATE_SCROLL};
+    bool success = port->write_command(cmd, sizeof(cmd));
+    if (success)
+        scrolling = false;
+    return success;
+}
+
 bool rppicomidi::Ssd1306::set_display_rotation(rppicomidi::Display_rotation rotation_)
 {
     rotation = rotation_;
@@ -191,6 +244,32 @@ bool rppicomidi::Ssd1306::write_display_mem(const uint8_t* buffer, size_t nbytes
     return success;
 }
 
+bool rppicomidi::Ssd1306::write_canvas_span(const uint8_t* canvas, size_t nbytes_in_canvas, uint8_t page, uint8_t col,
+    uint8_t last_col)
+{
+    assert(canvas);
+    assert(page < num_pages);
+    assert(col <= last_col && last_col < landscape_width);
+    assert(nbytes_in_canvas >= get_minimum_canvas_size());
+    // write_display_mem() treats equal first and last addresses as "to the end",
+    // so set the address window here
+    const uint8_t cmd_list[] = {
+        3, SET_PAGE_ADDR, page, page,
+        3, SET_COL_ADDR, col, last_col,
+    };
+    if (!write_command_list(cmd_list, sizeof(cmd_list)))
+        return false;
+    uint8_t nbytes = last_col - col + 1;
+    if (!is_portrait)
+        return port->write_data(canvas + page*landscape_width + col, nbytes);
+    // In vertical address mode, each column of the window is one byte
+    // from a different canvas row
+    uint8_t span[nbytes];
+    for (uint8_t idx = 0; idx < nbytes; idx++)
+        span[idx] = canvas[page + (col + idx)*num_pages];
+    return port->write_data(span, nbytes);
+}
+
 bool rppicomidi::Ssd1306::clear_display_mem()
 {
     uint8_t canvas[num_pages * landscape_width];
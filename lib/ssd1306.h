@@ -106,6 +106,43 @@ public:
         ALT_EN=0x32,  /* alternate COM pin configuration & enable COM Left/Right Remp */
     };
 
+    /**
+     * @enum class Scroll_dir defines the continuous scroll setup command.
+     * Horizontal scrolling moves the display memory bytes of the scrolled
+     * pages one column each step and wraps them around. In Landscape180 the
+     * screen moves the other way, and in portrait rotations the pages are
+     * columns of the screen that scroll up or down.
+     */
+    enum class Scroll_dir {
+        RIGHT=0x26,             /* scroll toward higher display memory columns */
+        LEFT=0x27,              /* scroll toward lower display memory columns */
+        VERTICAL_RIGHT=0x29,    /* scroll RIGHT and move the vertical scroll area vertical_offset rows each step */
+        VERTICAL_LEFT=0x2A,     /* scroll LEFT and move the vertical scroll area vertical_offset rows each step */
+    };
+
+    /**
+     * @enum class Scroll_interval defines the number of display frames
+     * between scroll steps
+     */
+    enum class Scroll_interval {
+        FRAMES_5=0, FRAMES_64=1, FRAMES_128=2, FRAMES_256=3,
+        FRAMES_3=4, FRAMES_4=5, FRAMES_25=6, FRAMES_2=7,
+    };
+
+    /**
+     * @brief the settings of the display's continuous scroll
+     */
+    struct Scroll_cfg {
+        bool active;                // false if the display does not scroll
+        uint8_t first_page;         // the first display memory page that scrolls horizontally
+        uint8_t last_page;          // the last display memory page that scrolls horizontally
+        Scroll_dir dir;
+        Scroll_interval interval;
+        uint8_t vertical_offset;    // rows per step for the VERTICAL_ directions; 0 otherwise
+        uint8_t first_vertical_row; // the vertical scroll area for the VERTICAL_ directions
+        uint8_t num_vertical_rows;
+    };
+
     /**
      * @brief Construct a new Ssd1306_common object
      * 
@@ -148,6 +185,22 @@ public:
     bool write_display_mem(const uint8_t* buffer, size_t nbytes, 
         uint8_t col=0, uint8_t page=0, uint8_t last_page=0, uint8_t last_col=0);
 
+    /**
+     * @brief write part of one page of a canvas to the same place in the display memory
+     *
+     * In a landscape rotation the bytes are contiguous in the canvas. In a
+     * portrait rotation they are gathered from the canvas columns first.
+     *
+     * @param canvas the canvas buffer; see set_pixel_on_canvas() for its layout
+     * @param nbytes_in_canvas the canvas size in bytes
+     * @param page the display memory page 0 to num_pages-1
+     * @param col the first display memory column to write
+     * @param last_col the last display memory column to write
+     * @return true if the write was successful
+     * @return false if the write failed
+     */
+    bool write_canvas_span(const uint8_t* canvas, size_t nbytes_in_canvas, uint8_t page, uint8_t col, uint8_t last_col);
+
     /**
      * @brief set every byte of the display memory to 0
      *
@@ -183,6 +236,50 @@ public:
      */
     bool set_contrast(uint8_t contrast=255);
 
+    /**
+     * @brief set the display memory row shown on the first row the display scans
+     *
+     * The display shows rows line to 63 and then wraps around to row 0,
+     * so changing the start line scrolls the whole display without
+     * rewriting the display memory. In landscape rotations, the rows are
+     * the screen's y coordinates; in portrait rotations, they are its x
+     * coordinates. The display memory has num_display_mem_rows rows even if
+     * the display has fewer, so on such a display the rows that scroll in
+     * are ones this class never writes.
+     *
+     * @param line the display memory row 0-63
+     */
+    bool set_start_line(uint8_t line);
+    static const uint8_t num_display_mem_rows = 64;
+
+    /**
+     * @brief set up the display's continuous scroll and start it, or stop it
+     *
+     * Once started, the display scrolls on its own with no bus traffic until
+     * it is stopped. Scrolling rewrites the display memory of the scrolled
+     * pages, so bytes written to those pages while they scroll land in the
+     * wrong columns, and the pages must be rewritten after scrolling stops.
+     * Writing the other pages is safe. Mono_graphics::start_hw_scroll()
+     * takes care of both.
+     *
+     * @param cfg the scroll settings. If cfg.active is false, this only stops
+     * scrolling.
+     * @return true if successful, false otherwise
+     */
+    bool set_scroll(const Scroll_cfg& cfg);
+
+    /**
+     * @brief stop the continuous scroll
+     *
+     * @return true if successful, false otherwise
+     */
+    bool stop_scroll();
+
+    /**
+     * @brief return true if the continuous scroll is running
+     */
+    inline bool is_scrolling() const { return scrolling; }
+
     /**
      * @brief set the display rotation
      * 
@@ -227,6 +324,18 @@ public:
     inline uint8_t get_screen_height() {return is_portrait?landscape_width:landscape_height; }
 
     inline size_t get_minimum_canvas_size() {return num_pages * landscape_width; }
+
+    /**
+     * @brief Get the number of display memory pages and columns. These do not
+     * depend on the rotation.
+     */
+    inline uint8_t get_num_pages() {return num_pages; }
+    inline uint8_t get_num_columns() {return landscape_width; }
+
+    /**
+     * @brief Return true if the current rotation is Portrait90 or Portrait270
+     */
+    inline bool is_portrait_rotation() {return is_portrait; }
 protected: // protected and not private because you may want to base SH1106 on this class
     Ssd1306hw* port;
     Com_pin_cfg com_pin_cfg;
@@ -238,6 +347,7 @@ protected: // protected and not private because you may want to base SH1106 on t
     uint8_t contrast;
     Display_rotation rotation;
     bool is_portrait;
+    bool scrolling;
     void get_rotation_constants(uint8_t& remap_cmd, uint8_t& com_dir_cmd, uint8_t& addr_mode);
     bool write_command_list(const uint8_t* cmd_list, size_t cmd_list_len);
 };
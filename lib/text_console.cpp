@@ -0,0 +1,233 @@
+/**
+ * @file text_console.cpp
+ * @brief This class implements a terminal-style text console with a
+ * cursor, line wrap and scrolling.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdlib>
+#include <cstring>
+#include "text_console.h"
+
+rppicomidi::Text_console::Text_console(Mono_graphics& screen_, uint8_t x_, uint8_t y_, uint8_t width_, uint8_t height_,
+        const MonoMonoFont& font_) :
+    Widget{screen_, x_, y_, width_, height_}, font{font_}, first_row{0}, cursor_col{0}, cursor_row{0},
+    num_scrolls{0}, cursor_visible{false}, redraw{false}, num_cells_drawn{0}
+{
+    num_cols = width / font.width;
+    num_rows = height / font.height;
+    assert(num_cols > 0 && num_rows > 0);
+    dirty_bytes_per_row = (num_cols + 7) / 8;
+    Display_rotation rotation = screen.get_display_rotation();
+    bool is_landscape = rotation == Display_rotation::Landscape0 || rotation == Display_rotation::Landscape180;
+    // The start line scrolls every column of the display, so the console has
+    // to own the whole screen, and the rows have to tile display memory
+    hardware_scroll = is_landscape && x == 0 && y == 0 && width == screen.get_screen_width() &&
+        height == screen.get_screen_height() && height == Ssd1306::num_display_mem_rows &&
+        font.height % 8 == 0 && num_rows * font.height == height;
+    cells = reinterpret_cast<char*>(malloc(num_rows * num_cols));
+    assert(cells);
+    dirty = reinterpret_cast<uint8_t*>(malloc(num_rows * dirty_bytes_per_row));
+    assert(dirty);
+    blank = reinterpret_cast<bool*>(malloc(num_rows * sizeof(bool)));
+    assert(blank);
+    memset(cells, ' ', num_rows * num_cols);
+    draw();
+}
+
+rppicomidi::Text_console::~Text_console()
+{
+    // Leave the display unscrolled for whatever draws on the screen next
+    if (hardware_scroll)
+        screen.set_start_line(0);
+    free(cells);
+    free(dirty);
+    free(blank);
+}
+
+void rppicomidi::Text_console::mark_cursor_dirty()
+{
+    if (cursor_visible)
+        mark_dirty(get_ring_row(cursor_row), cursor_col < num_cols ? cursor_col : num_cols - 1);
+}
+
+void rppicomidi::Text_console::new_line()
+{
+    mark_cursor_dirty();
+    cursor_col = 0;
+    if (cursor_row + 1 < num_rows) {
+        ++cursor_row;
+    }
+    else {
+        // The top row becomes the new bottom row. The canvas shows it
+        // blank after paint() scrolls, or after paint() blanks it in display
+        // memory if the console uses the start line.
+        uint8_t row = first_row;
+        first_row = get_ring_row(1);
+        memset(cells + row * num_cols, ' ', num_cols);
+        memset(dirty + row * dirty_bytes_per_row, 0, dirty_bytes_per_row);
+        blank[row] = hardware_scroll;
+        if (num_scrolls < num_rows)
+            ++num_scrolls;
+    }
+    mark_cursor_dirty();
+    invalidate();
+}
+
+void rppicomidi::Text_console::put_char(char chr)
+{
+    switch (chr) {
+        case '\n':
+            new_line();
+            break;
+        case '\r':
+            set_cursor(0, cursor_row);
+            break;
+        case '\b':
+            if (cursor_col > 0)
+                set_cursor(cursor_col - 1, cursor_row);
+            break;
+        default:
+        {
+            if (chr < font.first_char || chr > font.last_char)
+                chr = font.first_char;
+            // Wrap when the next character arrives so a line that exactly fills
+            // the row followed by '\n' does not leave a blank line
+            if (cursor_col == num_cols)
+                new_line();
+            uint8_t row = get_ring_row(cursor_row);
+            char& cell = cells[row * num_cols + cursor_col];
+            if (cell != chr) {
+                cell = chr;
+                mark_dirty(row, cursor_col);
+            }
+            mark_cursor_dirty();
+            ++cursor_col;
+            mark_cursor_dirty();
+            invalidate();
+            break;
+        }
+    }
+}
+
+void rppicomidi::Text_console::print(const char* str)
+{
+    assert(str);
+    while (*str)
+        put_char(*str++);
+}
+
+void rppicomidi::Text_console::clear()
+{
+    memset(cells, ' ', num_rows * num_cols);
+    first_row = 0;
+    cursor_col = 0;
+    cursor_row = 0;
+    redraw = true;
+    invalidate();
+}
+
+void rppicomidi::Text_console::set_cursor(uint8_t col, uint8_t row)
+{
+    assert(col < num_cols && row < num_rows);
+    if (col != cursor_col || row != cursor_row) {
+        mark_cursor_dirty();
+        cursor_col = col;
+        cursor_row = row;
+        mark_cursor_dirty();
+        invalidate();
+    }
+}
+
+void rppicomidi::Text_console::show_cursor(bool visible)
+{
+    if (visible != cursor_visible) {
+        cursor_visible = true;
+        mark_cursor_dirty();
+        cursor_visible = visible;
+        invalidate();
+    }
+}
+
+void rppicomidi::Text_console::draw_cell(uint8_t ring_row, uint8_t col)
+{
+    // With the start line, each ring row has a fixed place in display memory
+    uint8_t row = hardware_scroll ? ring_row : (ring_row + num_rows - first_row) % num_rows;
+    bool inverted = cursor_visible && ring_row == get_ring_row(cursor_row) &&
+        col == (cursor_col < num_cols ? cursor_col : num_cols - 1);
+    screen.draw_character(font, x + col * font.width, y + row * font.height, cells[ring_row * num_cols + col],
+        inverted ? Pixel_state::PIXEL_ZERO : Pixel_state::PIXEL_ONE, inverted ? Pixel_state::PIXEL_ONE : Pixel_state::PIXEL_ZERO);
+    ++num_cells_drawn;
+}
+
+void rppicomidi::Text_console::draw()
+{
+    screen.draw_rectangle(x, y, width, height, Pixel_state::PIXEL_ZERO, Pixel_state::PIXEL_ZERO);
+    if (hardware_scroll)
+        screen.set_start_line(first_row * font.height);
+    // The canvas is blank now, so only the other cells need drawing
+    memset(dirty, 0, num_rows * dirty_bytes_per_row);
+    memset(blank, 0, num_rows * sizeof(bool));
+    for (uint8_t row = 0; row < num_rows; row++) {
+        for (uint8_t col = 0; col < num_cols; col++) {
+            if (cells[row * num_cols + col] != ' ')
+                mark_dirty(row, col);
+        }
+    }
+    mark_cursor_dirty();
+    num_scrolls = 0;
+    redraw = false;
+    paint();
+}
+
+void rppicomidi::Text_console::paint()
+{
+    if (redraw || num_scrolls * font.height > INT8_MAX) {
+        draw();
+        return;
+    }
+    if (num_scrolls > 0) {
+        if (hardware_scroll)
+            screen.set_start_line(first_row * font.height);
+        else
+            screen.scroll(x, y, num_cols * font.width, num_rows * font.height, 0, -num_scrolls * font.height);
+        num_scrolls = 0;
+    }
+    for (uint8_t row = 0; row < num_rows; row++) {
+        if (blank[row]) {
+            screen.draw_rectangle(x, y + row * font.height, num_cols * font.width, font.height,
+                Pixel_state::PIXEL_ZERO, Pixel_state::PIXEL_ZERO);
+            blank[row] = false;
+        }
+        uint8_t* row_dirty = dirty + row * dirty_bytes_per_row;
+        for (uint8_t idx = 0; idx < dirty_bytes_per_row; idx++) {
+            for (uint8_t bits = row_dirty[idx]; bits != 0; bits &= bits - 1) {
+                uint8_t bit = 0;
+                while (!(bits & (1 << bit)))
+                    ++bit;
+                draw_cell(row, idx * 8 + bit);
+            }
+            row_dirty[idx] = 0;
+        }
+    }
+}
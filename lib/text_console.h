@@ -0,0 +1,151 @@
+/**
+ * @file text_console.h
+ * @brief This class implements a terminal-style text console with a
+ * cursor, line wrap and scrolling.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * The console is a grid of character cells, for example 21 x 8 cells of a
+ * 6 x 8 font on a 128 x 64 screen. Printing only stores characters in the
+ * grid and sets one dirty bit per changed cell, so it costs the same for
+ * each character no matter how big the grid is. The next frame draws the
+ * dirty cells only, so only those are sent to the display. Blank cells hold
+ * ' ', and the console assumes the font draws ' ' with no pixels on.
+ *
+ * The rows are a ring buffer: scrolling up a line reuses the top row as
+ * the new bottom row. If the console covers the whole screen of a 64-row
+ * display in a landscape rotation and the font is a whole number of
+ * display memory pages high, each row has a fixed place in display memory
+ * and scrolling changes the display start line, so only the new line is
+ * drawn. Otherwise, scrolling moves the console's part of the canvas with
+ * Mono_graphics::scroll().
+ */
+#pragma once
+#include <cstdint>
+#include "widget.h"
+namespace rppicomidi {
+class Text_console : public Widget {
+public:
+    /**
+     * @brief Construct a new Text_console object
+     *
+     * The console has as many rows and columns of cells as fit in the
+     * rectangle.
+     *
+     * @param screen_ The screen object to render the console
+     * @param x_ horizontal coordinate of the upper left corner
+     * @param y_ vertical coordinate of the upper left corner
+     * @param width_ width of the console in pixels
+     * @param height_ height of the console in pixels
+     * @param font_ the font for all of the cells
+     */
+    Text_console(Mono_graphics& screen_, uint8_t x_, uint8_t y_, uint8_t width_, uint8_t height_,
+        const MonoMonoFont& font_);
+    ~Text_console();
+
+    /**
+     * @brief write one character at the cursor and move the cursor
+     *
+     * '\n' moves the cursor to the start of the next line, '\r' to the start
+     * of the line and '\b' one cell back. A character that does not fit on
+     * the line wraps to the next one. Moving down from the last line scrolls
+     * the console up a line. Characters the font does not have are written
+     * as the font's first character.
+     */
+    void put_char(char chr);
+
+    /**
+     * @brief write a null-terminated string with put_char()
+     */
+    void print(const char* str);
+
+    /**
+     * @brief blank every cell and move the cursor to the upper left cell
+     */
+    void clear();
+
+    /**
+     * @brief move the cursor to a cell
+     *
+     * @param col the column 0 to get_num_cols()-1
+     * @param row the row 0 to get_num_rows()-1
+     */
+    void set_cursor(uint8_t col, uint8_t row);
+
+    /**
+     * @brief show or hide the cursor. A shown cursor inverts the cell it is on.
+     */
+    void show_cursor(bool visible);
+
+    uint8_t get_num_cols() const { return num_cols; }
+    uint8_t get_num_rows() const { return num_rows; }
+    uint8_t get_cursor_row() const { return cursor_row; }
+    // After the last column is written, this is get_num_cols() until the next character wraps
+    uint8_t get_cursor_col() const { return cursor_col; }
+
+    /**
+     * @brief return true if the console scrolls with the display start line
+     */
+    bool uses_start_line() const { return hardware_scroll; }
+
+    /**
+     * @brief draw the whole console
+     */
+    void draw() override;
+
+    /**
+     * @brief scroll the screen by the lines the console scrolled since the
+     * last paint and draw the dirty cells
+     */
+    void paint() override;
+
+    /**
+     * @brief Get the number of cells draw() and paint() drew
+     */
+    uint32_t get_num_cells_drawn() const { return num_cells_drawn; }
+private:
+    const MonoMonoFont& font;
+    uint8_t num_cols;
+    uint8_t num_rows;
+    uint8_t dirty_bytes_per_row;
+    char* cells;            // num_rows rows of num_cols characters in ring order
+    uint8_t* dirty;         // one bit for each cell that differs from the canvas
+    bool* blank;            // true for each row to blank before drawing its dirty cells
+    uint8_t first_row;      // the ring row at the top of the console
+    uint8_t cursor_col;
+    uint8_t cursor_row;
+    uint8_t num_scrolls;    // the number of lines scrolled since the last paint 0 to num_rows
+    bool hardware_scroll;
+    bool cursor_visible;
+    bool redraw;            // true to draw the whole console in the next paint
+    uint32_t num_cells_drawn;
+
+    uint8_t get_ring_row(uint8_t row) const { return (first_row + row) % num_rows; }
+    void mark_dirty(uint8_t ring_row, uint8_t col) {
+        dirty[ring_row * dirty_bytes_per_row + col / 8] |= 1 << (col % 8);
+    }
+    void mark_cursor_dirty();
+    void new_line();
+    void draw_cell(uint8_t ring_row, uint8_t col);
+};
+}
@@ -0,0 +1,174 @@
+/**
+ * @file timer_wheel.cpp
+ * @brief This class implements a hashed timer wheel that runs many
+ * software timers from one hardware alarm.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdlib>
+#include <new>
+#include "timer_wheel.h"
+
+rppicomidi::Timer_wheel::Timer_wheel(uint32_t tick_us_, uint8_t log2_num_slots) :
+    tick_us{tick_us_}, slot_mask{(1u << log2_num_slots) - 1}, num_pending{0}, alarm_id{0}, alarm_tick{0}, due{false}
+{
+    assert(tick_us > 0 && log2_num_slots < 16);
+    slots = reinterpret_cast<Timer*>(malloc((slot_mask + 1) * sizeof(Timer)));
+    assert(slots);
+    for (uint32_t idx = 0; idx <= slot_mask; idx++) {
+        Timer* head = new (&slots[idx]) Timer(nullptr, nullptr);
+        head->next = head;
+        head->prev = head;
+    }
+    last_tick = get_current_tick();
+}
+
+rppicomidi::Timer_wheel::~Timer_wheel()
+{
+    if (alarm_id > 0)
+        cancel_alarm(alarm_id);
+    free(slots);
+}
+
+int64_t rppicomidi::Timer_wheel::alarm_callback(alarm_id_t, void* user_data)
+{
+    auto wheel = reinterpret_cast<Timer_wheel*>(user_data);
+    wheel->due = true;
+    __sev(); // wake the main loop if it is waiting in __wfe()
+    return 0;
+}
+
+void rppicomidi::Timer_wheel::link(Timer& timer)
+{
+    Timer* head = &slots[timer.expiry_tick & slot_mask];
+    timer.next = head->next;
+    timer.prev = head;
+    head->next->prev = &timer;
+    head->next = &timer;
+    ++num_pending;
+}
+
+void rppicomidi::Timer_wheel::unlink(Timer& timer)
+{
+    timer.prev->next = timer.next;
+    timer.next->prev = timer.prev;
+    timer.next = nullptr;
+    timer.prev = nullptr;
+    --num_pending;
+}
+
+void rppicomidi::Timer_wheel::schedule(Timer& timer, uint32_t delay_us)
+{
+    if (timer.is_pending())
+        unlink(timer);
+    // Round the deadline up to a tick boundary so the timer never expires early
+    uint64_t now_us = time_us_64();
+    uint32_t expiry_tick = static_cast<uint32_t>((now_us + delay_us + tick_us - 1) / tick_us);
+    uint32_t current_tick = static_cast<uint32_t>(now_us / tick_us);
+    timer.expiry_tick = (expiry_tick == current_tick) ? current_tick + 1 : expiry_tick;
+    link(timer);
+    set_alarm();
+}
+
+void rppicomidi::Timer_wheel::cancel(Timer& timer)
+{
+    if (timer.is_pending()) {
+        unlink(timer);
+        set_alarm();
+    }
+}
+
+void rppicomidi::Timer_wheel::run()
+{
+    due = false;
+    uint32_t now = get_current_tick();
+    // Visit the slots of the ticks since the last run, but each slot at most once
+    uint32_t tick = (now - last_tick > slot_mask) ? now - slot_mask : last_tick + 1;
+    // Move the expired timers to a list of their own first so that the
+    // callbacks are free to schedule or cancel any timer
+    Timer expired(nullptr, nullptr);
+    expired.next = &expired;
+    expired.prev = &expired;
+    for (; tick != now + 1; tick++) {
+        Timer* head = &slots[tick & slot_mask];
+        Timer* timer = head->next;
+        while (timer != head) {
+            Timer* next = timer->next;
+            if (static_cast<int32_t>(timer->expiry_tick - now) <= 0) {
+                timer->prev->next = timer->next;
+                timer->next->prev = timer->prev;
+                timer->next = &expired;
+                timer->prev = expired.prev;
+                expired.prev->next = timer;
+                expired.prev = timer;
+            }
+            timer = next;
+        }
+    }
+    last_tick = now;
+    while (expired.next != &expired) {
+        Timer* timer = expired.next;
+        unlink(*timer);
+        timer->cb(*timer, timer->context);
+    }
+    set_alarm();
+}
+
+void rppicomidi::Timer_wheel::set_alarm()
+{
+    if (num_pending == 0) {
+        if (alarm_id > 0)
+            cancel_alarm(alarm_id);
+        alarm_id = 0;
+        return;
+    }
+    // Scan the slots in tick order. Once a timer expires on the tick of the
+    // slot being scanned, no later slot can hold an earlier deadline.
+    bool found = false;
+    uint32_t earliest = 0;
+    for (uint32_t idx = 1; idx <= slot_mask + 1; idx++) {
+        uint32_t tick = last_tick + idx;
+        Timer* head = &slots[tick & slot_mask];
+        for (Timer* timer = head->next; timer != head; timer = timer->next) {
+            if (!found || static_cast<int32_t>(timer->expiry_tick - earliest) < 0) {
+                earliest = timer->expiry_tick;
+                found = true;
+            }
+        }
+        if (found && static_cast<int32_t>(earliest - tick) <= 0)
+            break;
+    }
+    if (alarm_id > 0) {
+        if (alarm_tick == earliest)
+            return; // already set for this deadline
+        cancel_alarm(alarm_id);
+    }
+    uint64_t now_tick = time_us_64() / tick_us;
+    uint64_t target_tick = now_tick + static_cast<int32_t>(earliest - static_cast<uint32_t>(now_tick));
+    alarm_tick = earliest;
+    alarm_id = add_alarm_at(from_us_since_boot(target_tick * tick_us), alarm_callback, this, true);
+    if (alarm_id < 0) {
+        // No hardware alarm is free, so make the main loop poll
+        due = true;
+    }
+}
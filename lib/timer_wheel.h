@@ -0,0 +1,117 @@
+/**
+ * @file timer_wheel.h
+ * @brief This class implements a hashed timer wheel that runs many
+ * software timers from one hardware alarm.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Timers are intrusive: the object that needs a deadline owns a
+ * Timer_wheel::Timer, so scheduling never allocates. Each Timer is
+ * linked into the wheel slot for its expiry tick; a slot holds the
+ * timers for every tick that hashes to it, so timers more than one
+ * rotation away stay in the list until their tick comes around.
+ *
+ * One hardware alarm is kept set for the earliest deadline. The alarm
+ * callback only sets a flag and wakes the main loop; the timer callbacks
+ * run from run() in the main loop, so they may draw on the screen. A main
+ * loop that has nothing else to do can sleep with __wfe() until is_due().
+ */
+#pragma once
+#include <cstdint>
+#include "pico/stdlib.h"
+namespace rppicomidi {
+class Timer_wheel {
+public:
+    class Timer {
+    public:
+        /**
+         * @brief the function called when the timer expires. It runs in
+         * Timer_wheel::run() and may schedule the timer again.
+         */
+        typedef void (*Callback)(Timer& timer, void* context);
+
+        Timer(Callback cb_, void* context_) : cb{cb_}, context{context_}, next{nullptr}, prev{nullptr}, expiry_tick{0} {}
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        bool is_pending() const { return prev != nullptr; }
+    private:
+        friend class Timer_wheel;
+        Callback cb;
+        void* context;
+        Timer* next;
+        Timer* prev;            // nullptr if not scheduled
+        uint32_t expiry_tick;
+    };
+
+    /**
+     * @brief Construct a new Timer_wheel object
+     *
+     * @param tick_us_ the timer resolution in microseconds
+     * @param log2_num_slots the wheel has 2^log2_num_slots slots
+     */
+    Timer_wheel(uint32_t tick_us_=10000, uint8_t log2_num_slots=5);
+    ~Timer_wheel();
+
+    /**
+     * @brief schedule timer to expire delay_us microseconds from now,
+     * rounded up to the next tick boundary, and at least one tick from now.
+     * If the timer is already scheduled, it is moved.
+     */
+    void schedule(Timer& timer, uint32_t delay_us);
+
+    /**
+     * @brief stop timer if it is scheduled
+     */
+    void cancel(Timer& timer);
+
+    /**
+     * @brief return true if the alarm fired and run() has work to do
+     */
+    bool is_due() const { return due; }
+
+    /**
+     * @brief call the callbacks of the expired timers and set the alarm
+     * for the next deadline
+     *
+     * @note Call from the main loop when is_due() returns true. Calling it
+     * at other times is harmless.
+     */
+    void run();
+private:
+    static int64_t alarm_callback(alarm_id_t id, void* user_data);
+    uint32_t get_current_tick() const { return static_cast<uint32_t>(time_us_64() / tick_us); }
+    void link(Timer& timer);
+    void unlink(Timer& timer);
+    void set_alarm();
+
+    uint32_t tick_us;
+    uint32_t slot_mask;
+    Timer* slots;               // list heads; only next and prev are used
+    uint32_t last_tick;         // every timer that expired at or before this tick has run
+    uint32_t num_pending;
+    alarm_id_t alarm_id;        // 0 if no alarm is set
+    uint32_t alarm_tick;
+    volatile bool due;
+};
+}
@@ -0,0 +1,126 @@
+/**
+ * @file value_scope.cpp
+ * @brief This class draws a scrolling strip graph of the recent history
+ * of a MIDI value such as a CC, fader or meter.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdlib>
+#include "value_scope.h"
+
+rppicomidi::Value_scope::Value_scope(Mono_graphics& screen_, uint8_t x_, uint8_t y_, uint8_t width_, uint8_t height_,
+        uint16_t max_value_, uint16_t samples_per_column_) :
+    Widget{screen_, x_, y_, width_, height_}, max_value{max_value_}, samples_per_column{samples_per_column_},
+    num_samples{0}, last_value{0}, head{0}, num_filled{0}, num_new{0}, num_columns_drawn{0}
+{
+    assert(width > 0 && height > 0);
+    assert(max_value > 0);
+    columns = reinterpret_cast<Column*>(malloc(width * sizeof(Column)));
+    assert(columns);
+    draw();
+}
+
+rppicomidi::Value_scope::~Value_scope()
+{
+    free(columns);
+}
+
+void rppicomidi::Value_scope::add_sample(uint16_t value)
+{
+    if (value > max_value)
+        value = max_value;
+    if (num_filled == 0) {
+        num_filled = 1;
+        columns[head].min = value;
+        columns[head].max = value;
+    }
+    else if (value < columns[head].min) {
+        columns[head].min = value;
+    }
+    else if (value > columns[head].max) {
+        columns[head].max = value;
+    }
+    last_value = value;
+    invalidate();
+    if (samples_per_column != 0 && ++num_samples >= samples_per_column)
+        advance();
+}
+
+void rppicomidi::Value_scope::advance()
+{
+    if (num_filled == 0)
+        return;
+    // The new column starts at the last value so the graph has no gaps
+    if (++head == width)
+        head = 0;
+    columns[head].min = last_value;
+    columns[head].max = last_value;
+    num_samples = 0;
+    if (num_filled < width)
+        ++num_filled;
+    if (num_new < width)
+        ++num_new;
+    invalidate();
+}
+
+void rppicomidi::Value_scope::clear()
+{
+    num_filled = 0;
+    num_new = 0;
+    num_samples = 0;
+    draw();
+}
+
+void rppicomidi::Value_scope::draw_column(uint8_t age)
+{
+    uint8_t col_x = x + width - 1 - age;
+    screen.draw_line(col_x, y, col_x, y + height - 1, Pixel_state::PIXEL_ZERO);
+    if (age < num_filled) {
+        const Column& column = columns[head >= age ? head - age : head + width - age];
+        screen.draw_line(col_x, get_row(column.max), col_x, get_row(column.min), Pixel_state::PIXEL_ONE);
+    }
+    ++num_columns_drawn;
+}
+
+void rppicomidi::Value_scope::draw()
+{
+    screen.draw_rectangle(x, y, width, height, Pixel_state::PIXEL_ZERO, Pixel_state::PIXEL_ZERO);
+    for (uint8_t age = 0; age < num_filled; age++)
+        draw_column(age);
+    num_new = 0;
+}
+
+void rppicomidi::Value_scope::paint()
+{
+    if (num_new >= width || num_new > INT8_MAX) {
+        draw();
+        return;
+    }
+    // The column that was the newest one in the last paint may have gotten
+    // more samples since, so draw it again along with the new ones
+    if (num_new > 0)
+        screen.scroll(x, y, width, height, -static_cast<int8_t>(num_new), 0, Pixel_state::PIXEL_ZERO);
+    for (int age = num_new; age >= 0; age--)
+        draw_column(age);
+    num_new = 0;
+}
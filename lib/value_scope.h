@@ -0,0 +1,119 @@
+/**
+ * @file value_scope.h
+ * @brief This class draws a scrolling strip graph of the recent history
+ * of a MIDI value such as a CC, fader or meter.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Each column of the graph is one vertical span from the lowest to the
+ * highest value that arrived while the column was the newest one, so an
+ * input that changes faster than the display can draw still shows its full
+ * range. The newest column is at the right edge. When it is full, the
+ * graph moves one column to the left with Mono_graphics::scroll() and only
+ * the new column is drawn, so the cost of a frame does not depend on the
+ * width of the graph.
+ *
+ * The columns are kept in a ring buffer of width entries, so add_sample()
+ * takes the same short time no matter how fast the samples arrive.
+ */
+#pragma once
+#include "widget.h"
+namespace rppicomidi {
+class Value_scope : public Widget {
+public:
+    /**
+     * @brief Construct a new Value_scope object
+     *
+     * @param screen_ The screen object to render the graph
+     * @param x_ horizontal coordinate of the upper left corner
+     * @param y_ vertical coordinate of the upper left corner
+     * @param width_ the number of columns of history
+     * @param height_ the graph height in pixels
+     * @param max_value_ the value drawn at the top row; 127 for a CC,
+     * 16383 for a pitch bend fader, 12 for a Mackie Control meter
+     * @param samples_per_column_ the number of samples that fill a column,
+     * or 0 if only advance() starts a new column
+     */
+    Value_scope(Mono_graphics& screen_, uint8_t x_, uint8_t y_, uint8_t width_, uint8_t height_,
+        uint16_t max_value_=127, uint16_t samples_per_column_=1);
+    ~Value_scope();
+
+    /**
+     * @brief add a value to the newest column
+     *
+     * The graph is drawn in the next frame of the Widget_root. Values greater
+     * than the max_value are drawn as max_value.
+     */
+    void add_sample(uint16_t value);
+
+    /**
+     * @brief start a new column
+     *
+     * Call it at a steady rate, for example from a Timer_wheel timer, to
+     * make the horizontal axis a time axis. A column with no samples holds
+     * the last value. Does nothing before the first sample.
+     */
+    void advance();
+
+    /**
+     * @brief forget the history and blank the graph
+     */
+    void clear();
+
+    /**
+     * @brief draw the whole graph
+     */
+    void draw() override;
+
+    /**
+     * @brief scroll the graph by the number of columns started since the
+     * last paint and draw those columns and the newest one
+     */
+    void paint() override;
+
+    /**
+     * @brief Get the number of columns draw() and paint() drew
+     */
+    uint32_t get_num_columns_drawn() const { return num_columns_drawn; }
+private:
+    struct Column {
+        uint16_t min;
+        uint16_t max;
+    };
+    uint16_t max_value;
+    uint16_t samples_per_column;
+    uint16_t num_samples;       // the number of samples in the newest column
+    uint16_t last_value;
+    Column* columns;            // width entries; the newest is at head
+    uint8_t head;
+    uint8_t num_filled;         // the number of columns with values 0-width
+    uint8_t num_new;            // the number of columns started since the last paint 0-width
+    uint32_t num_columns_drawn;
+
+    // Draw the column age columns left of the newest one
+    void draw_column(uint8_t age);
+    uint8_t get_row(uint16_t value) const {
+        return y + height - 1 - static_cast<uint32_t>(value) * (height - 1) / max_value;
+    }
+};
+}
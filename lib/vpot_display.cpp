@@ -27,29 +27,205 @@
  * SOFTWARE. * 
  */
 
-#include <cmath>
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
-
+#include <array>
+#include <cstdlib>
 #include "vpot_display.h"
 
+namespace {
+using rppicomidi::Pixel_state;
+using rppicomidi::Vpot_display;
+
+// cos(k*pi/8) for k = 0 to 4 in Q15 fixed point
+constexpr int32_t quarter_cos_q15[] = {32768, 30274, 23170, 12540, 0};
+
+constexpr int32_t cos_q15(int eighths)
+{
+    eighths &= 15;
+    if (eighths <= 4)
+        return quarter_cos_q15[eighths];
+    if (eighths <= 8)
+        return -quarter_cos_q15[8 - eighths];
+    if (eighths <= 12)
+        return -quarter_cos_q15[eighths - 8];
+    return quarter_cos_q15[16 - eighths];
+}
+
+struct Led_offset {
+    int8_t dx, dy;
+};
+
+// Value LED n is at (center_x - dx, center_y - dy) for the angle (n-2)*pi/8. The
+// division truncates toward zero like the float to int conversion it replaces.
+constexpr std::array<Led_offset, Vpot_display::num_value_leds> make_led_offsets()
+{
+    std::array<Led_offset, Vpot_display::num_value_leds> offsets{};
+    for (int led = 1; led <= Vpot_display::num_value_leds; led++) {
+        offsets[led-1].dx = static_cast<int8_t>(cos_q15(led - 2) * Vpot_display::led_placement_r / 32768);
+        offsets[led-1].dy = static_cast<int8_t>(cos_q15(led - 6) * Vpot_display::led_placement_r / 32768);
+    }
+    return offsets;
+}
+
+constexpr auto led_offsets = make_led_offsets();
+
+/**
+ * @brief a Mono_sprite bitmap and mask built at compile time
+ *
+ * circle() visits the pixels in the same order as Mono_graphics::draw_centered_circle()
+ * so a sprite of a circle matches the circle drawn on the canvas pixel for pixel.
+ */
+template<uint8_t width, uint8_t height>
+struct Sprite_bitmap {
+    static constexpr int nbytes = width * ((height + 7) / 8);
+    std::array<uint8_t, nbytes> bits{};
+    std::array<uint8_t, nbytes> mask{};
+
+    constexpr void set(int x, int y, Pixel_state state)
+    {
+        if (state == Pixel_state::PIXEL_TRANSPARENT)
+            return;
+        int idx = (y / 8) * width + x;
+        uint8_t bit = 1 << (y % 8);
+        mask[idx] |= bit;
+        if (state == Pixel_state::PIXEL_ONE)
+            bits[idx] |= bit;
+        else
+            bits[idx] &= ~bit;
+    }
+
+    constexpr void hline(int x0, int x1, int y, Pixel_state state)
+    {
+        for (int x = (x0 < x1 ? x0 : x1); x <= (x0 < x1 ? x1 : x0); x++)
+            set(x, y, state);
+    }
+
+    constexpr void circle_points(int cx, int cy, int x, int y, Pixel_state fg_color, Pixel_state fill_color)
+    {
+        if (x == 0) {
+            set(cx, cy + y, fg_color);
+            set(cx, cy - y, fg_color);
+            set(cx + y, cy, fg_color);
+            set(cx - y, cy, fg_color);
+            hline(cx-y+1, cx+y-1, cy, fill_color);
+        }
+        else if (x == y) {
+            set(cx + x, cy + y, fg_color);
+            set(cx - x, cy + y, fg_color);
+            hline(cx-x+1, cx+x-1, cy+y, fill_color);
+            set(cx + x, cy - y, fg_color);
+            set(cx - x, cy - y, fg_color);
+            hline(cx-x+1, cx+x-1, cy-y, fill_color);
+        }
+        else if (x < y) {
+            set(cx + x, cy + y, fg_color);
+            set(cx - x, cy + y, fg_color);
+            hline(cx-x+1, cx+x-1, cy+y, fill_color);
+            set(cx + x, cy - y, fg_color);
+            set(cx - x, cy - y, fg_color);
+            hline(cx-x+1, cx+x-1, cy-y, fill_color);
+            set(cx + y, cy + x, fg_color);
+            set(cx - y, cy + x, fg_color);
+            hline(cx-y+1, cx+y-1, cy+x, fill_color);
+            set(cx + y, cy - x, fg_color);
+            set(cx - y, cy - x, fg_color);
+            hline(cx-y+1, cx+y-1, cy-x, fill_color);
+        }
+    }
+
+    // draw a circle centered in the sprite
+    constexpr void circle(int radius, Pixel_state fg_color, Pixel_state fill_color)
+    {
+        int cx = width / 2;
+        int cy = height / 2;
+        int x = 0;
+        int y = radius;
+        int p = (5 - radius*4)/4;
+        circle_points(cx, cy, x, y, fg_color, fill_color);
+        while (x < y) {
+            x++;
+            if (p < 0) {
+                p += 2*x+1;
+            } else {
+                y--;
+                p += 2*(x-y)+1;
+            }
+            circle_points(cx, cy, x, y, fg_color, fill_color);
+        }
+    }
+};
+
+constexpr uint8_t led_size = 2*Vpot_display::led_r+1;
+constexpr uint8_t ring_size = 2*Vpot_display::outline_r+1;
+using Led_bitmap = Sprite_bitmap<led_size, led_size>;
+using Ring_bitmap = Sprite_bitmap<ring_size, ring_size>;
+
+constexpr Led_bitmap make_led_bitmap(Pixel_state fill_color)
+{
+    Led_bitmap bitmap;
+    bitmap.circle(Vpot_display::led_r, Pixel_state::PIXEL_ONE, fill_color);
+    return bitmap;
+}
+
+// the outline and the center shaft
+constexpr Ring_bitmap make_ring_bitmap()
+{
+    Ring_bitmap bitmap;
+    bitmap.circle(Vpot_display::outline_r, Pixel_state::PIXEL_ONE, Pixel_state::PIXEL_TRANSPARENT);
+    bitmap.circle(Vpot_display::outline_r/2, Pixel_state::PIXEL_ONE, Pixel_state::PIXEL_ONE);
+    return bitmap;
+}
+
+constexpr Led_bitmap led_on_bitmap = make_led_bitmap(Pixel_state::PIXEL_ONE);
+constexpr Led_bitmap led_off_bitmap = make_led_bitmap(Pixel_state::PIXEL_ZERO);
+constexpr Ring_bitmap ring_bitmap = make_ring_bitmap();
+
+// A lit LED sets every pixel the LED covers, so its bits are also the mask of both LED sprites
+const rppicomidi::Mono_sprite led_on_sprite{led_size, led_size, led_on_bitmap.bits.data(), nullptr};
+const rppicomidi::Mono_sprite led_off_sprite{led_size, led_size, led_off_bitmap.bits.data(), led_on_bitmap.bits.data()};
+const rppicomidi::Mono_sprite ring_sprite{ring_size, ring_size, ring_bitmap.bits.data(), nullptr};
+} // namespace
+
 rppicomidi::Vpot_display::Vpot_display(Mono_graphics& screen_, uint8_t x_, uint8_t y_, Vpot_mode initial_mode_, 
         uint8_t initial_value_, bool initial_p_) :
-    screen{screen_}, led_r{3}, outline_r{12}, led_placement_r{(uint8_t)(outline_r+ led_r + 7)}, p_led_placement_r{(uint8_t)(outline_r+led_r+1)},
-    width{(uint8_t)((led_placement_r + led_r)*2)}, height{(uint8_t)(led_placement_r + p_led_placement_r + 2*led_r)}, 
-    center_x{(uint8_t)(x_+width/2)}, center_y{(uint8_t)(y_+height/2)},
-    mode{initial_mode_}, value{initial_value_}, p_led_on{initial_p_}
+    Widget{screen_, x_, y_, vpot_width, vpot_height}, center_x{(uint8_t)(x_+vpot_width/2)}, center_y{(uint8_t)(y_+vpot_height/2)},
+    mode{initial_mode_}, value{initial_value_}, p_led_on{initial_p_}, drawn_leds{0}
 {
     draw();
 }
 
 void rppicomidi::Vpot_display::draw()
 {
-    screen.draw_centered_circle(center_x, center_y, outline_r, Pixel_state::PIXEL_ONE, Pixel_state::PIXEL_TRANSPARENT); // outline
-    screen.draw_centered_circle(center_x, center_y, outline_r/2, Pixel_state::PIXEL_ONE, Pixel_state::PIXEL_ONE); // center shaft
-    screen.draw_centered_circle(center_x, center_y+p_led_placement_r, led_r, Pixel_state::PIXEL_ONE, 
-        p_led_on ? Pixel_state::PIXEL_ONE:Pixel_state::PIXEL_ZERO); // p LED
+    screen.draw_sprite(center_x - outline_r, center_y - outline_r, ring_sprite); // outline and center shaft
+    drawn_leds = get_led_states();
+    for (uint8_t led = 0; led <= p_led; led++)
+        draw_led(led, (drawn_leds & (1u << led)) != 0);
+}
+
+void rppicomidi::Vpot_display::paint()
+{
+    uint16_t states = get_led_states();
+    uint16_t changed = states ^ drawn_leds;
+    drawn_leds = states;
+    for (uint8_t led = 0; changed != 0; led++, changed >>= 1) {
+        if (changed & 1)
+            draw_led(led, (states & (1u << led)) != 0);
+    }
+}
+
+void rppicomidi::Vpot_display::draw_led(uint8_t led, bool is_on)
+{
+    uint8_t led_x = center_x;
+    uint8_t led_y = center_y + p_led_placement_r;
+    if (led != p_led) {
+        led_x = uint8_t((int)center_x - led_offsets[led].dx);
+        led_y = uint8_t((int)center_y - led_offsets[led].dy);
+    }
+    screen.draw_sprite(led_x - led_r, led_y - led_r, is_on ? led_on_sprite : led_off_sprite);
+}
+
+uint16_t rppicomidi::Vpot_display::get_led_states()
+{
+    uint16_t states = p_led_on ? (1u << p_led) : 0;
     // For spread mode
     uint8_t delta;
     uint8_t min_range;
@@ -60,55 +236,48 @@ void rppicomidi::Vpot_display::draw()
         max_range = 6+delta;
     }
 
-    for (int angle_mult = -1; angle_mult <=9; angle_mult++) {
-        float angle = (M_PI / 8.0) * static_cast<float>(angle_mult);
-        float x0 = std::cos(angle) * led_placement_r;
-        float y0 = std::sin(angle) * led_placement_r;
-        uint8_t led_x = uint8_t((int)center_x - (int)x0);
-        uint8_t led_y = uint8_t((int)center_y - (int)y0);
-        Pixel_state state = Pixel_state::PIXEL_ZERO;
-        uint8_t value_led = angle_mult + 2;
-        
-        if (value_led != 0) {
-            switch (mode) {
-                case Vpot_mode::SINGLE_DOT:
+    for (uint8_t value_led = 1; value_led <= num_value_leds; value_led++) {
+        bool is_on = false;
+        switch (mode) {
+            case Vpot_mode::SINGLE_DOT:
+                if (value_led == value)
+                    is_on = true;
+                break;
+            case Vpot_mode::BOOST_CUT:
+                if (value == 6) {
                     if (value_led == value)
-                        state = Pixel_state::PIXEL_ONE;
-                    break;
-                case Vpot_mode::BOOST_CUT:
-                    if (value == 6) {
-                        if (value_led == value)
-                            state = Pixel_state::PIXEL_ONE;
-                    }
-                    if (value > 6) {
-                        // boost
-                        if (value_led <= (value) && value_led >= 6)
-                            state = Pixel_state::PIXEL_ONE;
-                    }
-                    else {
-                        // cut
-                        if (value_led >= value && value_led <= 6)
-                            state = Pixel_state::PIXEL_ONE;
-                    }
-                    break;
-                case Vpot_mode::WRAP:
-                    if (value_led <= (value))
-                        state = Pixel_state::PIXEL_ONE;
-                    break;
-                case Vpot_mode::SPREAD:
-                    if (value == 6) {
-                        if (value_led == value)
-                            state = Pixel_state::PIXEL_ONE;
-                    }
-                    else {
-                        if (value_led >= min_range && value_led <= max_range)
-                            state = Pixel_state::PIXEL_ONE;
-                    }
-                    break;
-            }
+                        is_on = true;
+                }
+                if (value > 6) {
+                    // boost
+                    if (value_led <= (value) && value_led >= 6)
+                        is_on = true;
+                }
+                else {
+                    // cut
+                    if (value_led >= value && value_led <= 6)
+                        is_on = true;
+                }
+                break;
+            case Vpot_mode::WRAP:
+                if (value_led <= (value))
+                    is_on = true;
+                break;
+            case Vpot_mode::SPREAD:
+                if (value == 6) {
+                    if (value_led == value)
+                        is_on = true;
+                }
+                else {
+                    if (value_led >= min_range && value_led <= max_range)
+                        is_on = true;
+                }
+                break;
         }
-        screen.draw_centered_circle(led_x, led_y, led_r, Pixel_state::PIXEL_ONE, state);
+        if (is_on)
+            states |= 1u << (value_led - 1);
     }
+    return states;
 }
 
 void rppicomidi::Vpot_display::set_by_cc_value(uint8_t cc_value)
@@ -118,5 +287,5 @@ void rppicomidi::Vpot_display::set_by_cc_value(uint8_t cc_value)
     value = cc_value & 0xf;
     if (value > 11)
         value = 0;
-    draw();
+    invalidate();
 }
\ No newline at end of file
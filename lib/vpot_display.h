@@ -28,7 +28,7 @@
  */
 
 #pragma once
-#include "mono_graphics_lib.h"
+#include "widget.h"
 namespace rppicomidi {
 
 enum class Vpot_mode {
@@ -38,39 +38,60 @@ enum class Vpot_mode {
     SPREAD=3,
 };
 
-class Vpot_display
+class Vpot_display : public Widget
 {
 public:
     Vpot_display(Mono_graphics& screen_, uint8_t x_, uint8_t y_, Vpot_mode initial_mode_, uint8_t initial_value_, bool initial_p_);
-    void draw();
-    uint8_t get_width() {return width;}
-    uint8_t get_height() {return height;}
+
+    /**
+     * @brief draw the whole VPot, including the parts that never change
+     */
+    void draw() override;
+
+    /**
+     * @brief draw only the "LEDs" that changed state
+     */
+    void paint() override;
+
     void set_mode_and_value(Vpot_mode mode_, uint8_t value_) {
-        mode = mode_; value = value_; draw();
+        mode = mode_; value = value_; invalidate();
     }
-    void set_p(bool is_on) { p_led_on = is_on; draw(); }
+    void set_p(bool is_on) { p_led_on = is_on; invalidate(); }
 
     /**
      * @brief Set the by Mackie Control VPot LED CC message value
      * 
+     * Only the "LEDs" that change state are redrawn when the VPot is painted.
+     *
      * @param cc_value (0 p xx vvvv), where p is 1 to light the p "LED"
      * xx is the Vpot_mode value, and vvvv is the numerical value 0-11.
      * If vvvv is > 11, it will be displayed as 0.
      */
     void set_by_cc_value(uint8_t cc_value);
+
+    static constexpr uint8_t led_r = 3;
+    static constexpr uint8_t outline_r = 12;
+    static constexpr uint8_t led_placement_r = outline_r + led_r + 7;
+    static constexpr uint8_t p_led_placement_r = outline_r + led_r + 1;
+    static constexpr uint8_t vpot_width = (led_placement_r + led_r)*2;
+    static constexpr uint8_t vpot_height = led_placement_r + p_led_placement_r + 2*led_r;
+    static constexpr uint8_t num_value_leds = 11;
+    static constexpr uint8_t p_led = num_value_leds; // the LED number of the p "LED"
 protected:
-    Mono_graphics& screen;
-    const uint8_t led_r; // = 3;
-    const uint8_t outline_r; // = 12;
-    const uint8_t led_placement_r;//  = outline_r+ vpot_led_r + 7;
-    const uint8_t p_led_placement_r; // center_y+vpot_outline_r+4;
-    const uint8_t width; // (led_placement_r + led_r)*2;
-    const uint8_t height; // led_placement_r + p_led_placement_r + 2*led_r;
     uint8_t center_x; // = 24;
     uint8_t center_y; // = 75;
     Vpot_mode mode; // how to display the values on the main 11 VPot "LEDs"
     uint8_t value;  // the value 0-11
     bool p_led_on;  // the bottom center "LED" state
+    uint16_t drawn_leds; // bit n is the state of LED n on the canvas
+
+    /**
+     * @brief get the state every "LED" should have
+     *
+     * @return bit n-1 is set if value LED n is on; bit p_led is set if the p LED is on
+     */
+    uint16_t get_led_states();
+    void draw_led(uint8_t led, bool is_on);
 };
 
 } // namespace rppicomidi
@@ -0,0 +1,116 @@
+/**
+ * @file widget.cpp
+ * @brief This file defines the base class for objects drawn on a
+ * Mono_graphics screen and the root that redraws them once per frame.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "widget.h"
+
+rppicomidi::Widget::~Widget()
+{
+    if (root)
+        root->remove(*this);
+}
+
+void rppicomidi::Widget::invalidate()
+{
+    if (root) {
+        invalid = true;
+    }
+    else {
+        invalid = false;
+        paint();
+    }
+}
+
+rppicomidi::Widget_root::~Widget_root()
+{
+    while (first)
+        remove(*first);
+}
+
+void rppicomidi::Widget_root::add(Widget& widget)
+{
+    assert(widget.root == nullptr);
+    widget.root = this;
+    widget.next = first;
+    first = &widget;
+}
+
+void rppicomidi::Widget_root::remove(Widget& widget)
+{
+    assert(widget.root == this);
+    for (Widget** link = &first; *link; link = &(*link)->next) {
+        if (*link == &widget) {
+            *link = widget.next;
+            break;
+        }
+    }
+    widget.root = nullptr;
+    widget.next = nullptr;
+    widget.invalid = false;
+}
+
+uint8_t rppicomidi::Widget_root::paint(bool high_priority_only)
+{
+    uint8_t npainted = 0;
+    for (int pass = 0; pass < (high_priority_only ? 1 : 2); pass++) {
+        // pass 0 paints the high priority widgets
+        bool high_priority = pass == 0;
+        for (Widget* widget = first; widget; widget = widget->next) {
+            if (widget->invalid && widget->high_priority == high_priority) {
+                widget->invalid = false;
+                widget->paint();
+                ++npainted;
+            }
+        }
+    }
+    num_paints += npainted;
+    return npainted;
+}
+
+bool rppicomidi::Widget_root::has_invalid(bool high_priority_only) const
+{
+    for (Widget* widget = first; widget; widget = widget->next) {
+        if (widget->invalid && (widget->high_priority || !high_priority_only))
+            return true;
+    }
+    return false;
+}
+
+void rppicomidi::Widget_root::redraw_all()
+{
+    screen.clear_canvas();
+    for (Widget* widget = first; widget; widget = widget->next) {
+        widget->invalid = false;
+        widget->draw();
+    }
+}
+
+bool rppicomidi::Widget_root::render_frame()
+{
+    paint();
+    ++num_frames;
+    return screen.render_dirty();
+}
@@ -0,0 +1,165 @@
+/**
+ * @file widget.h
+ * @brief This file defines the base class for objects drawn on a
+ * Mono_graphics screen and the root that redraws them once per frame.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * A Widget setter changes the widget state and calls invalidate(). If the
+ * widget belongs to a Widget_root, invalidate() only flags it, and the
+ * root calls paint() once for each flagged widget in its next frame, no
+ * matter how many setters ran. A widget that is not in a Widget_root
+ * paints at once.
+ *
+ * paint() draws the parts of the widget that changed since it was last
+ * drawn, and draw() draws the whole widget. The drawing marks the changed
+ * parts of the canvas dirty, so the frame sends only those parts to the
+ * display; see Mono_graphics::render_dirty().
+ *
+ * A high priority widget, such as the V-pot the user is turning, is painted
+ * before the others, and a Frame_scheduler paints and flushes it even in
+ * frames it skips for the other widgets.
+ */
+#pragma once
+#include <cstdint>
+#include "mono_graphics_lib.h"
+namespace rppicomidi {
+class Widget_root;
+
+class Widget {
+public:
+    /**
+     * @brief Construct a new Widget object
+     *
+     * @param screen_ The screen object to render the widget
+     * @param x_ horizontal coordinate of the upper left corner
+     * @param y_ vertical coordinate of the upper left corner
+     * @param width_ width of the widget bounding box
+     * @param height_ height of the widget bounding box
+     */
+    Widget(Mono_graphics& screen_, uint8_t x_, uint8_t y_, uint8_t width_, uint8_t height_) :
+        screen{screen_}, x{x_}, y{y_}, width{width_}, height{height_}, root{nullptr}, next{nullptr}, invalid{false}, high_priority{false} {}
+    virtual ~Widget();
+    Widget(const Widget&) = delete;
+    Widget& operator=(const Widget&) = delete;
+
+    /**
+     * @brief draw the parts of the widget that changed since it was last drawn
+     */
+    virtual void paint() = 0;
+
+    /**
+     * @brief draw the whole widget
+     */
+    virtual void draw() = 0;
+
+    /**
+     * @brief request a paint() in the next frame, or paint now if the
+     * widget is not in a Widget_root
+     */
+    void invalidate();
+
+    bool is_invalid() const { return invalid; }
+    void set_high_priority(bool high_priority_) { high_priority = high_priority_; }
+    bool is_high_priority() const { return high_priority; }
+    uint8_t get_x() const { return x; }
+    uint8_t get_y() const { return y; }
+    uint8_t get_width() const { return width; }
+    uint8_t get_height() const { return height; }
+protected:
+    Mono_graphics& screen;
+    uint8_t x;
+    uint8_t y;
+    uint8_t width;
+    uint8_t height;
+private:
+    friend class Widget_root;
+    Widget_root* root;
+    Widget* next;       // the next widget in the root
+    bool invalid;
+    bool high_priority;
+};
+
+class Widget_root {
+public:
+    /**
+     * @brief Construct a new Widget_root object
+     *
+     * @param screen_ the screen all of the root's widgets draw on
+     */
+    Widget_root(Mono_graphics& screen_) : screen{screen_}, first{nullptr}, num_frames{0}, num_paints{0} {}
+    ~Widget_root();
+
+    /**
+     * @brief add a widget to the root. A widget may be in one root only.
+     */
+    void add(Widget& widget);
+
+    /**
+     * @brief remove a widget from the root. It paints at once after this.
+     */
+    void remove(Widget& widget);
+
+    /**
+     * @brief call paint() for every invalid widget, high priority widgets first
+     *
+     * @param high_priority_only if true, leave the other widgets invalid
+     * @return the number of widgets painted
+     */
+    uint8_t paint(bool high_priority_only=false);
+
+    /**
+     * @brief return true if any widget is invalid
+     *
+     * @param high_priority_only if true, only check high priority widgets
+     */
+    bool has_invalid(bool high_priority_only=false) const;
+
+    /**
+     * @brief clear the canvas and draw every widget, for example after the
+     * whole screen showed something else
+     */
+    void redraw_all();
+
+    /**
+     * @brief paint the invalid widgets and write the dirty parts of the canvas
+     * to the display
+     *
+     * @return true if the display write was successful
+     */
+    bool render_frame();
+
+    Mono_graphics& get_screen() { return screen; }
+    uint32_t get_num_frames() const { return num_frames; }
+
+    /**
+     * @brief Get the number of paint() calls made for invalid widgets
+     */
+    uint32_t get_num_paints() const { return num_paints; }
+private:
+    Mono_graphics& screen;
+    Widget* first;
+    uint32_t num_frames;
+    uint32_t num_paints;
+};
+}
@@ -9,16 +9,21 @@
 #include "hardware/gpio.h"
 
 #include "encoder.hpp"
+#include "button_scanner.h"
+#include "encoder_acceleration.h"
 
 // The following are the GPIO numbers for the encoder pins. They can be any
-// GPIO Pin
-#define PINA 2
-#define PINB 3
-#define PIN_PRESS 4
+// GPIO Pin except 2 and 3, which the display's I2C bus uses
+#define PINA 6
+#define PINB 7
+#define PIN_PRESS 8
 
 #include "mono_graphics_lib.h"
 #include "ssd1306i2c.h"
 #include "ssd1306.h"
+#include "button_led.h"
+#include "widget.h"
+#include "frame_scheduler.h"
 #include "ext_lib/ssd1306/src/driver_ssd1306_font.h"
 int main()
 {
@@ -52,32 +57,55 @@ int main()
     for (uint8_t xy=0; xy<64; xy++)
         screen.draw_dot(xy,xy,Pixel_state::PIXEL_ONE);
     #endif
-    for (;;) ;
-#if 0
     using namespace pimoroni;
     Encoder encoder(pio0, PINA, PINB);
     encoder.init();
-    stdio_init_all();
     encoder.zero_count();
-    gpio_init(PIN_PRESS);
-    gpio_set_dir(PIN_PRESS, false);
-    bool not_pressed = gpio_get(PIN_PRESS);
-    bool prev_not_pressed = not_pressed;
+    Button_scanner press_button(pio1, PIN_PRESS, 1);
+    press_button.set_callback([](uint8_t, Button_scanner::Event event, uint32_t timestamp_us, void*) {
+        static const char* names[] = {"pressed", "released", "long pressed"};
+        printf("encoder is %s at %u\r\n", names[static_cast<int>(event)], static_cast<unsigned>(timestamp_us));
+    }, nullptr);
+    press_button.init();
+    Encoder_acceleration accel;
     printf("testing rotary encoder-pio\n");
-    int32_t count = 0;
-    while (1) {
-        // 
-        Capture capture{encoder.perform_capture()};
-        count = capture.get_count_change();
+
+    // Blink an LED button once a second from the model stage, print the encoder
+    // changes and button events, and print the frame time statistics every 5 seconds
+    Widget_root root(screen);
+    Button_led led(screen, 80, 0, 40, 14, "LED", font, false);
+    root.add(led);
+    led.set_high_priority(true);
+    Frame_scheduler scheduler(20000);
+    scheduler.add_display(root);
+    struct Model {
+        Button_led& led;
+        Frame_scheduler& scheduler;
+        Encoder& encoder;
+        Encoder_acceleration& accel;
+        Button_scanner& press_button;
+    } model{led, scheduler, encoder, accel, press_button};
+    scheduler.set_stage_cb(Frame_scheduler::Stage::MODEL, [](void* context) {
+        auto model = reinterpret_cast<Model*>(context);
+        Capture capture{model->encoder.perform_capture()};
+        int32_t count = capture.get_count_change();
         if (count != 0) {
-            printf("%d %f\n\r", count, capture.get_revolutions_per_minute());
+            int32_t effective = model->accel.get_effective_delta(capture);
+            printf("%d %f effective %d\n\r", count, capture.get_revolutions_per_minute(), effective);
         }
-        not_pressed = gpio_get(PIN_PRESS);
-        if (not_pressed != prev_not_pressed) {
-            printf("encoder is %s\r\n", not_pressed ? "not pressed": "pressed");
-            prev_not_pressed = not_pressed;
+        model->press_button.task();
+        uint32_t frame = model->scheduler.get_stats().num_frames;
+        model->led.set_state((frame / 25) & 1);
+        if (frame != 0 && frame % 250 == 0) {
+            const auto& stats = model->scheduler.get_stats();
+            printf("frames=%u overruns=%u dropped=%u avg=%uus max=%uus paint max=%uus flush max=%uus\r\n",
+                static_cast<unsigned>(stats.num_frames), static_cast<unsigned>(stats.num_overruns),
+                static_cast<unsigned>(stats.num_dropped), static_cast<unsigned>(stats.avg_us),
+                static_cast<unsigned>(stats.max_us),
+                static_cast<unsigned>(stats.stage_max_us[static_cast<int>(Frame_scheduler::Stage::PAINT)]),
+                static_cast<unsigned>(stats.stage_max_us[static_cast<int>(Frame_scheduler::Stage::FLUSH)]));
         }
-    }
-#endif
+    }, &model);
+    scheduler.run();
     return 0;
 }
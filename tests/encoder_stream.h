@@ -0,0 +1,62 @@
+/**
+ * @file encoder_stream.h
+ * @brief Make the stream of words that the encoder PIO program pushes for
+ * a knob turned by hand, for the Encoder tests.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+// Record the words the encoder PIO program would push for a knob that is
+// turned back and forth at varying speed, with contact bounce, an
+// occasional skipped state and an occasional very long pause
+static inline std::vector<uint32_t> record_encoder_stream(size_t num_words)
+{
+    static const uint8_t gray_cw[] = {0b00, 0b10, 0b11, 0b01};
+    std::vector<uint32_t> words;
+    words.reserve(num_words);
+    int pos = 0;
+    int dir = 1;
+    uint32_t time = 200;
+    while (words.size() < num_words) {
+        if (rand() % 64 == 0)
+            dir = -dir;
+        if (rand() % 32 == 0)
+            time = 1 + rand() % (1 << (rand() % 20));
+        int next = pos + dir;
+        int roll = rand() % 100;
+        if (roll < 8)
+            next = pos - dir;       // bounce back
+        else if (roll < 10)
+            next = pos + 2 * dir;   // a state was missed
+        uint32_t word_time = (rand() % 500 == 0) ? 0x0fffffff : time + rand() % 8;
+        uint32_t last = gray_cw[pos & 3];
+        uint32_t curr = gray_cw[next & 3];
+        words.push_back((curr << 30) | (last << 28) | word_time);
+        pos = next;
+    }
+    return words;
+}
@@ -0,0 +1,28 @@
+/**
+ * @file button_scan.pio.h
+ * @brief Host stand-in for the header pioasm generates from
+ * lib/button_scan.pio. The constants match the program; the init and
+ * start functions do nothing because programs are not run.
+ */
+#pragma once
+#include <cstdint>
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+
+#define button_scan_wrap_target 0
+#define button_scan_wrap 3
+#define button_scan_offset_sample 1u
+#define DEBOUNCE_CYCLES 490
+
+static const uint16_t button_scan_program_instructions[9] = {};
+static const pio_program_t button_scan_program = {button_scan_program_instructions, 9, -1};
+
+static inline void button_scan_program_patch(uint16_t* instructions, uint)
+{
+    for (uint i = 0; i < button_scan_program.length; i++)
+        instructions[i] = button_scan_program_instructions[i];
+}
+static inline uint16_t button_scan_program_get_divider(uint32_t) { return 1; }
+static inline void button_scan_program_init(PIO, uint, uint, uint, uint, uint16_t) {}
+static inline void button_scan_program_start(PIO, uint, uint) {}
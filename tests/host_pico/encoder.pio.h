@@ -0,0 +1,38 @@
+/**
+ * @file encoder.pio.h
+ * @brief Host stand-in for the header pioasm generates from
+ * ext_lib/encoder-pio/encoder.pio. The constants match the program;
+ * the init and start functions do nothing because programs are not run.
+ */
+#pragma once
+#include <cstdint>
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+
+#define encoder_wrap_target 0
+#define encoder_wrap 10
+#define ENC_DEBOUNCE_CYCLES 490
+
+static const uint16_t encoder_program_instructions[22] = {};
+static const pio_program_t encoder_program = {encoder_program_instructions, 22, -1};
+
+static const uint8_t ENC_LOOP_CYCLES = encoder_wrap - encoder_wrap_target;
+static const uint8_t ENC_DEBOUNCE_TIME = ENC_DEBOUNCE_CYCLES / ENC_LOOP_CYCLES;
+
+static inline void encoder_program_init(PIO, uint, uint, uint, uint, uint16_t) {}
+static inline void encoder_program_start(PIO, uint, bool, bool) {}
+static inline void encoder_program_release(PIO pio, uint sm) { pio_sm_unclaim(pio, sm); }
+
+#define encoder_multi_offset_sample 1u
+
+static const uint16_t encoder_multi_program_instructions[9] = {};
+static const pio_program_t encoder_multi_program = {encoder_multi_program_instructions, 9, -1};
+
+static inline void encoder_multi_program_patch(uint16_t* instructions, uint)
+{
+    for (uint i = 0; i < encoder_multi_program.length; i++)
+        instructions[i] = encoder_multi_program_instructions[i];
+}
+static inline void encoder_multi_program_init(PIO, uint, uint, uint, uint, uint16_t) {}
+static inline void encoder_multi_program_start(PIO, uint, uint) {}
@@ -0,0 +1,6 @@
+#pragma once
+#include <cstdint>
+
+enum clock_index { clk_sys };
+
+static inline uint32_t clock_get_hz(clock_index) { return 125000000; }
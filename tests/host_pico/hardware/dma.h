@@ -0,0 +1,98 @@
+/**
+ * @file dma.h
+ * @brief Host stand-in for hardware/dma.h. A channel does not move data by
+ * itself; host_dma_write() writes one word where the channel would, with
+ * the configured write ring, and counts transfer_count down the same way.
+ */
+#pragma once
+#include <cstdint>
+#include "pico/stdlib.h"
+
+#define NUM_DMA_CHANNELS 12
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+typedef struct {
+    volatile uint32_t read_addr;
+    volatile uint32_t write_addr;
+    volatile uint32_t transfer_count;
+    volatile uint32_t ctrl_trig;
+} dma_channel_hw_t;
+
+typedef struct {
+    uint8_t size;
+    bool read_increment;
+    bool write_increment;
+    bool ring_write;
+    uint8_t ring_size_bits;
+    uint dreq;
+} dma_channel_config;
+
+struct Host_dma_channel {
+    dma_channel_config config;
+    uint8_t* write_base;    // start of the ring, or the write address if there is no ring
+    uint32_t num_written;   // words written since the channel was configured
+};
+
+inline dma_channel_hw_t host_dma_hw[NUM_DMA_CHANNELS];
+inline Host_dma_channel host_dma_channels[NUM_DMA_CHANNELS];
+inline uint16_t host_dma_claimed;
+
+static inline int dma_claim_unused_channel(bool required)
+{
+    for (int channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+        if (!(host_dma_claimed & (1u << channel))) {
+            host_dma_claimed |= 1u << channel;
+            return channel;
+        }
+    }
+    assert(!required);
+    return -1;
+}
+
+static inline void dma_channel_unclaim(uint channel) { host_dma_claimed &= ~(1u << channel); }
+static inline void dma_channel_abort(uint channel) { host_dma_hw[channel].transfer_count = 0; }
+static inline dma_channel_hw_t* dma_channel_hw_addr(uint channel) { return &host_dma_hw[channel]; }
+
+static inline dma_channel_config dma_channel_get_default_config(uint)
+{
+    return dma_channel_config{DMA_SIZE_32, true, false, false, 0, 0x3f};
+}
+static inline void channel_config_set_transfer_data_size(dma_channel_config* c, dma_channel_transfer_size size) { c->size = size; }
+static inline void channel_config_set_read_increment(dma_channel_config* c, bool incr) { c->read_increment = incr; }
+static inline void channel_config_set_write_increment(dma_channel_config* c, bool incr) { c->write_increment = incr; }
+static inline void channel_config_set_ring(dma_channel_config* c, bool write, uint size_bits)
+{
+    c->ring_write = write;
+    c->ring_size_bits = size_bits;
+}
+static inline void channel_config_set_dreq(dma_channel_config* c, uint dreq) { c->dreq = dreq; }
+
+static inline void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+        const volatile void* read_addr, uint32_t transfer_count, bool)
+{
+    host_dma_channels[channel] = Host_dma_channel{*config, (uint8_t*)write_addr, 0};
+    host_dma_hw[channel].transfer_count = transfer_count;
+    (void)read_addr;
+}
+
+static inline void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool)
+{
+    host_dma_hw[channel].transfer_count = trans_count;
+}
+
+// Write word as the next transfer of a 32-bit channel. Returns false, and
+// writes nothing, if the transfer count has run out.
+static inline bool host_dma_write(uint channel, uint32_t word)
+{
+    Host_dma_channel& ch = host_dma_channels[channel];
+    if (host_dma_hw[channel].transfer_count == 0)
+        return false;
+    uint32_t offset = ch.config.write_increment ? ch.num_written * 4 : 0;
+    if (ch.config.ring_write && ch.config.ring_size_bits != 0)
+        offset &= (1u << ch.config.ring_size_bits) - 1;
+    *(uint32_t*)(ch.write_base + offset) = word;
+    ++ch.num_written;
+    --host_dma_hw[channel].transfer_count;
+    return true;
+}
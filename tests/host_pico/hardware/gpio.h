@@ -0,0 +1,21 @@
+/**
+ * @file gpio.h
+ * @brief Host stand-in for hardware/gpio.h. Pin levels come from
+ * host_gpio_levels, which a test sets; outputs are not modelled.
+ */
+#pragma once
+#include <cstdint>
+#include "pico/stdlib.h"
+
+#define NUM_BANK0_GPIOS 30
+#define GPIO_OUT 1
+#define GPIO_IN 0
+
+inline uint32_t host_gpio_levels = 0;
+
+static inline void gpio_init(uint) {}
+static inline void gpio_set_dir(uint, bool) {}
+static inline void gpio_put(uint, bool) {}
+static inline void gpio_pull_up(uint) {}
+static inline bool gpio_get(uint gpio) { return (host_gpio_levels >> gpio) & 1u; }
+static inline uint32_t gpio_get_all() { return host_gpio_levels; }
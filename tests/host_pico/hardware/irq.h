@@ -0,0 +1,36 @@
+/**
+ * @file irq.h
+ * @brief Host stand-in for hardware/irq.h. The handlers are only recorded.
+ * A test calls host_irq_fire() to run them, or calls an interrupt callback
+ * itself.
+ */
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include "pico/stdlib.h"
+
+enum irq_num { PIO0_IRQ_0, PIO0_IRQ_1, PIO1_IRQ_0, PIO1_IRQ_1, HOST_NUM_IRQS };
+typedef void (*irq_handler_t)();
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+inline std::vector<irq_handler_t> host_irq_handlers[HOST_NUM_IRQS];
+
+static inline void irq_set_exclusive_handler(uint num, irq_handler_t handler) { host_irq_handlers[num] = {handler}; }
+static inline void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t)
+{
+    host_irq_handlers[num].push_back(handler);
+}
+static inline void irq_remove_handler(uint num, irq_handler_t handler)
+{
+    std::vector<irq_handler_t>& handlers = host_irq_handlers[num];
+    handlers.erase(std::remove(handlers.begin(), handlers.end(), handler), handlers.end());
+}
+static inline void irq_set_enabled(uint, bool) {}
+
+// Run the handlers of an interrupt as the NVIC would
+static inline void host_irq_fire(uint num)
+{
+    for (irq_handler_t handler : host_irq_handlers[num])
+        handler();
+}
@@ -0,0 +1,114 @@
+/**
+ * @file pio.h
+ * @brief Host stand-in for hardware/pio.h. Each state machine's RX FIFO is
+ * a queue that a test fills with host_pio_push(). The RXNEMPTY bits of
+ * ints0 and ints1 follow the queues and the inte0 and inte1 enables, so
+ * an interrupt handler that polls them sees the same thing as on the chip.
+ * Programs are not run.
+ */
+#pragma once
+#include <cstdint>
+#include <deque>
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+
+#define NUM_PIOS 2
+#define NUM_PIO_STATE_MACHINES 4
+#define PIO_INSTRUCTION_COUNT 32
+#define PIO_IRQ0_INTS_SM0_RXNEMPTY_LSB 0
+#define PIO_IRQ0_INTS_SM0_RXNEMPTY_BITS 0x1u
+#define PIO_IRQ0_INTE_SM0_RXNEMPTY_BITS 0x1u
+#define PIO_IRQ1_INTS_SM0_RXNEMPTY_LSB 0
+#define PIO_IRQ1_INTS_SM0_RXNEMPTY_BITS 0x1u
+#define PIO_IRQ1_INTE_SM0_RXNEMPTY_BITS 0x1u
+
+typedef struct {
+    volatile uint32_t inte0;
+    volatile uint32_t ints0;
+    volatile uint32_t inte1;
+    volatile uint32_t ints1;
+    volatile uint32_t rxf[NUM_PIO_STATE_MACHINES];
+} pio_hw_t;
+typedef pio_hw_t* PIO;
+
+typedef struct {
+    const uint16_t* instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+inline pio_hw_t host_pio_hw[NUM_PIOS];
+inline std::deque<uint32_t> host_pio_rx_fifo[NUM_PIOS][NUM_PIO_STATE_MACHINES];
+inline uint8_t host_pio_claimed_sms[NUM_PIOS];
+
+#define pio0 (&host_pio_hw[0])
+#define pio1 (&host_pio_hw[1])
+
+static inline uint pio_get_index(PIO pio) { return pio == pio1 ? 1 : 0; }
+
+static inline void host_pio_update_ints(PIO pio)
+{
+    uint32_t rxnempty = 0;
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        if (!host_pio_rx_fifo[pio_get_index(pio)][sm].empty())
+            rxnempty |= 1u << sm;
+    }
+    pio->ints0 = (rxnempty << PIO_IRQ0_INTS_SM0_RXNEMPTY_LSB) & pio->inte0;
+    pio->ints1 = (rxnempty << PIO_IRQ1_INTS_SM0_RXNEMPTY_LSB) & pio->inte1;
+}
+
+// Add a word to the RX FIFO of a state machine as if its program had pushed it
+static inline void host_pio_push(PIO pio, uint sm, uint32_t word)
+{
+    host_pio_rx_fifo[pio_get_index(pio)][sm].push_back(word);
+    host_pio_update_ints(pio);
+}
+
+static inline uint32_t pio_sm_get(PIO pio, uint sm)
+{
+    std::deque<uint32_t>& fifo = host_pio_rx_fifo[pio_get_index(pio)][sm];
+    uint32_t word = fifo.empty() ? 0 : fifo.front();
+    if (!fifo.empty())
+        fifo.pop_front();
+    host_pio_update_ints(pio);
+    return word;
+}
+
+static inline bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm)
+{
+    return host_pio_rx_fifo[pio_get_index(pio)][sm].empty();
+}
+
+static inline void hw_set_bits(volatile uint32_t* addr, uint32_t mask)
+{
+    *addr |= mask;
+    host_pio_update_ints(pio0);
+    host_pio_update_ints(pio1);
+}
+
+static inline void hw_clear_bits(volatile uint32_t* addr, uint32_t mask)
+{
+    *addr &= ~mask;
+    host_pio_update_ints(pio0);
+    host_pio_update_ints(pio1);
+}
+
+static inline int pio_claim_unused_sm(PIO pio, bool required)
+{
+    uint8_t& claimed = host_pio_claimed_sms[pio_get_index(pio)];
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        if (!(claimed & (1u << sm))) {
+            claimed |= 1u << sm;
+            return sm;
+        }
+    }
+    assert(!required);
+    return -1;
+}
+
+static inline void pio_sm_unclaim(PIO pio, uint sm) { host_pio_claimed_sms[pio_get_index(pio)] &= ~(1u << sm); }
+static inline bool pio_can_add_program(PIO, const pio_program_t*) { return true; }
+static inline uint pio_add_program(PIO, const pio_program_t*) { return 0; }
+static inline void pio_remove_program(PIO, const pio_program_t*, uint) {}
+static inline void pio_sm_set_enabled(PIO, uint, bool) {}
+static inline uint pio_get_dreq(PIO pio, uint sm, bool is_tx) { return pio_get_index(pio) * 8 + (is_tx ? 0 : 4) + sm; }
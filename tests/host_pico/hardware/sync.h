@@ -0,0 +1,3 @@
+#pragma once
+static inline void __sev() {}
+static inline void __wfe() {}
@@ -0,0 +1,106 @@
+/**
+ * @file stdlib.h
+ * @brief Host stand-in for the few pico/stdlib.h calls that the code under
+ * test makes. Time comes from std::chrono::steady_clock unless a test sets
+ * host_time_manual, and then it is host_time_us. Alarms fire only when a
+ * test calls host_fire_alarms(), which stands in for the timer interrupt.
+ */
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include "hardware/sync.h"
+
+typedef unsigned int uint;
+
+typedef uint64_t absolute_time_t;
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void* user_data);
+
+inline std::atomic<bool> host_time_manual{false};
+inline std::atomic<uint64_t> host_time_us{0};
+
+static inline uint64_t time_us_64()
+{
+    if (host_time_manual.load(std::memory_order_relaxed))
+        return host_time_us.load(std::memory_order_relaxed);
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static inline uint32_t time_us_32() { return static_cast<uint32_t>(time_us_64()); }
+static inline absolute_time_t get_absolute_time() { return time_us_64(); }
+static inline absolute_time_t from_us_since_boot(uint64_t us) { return us; }
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to)
+{
+    return static_cast<int64_t>(to - from);
+}
+
+struct Host_alarm {
+    alarm_id_t id;
+    absolute_time_t time;
+    alarm_callback_t callback;
+    void* user_data;
+};
+inline std::vector<Host_alarm> host_alarms;    // the alarms that have not fired
+inline alarm_id_t host_last_alarm_id = 0;      // ids are not reused, so cancelling a fired alarm does nothing
+
+// Keep the alarm if its callback asked for it to fire again, as the SDK does
+static inline bool host_reschedule_alarm(Host_alarm& alarm, int64_t reschedule_us, uint64_t now_us)
+{
+    if (reschedule_us == 0)
+        return false;
+    alarm.time = reschedule_us > 0 ? alarm.time + reschedule_us : now_us - reschedule_us;
+    host_alarms.push_back(alarm);
+    return true;
+}
+
+static inline alarm_id_t add_alarm_at(absolute_time_t time, alarm_callback_t callback, void* user_data, bool fire_if_past)
+{
+    Host_alarm alarm{++host_last_alarm_id, time, callback, user_data};
+    uint64_t now_us = time_us_64();
+    if (time <= now_us) {
+        if (!fire_if_past)
+            return 0;
+        return host_reschedule_alarm(alarm, callback(alarm.id, user_data), now_us) ? alarm.id : 0;
+    }
+    host_alarms.push_back(alarm);
+    return alarm.id;
+}
+
+static inline bool cancel_alarm(alarm_id_t id)
+{
+    for (auto alarm = host_alarms.begin(); alarm != host_alarms.end(); ++alarm) {
+        if (alarm->id == id) {
+            host_alarms.erase(alarm);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Call the callbacks of the alarms that are due at time_us_64(), earliest first
+static inline void host_fire_alarms()
+{
+    uint64_t now_us = time_us_64();
+    for (;;) {
+        auto next = host_alarms.end();
+        for (auto alarm = host_alarms.begin(); alarm != host_alarms.end(); ++alarm) {
+            if (alarm->time <= now_us && (next == host_alarms.end() || alarm->time < next->time))
+                next = alarm;
+        }
+        if (next == host_alarms.end())
+            return;
+        Host_alarm alarm = *next;
+        host_alarms.erase(next);
+        host_reschedule_alarm(alarm, alarm.callback(alarm.id, alarm.user_data), now_us);
+    }
+}
+
+static inline void tight_loop_contents() {}
+
+#ifndef M_TWOPI
+#define M_TWOPI (6.28318530717958647692)
+#endif
@@ -0,0 +1,100 @@
+/**
+ * @file ram_display.h
+ * @brief This class is a host Ssd1306hw that keeps the display memory in
+ * RAM so tests can compare what a Mono_graphics object sent to the display.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "ssd1306hw.h"
+
+namespace rppicomidi {
+/**
+ * @brief emulate the SSD1306 display memory writes
+ *
+ * Only the commands that decide where data goes are decoded: the memory
+ * addressing mode, the column and page address ranges, and the display
+ * start line. Every other command is accepted and ignored.
+ */
+class Ram_display : public Ssd1306hw {
+public:
+    static const uint8_t num_pages = 8;
+    static const uint8_t num_columns = 128;
+
+    Ram_display() : mem{}, num_data_bytes{0}, start_line{0}, vertical_mode{false},
+        first_col{0}, last_col{num_columns-1}, first_page{0}, last_page{num_pages-1}, col{0}, page{0} {}
+
+    bool write_command(const uint8_t* command, uint8_t nbytes) override
+    {
+        if (command[0] == 0x20 && nbytes >= 2) {
+            vertical_mode = command[1] == 1;
+        }
+        else if (command[0] == 0x21 && nbytes >= 3) {
+            first_col = col = command[1];
+            last_col = command[2];
+        }
+        else if (command[0] == 0x22 && nbytes >= 3) {
+            first_page = page = command[1];
+            last_page = command[2];
+        }
+        else if (command[0] >= 0x40 && command[0] <= 0x7F && nbytes == 1) {
+            start_line = command[0] - 0x40;
+        }
+        return true;
+    }
+
+    bool write_data(const uint8_t* data, size_t nbytes) override
+    {
+        num_data_bytes += nbytes;
+        for (size_t idx = 0; idx < nbytes; idx++) {
+            mem[page % num_pages][col % num_columns] = data[idx];
+            if (vertical_mode) {
+                if (++page > last_page) {
+                    page = first_page;
+                    if (++col > last_col)
+                        col = first_col;
+                }
+            }
+            else if (++col > last_col) {
+                col = first_col;
+                if (++page > last_page)
+                    page = first_page;
+            }
+        }
+        return true;
+    }
+
+    bool same_mem(const Ram_display& other) const { return memcmp(mem, other.mem, sizeof(mem)) == 0; }
+
+    uint8_t mem[num_pages][num_columns];
+    size_t num_data_bytes;
+    uint8_t start_line;
+private:
+    bool vertical_mode;
+    uint8_t first_col, last_col, first_page, last_page;
+    uint8_t col, page;
+};
+}
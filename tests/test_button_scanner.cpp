@@ -0,0 +1,243 @@
+/**
+ * @file test_button_scanner.cpp
+ * @brief Feed Button_scanner pin changes through its PIO interrupt handler
+ * and check the PRESS, RELEASE and LONG_PRESS events against a reference
+ * decoder.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdint>
+#include <cstdlib>
+#include <initializer_list>
+#include <vector>
+#include "button_scanner.h"
+#include "hardware/irq.h"
+#include "test_check.h"
+
+using namespace rppicomidi;
+
+static const uint8_t first_pin = 4;
+static const uint8_t num_buttons = 3;
+static const uint32_t debounce_us = 5000;
+static const uint32_t long_press_us = 500000;
+
+struct Event {
+    Button_scanner::Event event;
+    uint32_t timestamp_us;
+    bool operator==(const Event& other) const { return event == other.event && timestamp_us == other.timestamp_us; }
+};
+typedef std::vector<Event> Button_events[num_buttons];
+
+static void save_event(uint8_t button, Button_scanner::Event event, uint32_t timestamp_us, void* context)
+{
+    auto events = reinterpret_cast<Button_events*>(context);
+    if (button < num_buttons)
+        (*events)[button].push_back(Event{event, timestamp_us});
+}
+
+// Each button is PRESS, then LONG_PRESS if it stays down for the long
+// press time, then RELEASE, with the times of the pin changes the
+// scanner kept
+struct Reference_decoder {
+    uint32_t pressed = 0;
+    uint32_t press_time_us[num_buttons] = {};
+    Button_events events;
+
+    void decode(uint32_t pins, uint32_t timestamp_us)
+    {
+        for (uint8_t button = 0; button < num_buttons; button++) {
+            bool down = !((pins >> button) & 1);
+            if (down == (((pressed >> button) & 1) != 0))
+                continue;
+            if (down) {
+                press_time_us[button] = timestamp_us;
+                events[button].push_back(Event{Button_scanner::Event::PRESS, timestamp_us});
+            }
+            else {
+                if (timestamp_us - press_time_us[button] >= long_press_us)
+                    events[button].push_back(Event{Button_scanner::Event::LONG_PRESS, press_time_us[button] + long_press_us});
+                events[button].push_back(Event{Button_scanner::Event::RELEASE, timestamp_us});
+            }
+            pressed ^= 1u << button;
+        }
+    }
+};
+
+// The pins as the scan program pushes them, 1 bits for released buttons
+static uint32_t get_pins() { return (host_gpio_levels >> first_pin) & ((1u << num_buttons) - 1); }
+
+// A pin change that the scan program pushes, and the interrupt it raises
+static void change_pins(uint32_t pins)
+{
+    host_gpio_levels = (host_gpio_levels & ~(((1u << num_buttons) - 1) << first_pin)) | (pins << first_pin);
+    host_pio_push(pio1, 0, pins);
+    host_irq_fire(PIO1_IRQ_1);
+}
+
+static void set_up(Button_scanner& scanner, Button_events& events, uint32_t start_pins)
+{
+    host_time_manual.store(true);
+    host_time_us.store(1000000);
+    host_gpio_levels = start_pins << first_pin;
+    scanner.set_callback(save_event, &events);
+    CHECK(scanner.init());
+}
+
+// A button that is held down when the scanner starts is reported at once
+static void test_start_pressed()
+{
+    Button_scanner scanner(pio1, first_pin, num_buttons, debounce_us, long_press_us);
+    Button_events events;
+    set_up(scanner, events, 0b101);
+    scanner.task();
+    CHECK(scanner.is_pressed(1) && !scanner.is_pressed(0));
+    CHECK(events[1] == std::vector<Event>({{Button_scanner::Event::PRESS, 1000000}}));
+    CHECK(events[0].empty() && events[2].empty());
+}
+
+// task() runs long after a button went down and up again. The long press
+// is reported before the release with the time it happened.
+static void test_late_task()
+{
+    Button_scanner scanner(pio1, first_pin, num_buttons, debounce_us, long_press_us);
+    Button_events events;
+    set_up(scanner, events, 0b111);
+    host_time_us.fetch_add(1000);
+    change_pins(0b110);
+    host_time_us.fetch_add(2 * long_press_us);
+    change_pins(0b111);
+    host_time_us.fetch_add(3 * long_press_us);
+    scanner.task();
+    CHECK(events[0] == std::vector<Event>({{Button_scanner::Event::PRESS, 1001000},
+        {Button_scanner::Event::LONG_PRESS, 1001000 + long_press_us},
+        {Button_scanner::Event::RELEASE, 1001000 + 2 * long_press_us}}));
+
+    // A press that is still down is reported by the first task() after the long press time
+    events[0].clear();
+    change_pins(0b110);
+    uint32_t press_us = time_us_32();
+    host_time_us.fetch_add(long_press_us - 1);
+    scanner.task();
+    CHECK(events[0] == std::vector<Event>({{Button_scanner::Event::PRESS, press_us}}));
+    host_time_us.fetch_add(1);
+    scanner.task();
+    CHECK(events[0].size() == 2 && events[0][1] == Event({Button_scanner::Event::LONG_PRESS, press_us + long_press_us}));
+    change_pins(0b111);
+    scanner.task();
+    CHECK(events[0].size() == 3 && events[0][2].event == Button_scanner::Event::RELEASE);
+}
+
+// More changes than the queue holds arrive before task(). The last one is
+// dropped, and the next change puts the button state right.
+static void test_dropped_change()
+{
+    Button_scanner scanner(pio1, first_pin, num_buttons, debounce_us, long_press_us);
+    Button_events events;
+    set_up(scanner, events, 0b111);
+    change_pins(0b011);
+    scanner.task();
+    for (int change = 0; change < 17; change++) {
+        host_time_us.fetch_add(debounce_us);
+        change_pins(change % 2 ? 0b011 : 0b111);
+    }
+    CHECK(scanner.get_num_dropped() == 1);
+    scanner.task();
+    // The release of button 2 was dropped, so it still looks down
+    CHECK(scanner.is_pressed(2) && events[2].size() == 17);
+    host_time_us.fetch_add(debounce_us);
+    change_pins(0b110);
+    scanner.task();
+    CHECK(!scanner.is_pressed(2) && scanner.is_pressed(0));
+    CHECK(events[2].size() == 18 && events[2].back() == Event({Button_scanner::Event::RELEASE, time_us_32()}));
+    CHECK(events[0].size() == 1 && events[0].back().event == Button_scanner::Event::PRESS);
+}
+
+static void test_against_reference()
+{
+    Button_scanner scanner(pio1, first_pin, num_buttons, debounce_us, long_press_us);
+    Button_events events;
+    set_up(scanner, events, 0b111);
+    Reference_decoder reference;
+    // Changes the scanner has queued but task() has not decoded, oldest first
+    std::vector<std::pair<uint32_t, uint32_t>> queued = {{get_pins(), time_us_32()}};
+    uint32_t num_dropped = 0;
+    uint32_t num_bad = 0;
+    for (int step = 0; step < 200000; step++) {
+        // Mostly a change every few debounce times, sometimes a long pause
+        host_time_us.fetch_add(rand() % 50 ? debounce_us + rand() % (20 * debounce_us) : rand() % (3 * long_press_us));
+        if (rand() % 2) {
+            uint32_t pins = get_pins() ^ (1u << (rand() % num_buttons));
+            change_pins(pins);
+            if (queued.size() < 16)
+                queued.push_back({pins, time_us_32()});
+            else
+                ++num_dropped;
+        }
+        // task() mostly runs every frame, but now and then it is late
+        if (rand() % (step % 1000 < 900 ? 2 : 40) == 0) {
+            for (auto& change : queued)
+                reference.decode(change.first, change.second);
+            queued.clear();
+            scanner.task();
+            for (uint8_t button = 0; button < num_buttons; button++) {
+                bool is_pressed = ((reference.pressed >> button) & 1) != 0;
+                if (scanner.is_pressed(button) != is_pressed)
+                    ++num_bad;
+                // A button held for the long press time has reported it
+                if (is_pressed && time_us_32() - reference.press_time_us[button] >= long_press_us &&
+                        events[button].back().event != Button_scanner::Event::LONG_PRESS)
+                    ++num_bad;
+            }
+        }
+    }
+    // Press and then release every button, with room in the queue, so
+    // every press has its RELEASE and any LONG_PRESS
+    for (uint32_t pins : {0u, (1u << num_buttons) - 1}) {
+        for (auto& change : queued)
+            reference.decode(change.first, change.second);
+        queued.clear();
+        scanner.task();
+        host_time_us.fetch_add(debounce_us);
+        change_pins(pins);
+        queued.push_back({pins, time_us_32()});
+    }
+    reference.decode(queued.back().first, queued.back().second);
+    scanner.task();
+    CHECK(scanner.get_num_dropped() == num_dropped);
+    CHECK(num_dropped != 0);
+    CHECK(num_bad == 0);
+    for (uint8_t button = 0; button < num_buttons; button++)
+        CHECK(events[button] == reference.events[button]);
+    printf("%zu events for button 0, %u changes dropped\n", events[0].size(), static_cast<unsigned>(num_dropped));
+}
+
+int main()
+{
+    srand(1);
+    test_start_pressed();
+    test_late_task();
+    test_dropped_change();
+    test_against_reference();
+    CHECK(host_irq_handlers[PIO1_IRQ_1].empty());
+    return test_result();
+}
@@ -0,0 +1,188 @@
+/**
+ * @file test_capture_q16.cpp
+ * @brief Compare the Q16.16 Capture getters with the float getters over
+ * random captures, and time both kinds of getter.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <initializer_list>
+#include <vector>
+#include "capture.hpp"
+#include "test_check.h"
+
+using namespace pimoroni;
+
+// The PIO program loop rate of an Encoder on a 125 MHz RP2040
+static const uint32_t loops_per_second = 125000000 / 7;
+
+static uint32_t get_revs_per_count_q24(float counts_per_revolution)
+{
+    // The same expression as the Encoder constructor
+    return (uint32_t)((float)(1 << 24) / std::max(counts_per_revolution, 1.0f));
+}
+
+struct Getter_error {
+    const char* name;
+    double abs_tol;     // allowed absolute error
+    double rel_tol;     // allowed error relative to the float result
+    double worst_rel;   // the worst relative error seen
+    uint32_t num_bad;
+
+    // extra_rel is added to rel_tol for this result
+    void check(float expected, q16_t result, double extra_rel)
+    {
+        double tol = abs_tol + (rel_tol + extra_rel) * fabs(expected);
+        // A result that is surely outside the Q16.16 range must saturate.
+        // Skip the results that are too close to the limit to tell.
+        if (fabs(expected) - tol >= 32768.0) {
+            if (result != (expected > 0 ? INT32_MAX : INT32_MIN))
+                ++num_bad;
+            return;
+        }
+        if (fabs(expected) + tol >= 32767.0)
+            return;
+        double err = fabs((double)q16::to_float(result) - expected);
+        if (err > tol)
+            ++num_bad;
+        if (fabs(expected) > 1.0 && err / fabs(expected) > worst_rel)
+            worst_rel = err / fabs(expected);
+    }
+};
+
+static void test_accuracy(uint32_t num_captures)
+{
+    const double lsb = 1.0 / q16::ONE;
+    Getter_error revs{"revolutions", 2*lsb, 1e-5, 0, 0};
+    Getter_error degrees{"degrees", 360*2*lsb, 1e-5, 0, 0};
+    Getter_error radians{"radians", 7*2*lsb, 1e-5, 0, 0};
+    Getter_error frequency{"frequency", 2*lsb, 1e-5, 0, 0};
+    Getter_error rps{"rev/s", 2*lsb, 1e-4, 0, 0};
+    Getter_error rpm{"rpm", 60*2*lsb, 1e-4, 0, 0};
+    Getter_error dps{"deg/s", 360*2*lsb, 1e-4, 0, 0};
+    Getter_error rad_ps{"rad/s", 7*2*lsb, 1e-4, 0, 0};
+    static const float counts_per_revolution[] = {1, 4, 24, 96, 360, 1000};
+
+    for (uint32_t idx = 0; idx < num_captures; idx++) {
+        float cpr = counts_per_revolution[rand() % 6];
+        int32_t count = rand() % 200001 - 100000;
+        int32_t count_change = rand() % 401 - 200;
+        // Step times from one PIO loop to a few seconds
+        int32_t cumulative_time = 1 + rand() % (1 << (rand() % 26));
+        Capture capture(count, count_change, cumulative_time, loops_per_second, cpr, get_revs_per_count_q24(cpr));
+        // revs_per_count_q24 is truncated, which costs up to cpr / 2^24 of
+        // every result that scales with revolutions
+        double recip_rel = cpr / (double)(1 << 24);
+        revs.check(capture.get_revolutions(), capture.get_revolutions_q16(), recip_rel);
+        degrees.check(capture.get_angle_degrees(), capture.get_angle_degrees_q16(), recip_rel);
+        radians.check(capture.get_angle_radians(), capture.get_angle_radians_q16(), recip_rel);
+        frequency.check(capture.get_frequency(), capture.get_frequency_q16(), 0);
+        rps.check(capture.get_revolutions_per_second(), capture.get_revolutions_per_second_q16(), recip_rel);
+        rpm.check(capture.get_revolutions_per_minute(), capture.get_revolutions_per_minute_q16(), recip_rel);
+        dps.check(capture.get_degrees_per_second(), capture.get_degrees_per_second_q16(), recip_rel);
+        rad_ps.check(capture.get_radians_per_second(), capture.get_radians_per_second_q16(), recip_rel);
+    }
+    for (const Getter_error* getter : {&revs, &degrees, &radians, &frequency, &rps, &rpm, &dps, &rad_ps}) {
+        printf("%-12s worst relative error %.2e, %u out of tolerance\n", getter->name, getter->worst_rel, getter->num_bad);
+        CHECK(getter->num_bad == 0);
+    }
+}
+
+// q16::divide() must give exactly what the 64-bit division it replaces gives
+static void test_divide()
+{
+    uint32_t num_bad = 0;
+    for (uint32_t idx = 0; idx < 1000000; idx++) {
+        uint32_t divisor = 1 + (((uint32_t)rand() << 16 ^ (uint32_t)rand()) >> (rand() % 32));
+        if (divisor > INT32_MAX)
+            divisor = INT32_MAX;
+        int64_t quotient = ((int64_t)rand() << 16 ^ rand()) >> (rand() % 31);
+        int64_t remainder = divisor > 1 ? (int64_t)(rand() % divisor) : 0;
+        int64_t dividend = quotient * divisor + remainder;
+        if (rand() % 2)
+            dividend = -dividend;
+        if (q16::divide(dividend, divisor) != q16::saturate(dividend / divisor))
+            ++num_bad;
+    }
+    static const int64_t edge_dividends[] = {0, 1, -1, INT32_MAX, INT32_MIN, (int64_t)INT32_MAX + 1,
+        (int64_t)INT32_MIN - 1, INT64_C(1) << 32, -(INT64_C(1) << 32), INT64_C(1) << 60, -(INT64_C(1) << 60)};
+    static const uint32_t edge_divisors[] = {1, 2, 3, 0xffff, 0x10000, 0x10001, 0x7fffffff};
+    for (int64_t dividend : edge_dividends)
+        for (uint32_t divisor : edge_divisors)
+            if (q16::divide(dividend, divisor) != q16::saturate(dividend / divisor))
+                ++num_bad;
+    CHECK(num_bad == 0);
+}
+
+static void test_no_motion()
+{
+    Capture capture(10, 0, 5000, loops_per_second, 24, get_revs_per_count_q24(24));
+    CHECK(capture.get_frequency_q16() == 0);
+    CHECK(capture.get_revolutions_per_second_q16() == 0);
+    Capture timed_out(10, 3, INT32_MAX, loops_per_second, 24, get_revs_per_count_q24(24));
+    CHECK(timed_out.get_revolutions_per_second_q16() == 0);
+    CHECK(timed_out.get_radians_per_second_q16() == 0);
+}
+
+// Time the float and the Q16.16 speed getters. On a PC both are fast;
+// the difference matters on the RP2040, which has no FPU. A PC also has a
+// 64-bit divide instruction, so q16::divide() is slower here than the
+// division it replaces, while on the M0+ it avoids a library call.
+static void benchmark()
+{
+    const int num_captures = 1024;
+    std::vector<Capture> captures;
+    for (int idx = 0; idx < num_captures; idx++) {
+        int32_t cumulative_time = 1 + rand() % 100000;
+        captures.emplace_back(rand() % 2000, 1 + rand() % 20, cumulative_time, loops_per_second, 24, get_revs_per_count_q24(24));
+    }
+    const int num_rounds = 2000;
+    volatile float float_sink = 0;
+    volatile q16_t q16_sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < num_rounds; round++)
+        for (int idx = 0; idx < num_captures; idx++)
+            float_sink = float_sink + captures[idx].get_radians_per_second();
+    auto mid = std::chrono::steady_clock::now();
+    for (int round = 0; round < num_rounds; round++)
+        for (int idx = 0; idx < num_captures; idx++)
+            q16_sink = q16_sink + captures[idx].get_radians_per_second_q16();
+    auto end = std::chrono::steady_clock::now();
+    double num_calls = (double)num_rounds * num_captures;
+    printf("get_radians_per_second(): %.2f ns, get_radians_per_second_q16(): %.2f ns\n",
+        std::chrono::duration<double, std::nano>(mid - start).count() / num_calls,
+        std::chrono::duration<double, std::nano>(end - mid).count() / num_calls);
+}
+
+int main()
+{
+    srand(1);
+    test_accuracy(1000000);
+    test_divide();
+    test_no_motion();
+    benchmark();
+    return test_result();
+}
@@ -0,0 +1,24 @@
+/**
+ * @file test_check.h
+ * @brief A minimal check macro for the host tests. A failed check prints
+ * where it failed and the test keeps going; main() returns
+ * test_result() so ctest sees the failure.
+ */
+#pragma once
+#include <cstdio>
+
+static int num_check_failures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++num_check_failures; \
+        } \
+    } while (0)
+
+static inline int test_result()
+{
+    if (num_check_failures != 0)
+        printf("%d check(s) failed\n", num_check_failures);
+    return num_check_failures == 0 ? 0 : 1;
+}
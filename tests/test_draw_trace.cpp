@@ -0,0 +1,186 @@
+/**
+ * @file test_draw_trace.cpp
+ * @brief Record random Mono_graphics drawing calls with a Draw_trace, replay
+ * the trace on a second screen and check that both screens match.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "mono_graphics_lib.h"
+#include "draw_trace.h"
+#include "ram_display.h"
+#include "test_check.h"
+#include "../ext_lib/ssd1306/src/driver_ssd1306_font.h"
+
+using namespace rppicomidi;
+
+static Pixel_state random_color()
+{
+    return static_cast<Pixel_state>(rand() % 4);
+}
+
+// Make one random drawing call of every kind the trace records
+static void draw_random(Mono_graphics& screen, const MonoMonoFont& font, const Mono_sprite& sprite)
+{
+    uint8_t w = screen.get_screen_width();
+    uint8_t h = screen.get_screen_height();
+    uint8_t x = rand() % w;
+    uint8_t y = rand() % h;
+    switch (rand() % 11) {
+        case 0:
+            screen.set_clip_rect(x, y, x + rand() % (w - x), y + rand() % (h - y));
+            break;
+        case 1:
+            screen.set_clip_rect(0, 0, w-1, h-1);
+            break;
+        case 2:
+            screen.draw_dot(x, y, random_color());
+            break;
+        case 3:
+            screen.draw_line(x, y, rand() % w, rand() % h, random_color());
+            break;
+        case 4:
+            screen.draw_rectangle(x, y, 1 + rand() % 40, 1 + rand() % 40, random_color(), random_color());
+            break;
+        case 5:
+            screen.draw_centered_circle(x, y, rand() % 20, random_color(), random_color());
+            break;
+        case 6:
+            screen.draw_character(font, x, y, ' ' + rand() % 95, random_color(), random_color());
+            break;
+        case 7:
+            screen.draw_string(font, x, y, "Trace", 5, random_color(), random_color());
+            break;
+        case 8:
+            screen.draw_sprite(x, y, sprite);
+            break;
+        case 9:
+            screen.scroll(x, y, 1 + rand() % (w - x), 1 + rand() % (h - y), rand() % 17 - 8, rand() % 17 - 8, random_color());
+            break;
+        case 10:
+            if (rand() % 20 == 0)
+                screen.clear_canvas();
+            break;
+    }
+}
+
+static void test_replay(Display_rotation rotation, uint8_t height)
+{
+    MonoMonoFont font(12, 6, gsc_ssd1306_ascii_1206, sizeof(gsc_ssd1306_ascii_1206));
+    const MonoMonoFont* fonts[] = {&font};
+    static const uint8_t sprite_bits[] = {0x3C, 0x42, 0x81, 0x81, 0x42, 0x3C, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01};
+    static const uint8_t sprite_mask[] = {0x3C, 0x7E, 0xFF, 0xFF, 0x7E, 0x3C, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01};
+    Mono_sprite sprite{6, 9, sprite_bits, sprite_mask};
+
+    Ram_display recorded_mem, replayed_mem;
+    Ssd1306 recorded_display(&recorded_mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, height, 0, 0);
+    Ssd1306 replayed_display(&replayed_mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, height, 0, 0);
+    Mono_graphics recorded(&recorded_display, rotation);
+    Mono_graphics replayed(&replayed_display, rotation);
+
+    Draw_trace trace(12);
+    CHECK(trace.add_font(font) == 0);
+    recorded.set_trace(&trace);
+
+    // Read the trace in odd sized pieces, so records are split across reads
+    std::vector<uint8_t> bytes;
+    uint8_t piece[37];
+    for (int frame = 0; frame < 500; frame++) {
+        for (int call = rand() % 8; call > 0; call--)
+            draw_random(recorded, font, sprite);
+        recorded.render();
+        size_t nbytes;
+        while ((nbytes = trace.read(piece, 1 + rand() % sizeof(piece))) != 0)
+            bytes.insert(bytes.end(), piece, piece + nbytes);
+    }
+    CHECK(trace.get_num_dropped() == 0);
+    CHECK(Draw_trace::contains(bytes.data(), bytes.size(), Draw_trace::Op::SPRITE));
+    CHECK(Draw_trace::contains(bytes.data(), bytes.size(), Draw_trace::Op::SCROLL));
+
+    size_t nrecords = Draw_trace::replay(bytes.data(), bytes.size(), replayed, fonts, 1);
+    CHECK(nrecords > 500);
+    CHECK(memcmp(recorded.get_canvas(), replayed.get_canvas(), recorded.get_canvas_nbytes()) == 0);
+    CHECK(recorded_mem.same_mem(replayed_mem));
+}
+
+// A record that does not fit is dropped whole, so the rest still replays
+static void test_dropped_records()
+{
+    Ram_display mem;
+    Ssd1306 display(&mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Mono_graphics screen(&display, Display_rotation::Landscape0);
+    Draw_trace trace(6);
+    screen.set_trace(&trace);
+    for (int idx = 0; idx < 20; idx++)
+        screen.draw_dot(idx, idx, Pixel_state::PIXEL_ONE);
+    CHECK(trace.get_num_dropped() != 0);
+    uint8_t bytes[64];
+    size_t nbytes = trace.read(bytes, sizeof(bytes));
+    CHECK(nbytes == 20u * 6 - trace.get_num_dropped() * 6);
+    screen.set_trace(nullptr);
+    CHECK(Draw_trace::replay(bytes, nbytes, screen, nullptr, 0) == nbytes / 6);
+}
+
+// A string longer than one STRING record replays in full. The 8-bit x
+// position wraps around several times, so every part lands on the screen.
+static void test_long_string()
+{
+    MonoMonoFont font(12, 6, gsc_ssd1306_ascii_1206, sizeof(gsc_ssd1306_ascii_1206));
+    const MonoMonoFont* fonts[] = {&font};
+    char str[601];
+    for (size_t idx = 0; idx < sizeof(str) - 1; idx++)
+        str[idx] = ' ' + 1 + idx % 94;
+    str[sizeof(str) - 1] = '\0';
+
+    Ram_display recorded_mem, replayed_mem;
+    Ssd1306 recorded_display(&recorded_mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Ssd1306 replayed_display(&replayed_mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Mono_graphics recorded(&recorded_display, Display_rotation::Landscape0);
+    Mono_graphics replayed(&replayed_display, Display_rotation::Landscape0);
+    Draw_trace trace(12);
+    trace.add_font(font);
+    recorded.set_trace(&trace);
+    recorded.draw_string(font, 3, 20, str, strlen(str), Pixel_state::PIXEL_ONE, Pixel_state::PIXEL_ZERO);
+
+    std::vector<uint8_t> bytes(trace.get_num_pending());
+    CHECK(trace.read(bytes.data(), bytes.size()) == bytes.size());
+    CHECK(Draw_trace::replay(bytes.data(), bytes.size(), replayed, fonts, 1) == 3);
+    CHECK(memcmp(recorded.get_canvas(), replayed.get_canvas(), recorded.get_canvas_nbytes()) == 0);
+}
+
+int main()
+{
+    srand(1);
+    for (uint8_t height : {64, 32}) {
+        test_replay(Display_rotation::Landscape0, height);
+        test_replay(Display_rotation::Portrait90, height);
+        test_replay(Display_rotation::Landscape180, height);
+        test_replay(Display_rotation::Portrait270, height);
+    }
+    test_dropped_records();
+    test_long_string();
+    return test_result();
+}
@@ -0,0 +1,170 @@
+/**
+ * @file test_encoder_acceleration.cpp
+ * @brief Check the Encoder_acceleration hysteresis, the lookup table and
+ * the carried fraction of an effective count.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdint>
+#include <cstdlib>
+#include "encoder_acceleration.h"
+#include "test_check.h"
+
+using namespace rppicomidi;
+
+// Every count is one effective count until the rate reaches engage_rate
+static void test_one_to_one_below_engage()
+{
+    Encoder_acceleration accel(40, 20, 100, 8, 2);
+    for (uint32_t rate = 0; rate < 40; rate++) {
+        CHECK(accel.get_effective_delta(3, rate) == 3);
+        CHECK(accel.get_effective_delta(-2, rate) == -2);
+        CHECK(accel.get_multiplier_q8() == 256);
+    }
+    CHECK(accel.get_effective_delta(0, 1000) == 0);
+    CHECK(accel.get_effective_delta(1, 39) == 1);
+}
+
+// Once engaged, the acceleration stays on until the rate drops below release_rate
+static void test_hysteresis()
+{
+    Encoder_acceleration accel(40, 20, 100, 8, 2);
+    // 30 counts per second accelerates only while engaged
+    CHECK(accel.get_effective_delta(4, 30) == 4);
+    CHECK(accel.get_multiplier_q8() == 256);
+    CHECK(accel.get_effective_delta(4, 45) > 4);
+    CHECK(accel.get_multiplier_q8() > 256);
+    for (uint32_t rate = 39; rate >= 20; rate--) {
+        CHECK(accel.get_effective_delta(4, rate) >= 4);
+        if (rate >= 24)
+            CHECK(accel.get_multiplier_q8() > 256);
+    }
+    CHECK(accel.get_effective_delta(4, 19) == 4);
+    CHECK(accel.get_multiplier_q8() == 256);
+    CHECK(accel.get_effective_delta(4, 30) == 4);
+    CHECK(accel.get_multiplier_q8() == 256);
+
+    // A count change of 0 does not change the state
+    CHECK(accel.get_effective_delta(4, 50) > 4);
+    CHECK(accel.get_effective_delta(0, 0) == 0);
+    accel.get_effective_delta(4, 30);
+    CHECK(accel.get_multiplier_q8() > 256);
+    accel.reset();
+    CHECK(accel.get_effective_delta(4, 30) == 4);
+}
+
+// The multiplier rises with the rate and is max_multiplier at and above max_rate
+static void test_table()
+{
+    Encoder_acceleration accel(10, 6, 100, 8, 2);
+    uint16_t last = 0;
+    for (uint32_t rate = 10; rate < 200; rate++) {
+        accel.get_effective_delta(1, rate);
+        CHECK(accel.get_multiplier_q8() >= last);
+        last = accel.get_multiplier_q8();
+        if (rate >= 100)
+            CHECK(last == 8 * 256);
+    }
+    CHECK(accel.get_effective_delta(1, 100000) == 8);
+    accel.set_curve(10, 6, 100, 4, 1);
+    CHECK(accel.get_effective_delta(1, 100000) == 4);
+}
+
+// The total effective count at a steady rate does not depend on how the
+// counts are split between calls
+static void test_batching()
+{
+    for (int trial = 0; trial < 1000; trial++) {
+        uint32_t rate = 10 + rand() % 120;
+        int32_t sign = (rand() % 2) ? 1 : -1;
+        int32_t num_counts = 1 + rand() % 200;
+        Encoder_acceleration whole;
+        Encoder_acceleration split;
+        int32_t whole_total = whole.get_effective_delta(sign * num_counts, rate);
+        int32_t split_total = 0;
+        for (int32_t remaining = num_counts; remaining > 0;) {
+            int32_t batch = 1 + rand() % remaining;
+            split_total += split.get_effective_delta(sign * batch, rate);
+            remaining -= batch;
+        }
+        CHECK(split_total == whole_total);
+        CHECK(whole_total == sign * (num_counts * whole.get_multiplier_q8() / 256));
+    }
+}
+
+// A direction change drops the fraction carried from the other direction
+static void test_direction_change()
+{
+    Encoder_acceleration accel(10, 6, 100, 8, 2);
+    // Find a rate whose multiplier has a fraction
+    uint32_t rate = 10;
+    for (; rate < 100; rate++) {
+        accel.reset();
+        accel.get_effective_delta(1, rate);
+        if (accel.get_multiplier_q8() % 256 >= 128)
+            break;
+    }
+    CHECK(rate < 100);
+    accel.reset();
+    accel.get_effective_delta(1, rate);
+    int32_t m = accel.get_multiplier_q8();
+    // One count leaves a fraction of at least half a count. Two counts back
+    // must give the same total as from a standing start, which they would
+    // not if that fraction were still carried.
+    CHECK(accel.get_effective_delta(-1, rate) == -(m / 256));
+    CHECK(accel.get_effective_delta(-1, rate) == -((2 * m) / 256 - m / 256));
+    CHECK(accel.get_effective_delta(1, rate) == m / 256);
+}
+
+// Events give the rate from the time since the previous event
+static void test_events()
+{
+    Encoder_acceleration accel(40, 20, 100, 8, 2);
+    uint32_t now = 1000000;
+    accel.get_effective_delta(pimoroni::EncoderEvent{now, 1, 0});
+    // 20 ms apart is 50 counts per second, which engages
+    for (int idx = 0; idx < 5; idx++) {
+        now += 20000;
+        accel.get_effective_delta(pimoroni::EncoderEvent{now, 1, 0});
+    }
+    CHECK(accel.get_multiplier_q8() > 256);
+    // 100 ms apart is 10 counts per second, which releases
+    now += 100000;
+    CHECK(accel.get_effective_delta(pimoroni::EncoderEvent{now, -1, 0}) == -1);
+    CHECK(accel.get_multiplier_q8() == 256);
+    // Events with the same timestamp count as the fastest rate
+    accel.get_effective_delta(pimoroni::EncoderEvent{now, 1, 0});
+    CHECK(accel.get_multiplier_q8() == 8 * 256);
+}
+
+int main()
+{
+    srand(1);
+    test_one_to_one_below_engage();
+    test_hysteresis();
+    test_table();
+    test_batching();
+    test_direction_change();
+    test_events();
+    return test_result();
+}
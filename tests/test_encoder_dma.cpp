@@ -0,0 +1,180 @@
+/**
+ * @file test_encoder_dma.cpp
+ * @brief Feed recorded encoder PIO words through a simulated DMA ring to
+ * Encoder::process_dma(), including ring wrap-around, overruns and the
+ * restart at the end of the transfer count, and check the counts and
+ * captures against Encoder::process_words().
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include "hardware/dma.h"
+#include "encoder.hpp"
+#include "encoder_stream.h"
+#include "test_check.h"
+
+using namespace pimoroni;
+
+static const uint8_t ring_bits = 4;
+static const uint32_t ring_words = 1u << ring_bits;
+alignas(4 << ring_bits) static uint32_t ring[ring_words];
+
+// The DMA encoder and a reference encoder that gets the same words
+// straight from process_words()
+struct Encoder_pair {
+    Encoder dma{pio0, 0, 1};
+    Encoder reference{pio0, 2, 3};
+
+    bool same_capture()
+    {
+        Capture a = dma.perform_capture();
+        Capture b = reference.perform_capture();
+        return a.get_count() == b.get_count() && a.get_count_change() == b.get_count_change() &&
+            a.get_frequency() == b.get_frequency();
+    }
+};
+
+static void test_init_dma()
+{
+    Encoder encoder(pio0, 0, 1);
+    CHECK(encoder.init());
+    CHECK(pio0->inte0 & 1u);
+    CHECK(!encoder.init_dma(nullptr, ring_bits));
+    CHECK(!encoder.init_dma(ring + 1, ring_bits));
+    CHECK(!encoder.init_dma(ring, 14));
+    CHECK(host_dma_claimed == 0);
+    CHECK(encoder.init_dma(ring, ring_bits));
+    CHECK(host_dma_claimed == 1);
+    // The RX-not-empty interrupt is off while the DMA channel reads the FIFO
+    CHECK((pio0->inte0 & 1u) == 0);
+    CHECK(!encoder.init_dma(ring, ring_bits));
+    CHECK(encoder.process_dma() == 0);
+}
+
+// Without an overrun, every word is decoded once, in order, across the
+// wrap at the end of the ring
+static void test_stream(const std::vector<uint32_t>& words)
+{
+    Encoder_pair pair;
+    CHECK(pair.dma.init());
+    CHECK(pair.dma.init_dma(ring, ring_bits));
+    size_t idx = 0;
+    uint32_t num_mismatches = 0;
+    while (idx < words.size()) {
+        uint32_t burst = rand() % (ring_words + 1);
+        size_t first = idx;
+        for (; burst > 0 && idx < words.size(); burst--)
+            host_dma_write(0, words[idx++]);
+        if (pair.dma.process_dma() != idx - first)
+            ++num_mismatches;
+        pair.reference.process_words(&words[first], idx - first);
+        if (pair.dma.get_count() != pair.reference.get_count())
+            ++num_mismatches;
+        if (rand() % 16 == 0 && !pair.same_capture())
+            ++num_mismatches;
+    }
+    CHECK(num_mismatches == 0);
+    CHECK(pair.dma.get_dma_overrun_count() == 0);
+    CHECK(pair.dma.get_count() != 0);
+}
+
+// If more words arrive than the ring holds, only the newest ring_words are
+// decoded and the rest are counted as overruns
+static void test_overrun(const std::vector<uint32_t>& words)
+{
+    Encoder_pair pair;
+    CHECK(pair.dma.init());
+    CHECK(pair.dma.init_dma(ring, ring_bits));
+    size_t idx = 0;
+    uint32_t expected_overruns = 0;
+    uint32_t num_mismatches = 0;
+    while (idx + 4 * ring_words < words.size()) {
+        uint32_t burst = 1 + rand() % (4 * ring_words);
+        size_t first = idx;
+        for (uint32_t count = 0; count < burst; count++)
+            host_dma_write(0, words[idx++]);
+        uint32_t kept = burst < ring_words ? burst : ring_words;
+        expected_overruns += burst - kept;
+        if (pair.dma.process_dma() != kept)
+            ++num_mismatches;
+        pair.reference.process_words(&words[first + burst - kept], kept);
+        if (pair.dma.get_dma_overrun_count() != expected_overruns)
+            ++num_mismatches;
+        if (!pair.same_capture())
+            ++num_mismatches;
+    }
+    CHECK(num_mismatches == 0);
+    CHECK(expected_overruns != 0);
+}
+
+// The transfer count runs out after 2^31 words. process_dma() restarts the
+// transfer, and the ring position carries on from where it was.
+static void test_transfer_restart(const std::vector<uint32_t>& words)
+{
+    Encoder_pair pair;
+    CHECK(pair.dma.init());
+    CHECK(pair.dma.init_dma(ring, ring_bits));
+    const uint32_t transfer_count = host_dma_hw[0].transfer_count;
+    CHECK(transfer_count != 0 && transfer_count % ring_words == 0);
+
+    size_t idx = 0;
+    for (int lap = 0; lap < 3; lap++) {
+        // Pretend the DMA wrote the whole transfer while nobody looked. Only
+        // the last ring_words words are still in the ring.
+        uint32_t skipped = host_dma_hw[0].transfer_count - ring_words;
+        host_dma_channels[0].num_written += skipped;
+        host_dma_hw[0].transfer_count -= skipped;
+        uint32_t overruns = pair.dma.get_dma_overrun_count();
+        for (uint32_t count = 0; count < ring_words; count++)
+            CHECK(host_dma_write(0, words[idx + count]));
+        CHECK(!host_dma_write(0, words[idx]));
+        CHECK(pair.dma.process_dma() == ring_words);
+        CHECK(pair.dma.get_dma_overrun_count() - overruns == skipped);
+        pair.reference.process_words(&words[idx], ring_words);
+        idx += ring_words;
+        CHECK(host_dma_hw[0].transfer_count == transfer_count);
+
+        // Decoding carries on normally after the restart
+        for (uint32_t count = 0; count < 5; count++)
+            host_dma_write(0, words[idx + count]);
+        CHECK(pair.dma.process_dma() == 5);
+        pair.reference.process_words(&words[idx], 5);
+        idx += 5;
+        CHECK(pair.same_capture());
+    }
+}
+
+int main()
+{
+    srand(1);
+    std::vector<uint32_t> words = record_encoder_stream(100000);
+    test_init_dma();
+    CHECK(host_dma_claimed == 0);
+    test_stream(words);
+    test_overrun(words);
+    test_transfer_restart(words);
+    CHECK(host_dma_claimed == 0);
+    return test_result();
+}
@@ -0,0 +1,127 @@
+/**
+ * @file test_encoder_event_queue.cpp
+ * @brief Check EncoderEventQueue on one thread, then race a producer
+ * thread against a consumer thread and check that no event is lost,
+ * reordered or torn.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdint>
+#include <thread>
+#include "encoder_event_queue.hpp"
+#include "test_check.h"
+
+using namespace pimoroni;
+
+// Every field of an event is derived from its sequence number, so a
+// consumer can tell a torn copy from a whole one
+static EncoderEvent make_event(uint32_t seq)
+{
+    return EncoderEvent{seq, static_cast<int8_t>((seq & 1) ? 1 : -1), static_cast<uint8_t>(seq * 7)};
+}
+
+static bool is_whole(const EncoderEvent& event)
+{
+    const EncoderEvent expected = make_event(event.timestamp_us);
+    return event.delta == expected.delta && event.encoder_id == expected.encoder_id;
+}
+
+static void test_single_thread()
+{
+    EncoderEvent buffer[8];
+    EncoderEventQueue queue(buffer, 8);
+    CHECK(queue.get_capacity() == 8);
+    CHECK(queue.get_size() == 0);
+    for (uint32_t seq = 0; seq < 8; seq++)
+        CHECK(queue.push(make_event(seq)));
+    CHECK(!queue.push(make_event(8)));
+    CHECK(queue.get_overflow_count() == 1);
+    CHECK(queue.get_size() == 8);
+
+    EncoderEvent events[8];
+    CHECK(queue.pop(events, 3) == 3);
+    CHECK(events[0].timestamp_us == 0 && events[2].timestamp_us == 2);
+    CHECK(queue.get_size() == 5);
+    // The indices wrap around the end of the buffer
+    for (uint32_t seq = 9; seq < 12; seq++)
+        CHECK(queue.push(make_event(seq)));
+    CHECK(queue.pop(events, 8) == 8);
+    CHECK(events[0].timestamp_us == 3 && events[4].timestamp_us == 7 && events[5].timestamp_us == 9);
+    CHECK(queue.pop(events, 8) == 0);
+}
+
+// If wait_for_room is true, the producer waits while the queue is full,
+// so no event should be dropped. Otherwise it pushes as fast as it can, and
+// every event must be either delivered or counted as an overflow.
+static void test_two_threads(uint32_t num_events, bool wait_for_room)
+{
+    static EncoderEvent buffer[64];
+    EncoderEventQueue queue(buffer, 64);
+
+    std::thread producer([&queue, num_events, wait_for_room]() {
+        for (uint32_t seq = 0; seq < num_events; seq++) {
+            while (wait_for_room && queue.get_size() == queue.get_capacity())
+                std::this_thread::yield();
+            queue.push(make_event(seq));
+            if ((seq & 0x3FF) == 0)
+                std::this_thread::yield();
+        }
+    });
+
+    uint32_t num_delivered = 0;
+    uint32_t num_torn = 0;
+    uint32_t num_out_of_order = 0;
+    int64_t last_seq = -1;
+    EncoderEvent events[16];
+    // The producer is done once every event was delivered or dropped
+    while (num_delivered + queue.get_overflow_count() < num_events) {
+        uint32_t num_popped = queue.pop(events, 1 + num_delivered % 16);
+        for (uint32_t idx = 0; idx < num_popped; idx++) {
+            if (!is_whole(events[idx]))
+                ++num_torn;
+            if (static_cast<int64_t>(events[idx].timestamp_us) <= last_seq)
+                ++num_out_of_order;
+            last_seq = events[idx].timestamp_us;
+        }
+        num_delivered += num_popped;
+        if (num_popped == 0)
+            std::this_thread::yield();
+    }
+    producer.join();
+
+    printf("%u events: %u delivered, %u dropped\n", num_events, num_delivered, queue.get_overflow_count());
+    CHECK(num_torn == 0);
+    CHECK(num_out_of_order == 0);
+    CHECK(num_delivered + queue.get_overflow_count() == num_events);
+    if (wait_for_room)
+        CHECK(queue.get_overflow_count() == 0);
+    CHECK(queue.get_size() == 0);
+}
+
+int main()
+{
+    test_single_thread();
+    test_two_threads(1000000, true);
+    test_two_threads(1000000, false);
+    return test_result();
+}
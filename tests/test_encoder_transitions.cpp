@@ -0,0 +1,221 @@
+/**
+ * @file test_encoder_transitions.cpp
+ * @brief Replay a recorded stream of encoder PIO words through the Encoder
+ * table decoder and check the counts and frequencies against the switch
+ * statement decoder it replaced. Also time both decoders per transition.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdint>
+#include <cstdlib>
+#include <climits>
+#include <chrono>
+#include <vector>
+#include "encoder.hpp"
+#include "encoder.pio.h"
+#include "encoder_stream.h"
+#include "test_check.h"
+
+using namespace pimoroni;
+
+static const uint32_t clocks_per_time = 125000000 / ENC_LOOP_CYCLES;
+
+// The decoder that Encoder::check_for_transition() used before the
+// transition table, with its signed overflow checks made well defined.
+// The states are A in bit 1 and B in bit 0.
+class Switch_decoder {
+public:
+    static const uint8_t MICROSTEP_0 = 0b00;
+    static const uint8_t MICROSTEP_1 = 0b10;
+    static const uint8_t MICROSTEP_2 = 0b11;
+    static const uint8_t MICROSTEP_3 = 0b01;
+
+    explicit Switch_decoder(bool count_microsteps_) : count_microsteps{count_microsteps_} {}
+
+    void decode(uint32_t received)
+    {
+        uint8_t states = received >> 28;
+        int32_t time_received = (received & 0x0fffffff) + ENC_DEBOUNCE_TIME;
+        if (!count_microsteps) {
+            time_received = saturate((int64_t)time_received + microstep_time);
+            microstep_time = time_received;
+        }
+        uint8_t last = states & 0b11;
+        uint8_t curr = states >> 2;
+        switch (last) {
+            case MICROSTEP_0:
+                if (curr == MICROSTEP_1 && count_microsteps)
+                    microstep_up(time_received);
+                else if (curr == MICROSTEP_3 && count_microsteps)
+                    microstep_down(time_received);
+                break;
+            case MICROSTEP_1:
+                if (curr == MICROSTEP_2) {
+                    if (count_microsteps || last_travel_dir == 1)
+                        microstep_up(time_received);
+                    last_travel_dir = 0;
+                }
+                else if (curr == MICROSTEP_0 && count_microsteps) {
+                    microstep_down(time_received);
+                }
+                break;
+            case MICROSTEP_2:
+                if (curr == MICROSTEP_3) {
+                    if (count_microsteps)
+                        microstep_up(time_received);
+                    last_travel_dir = 1;
+                }
+                else if (curr == MICROSTEP_1) {
+                    if (count_microsteps)
+                        microstep_down(time_received);
+                    last_travel_dir = -1;
+                }
+                break;
+            case MICROSTEP_3:
+                if (curr == MICROSTEP_0 && count_microsteps) {
+                    microstep_up(time_received);
+                }
+                else if (curr == MICROSTEP_2) {
+                    if (count_microsteps || last_travel_dir == -1)
+                        microstep_down(time_received);
+                    last_travel_dir = 0;
+                }
+                break;
+        }
+    }
+
+    // The frequency that the old perform_capture() returned
+    float capture_frequency()
+    {
+        int32_t count_change = count - last_captured_count;
+        last_captured_count = count;
+        float average_frequency = 0.0f;
+        if (count_change != 0 && cumulative_time != INT_MAX)
+            average_frequency = ((float)clocks_per_time * (float)count_change) / (float)cumulative_time;
+        cumulative_time = 0;
+        return average_frequency;
+    }
+
+    int32_t count = 0;
+    int32_t time_since = 0;
+private:
+    const bool count_microsteps;
+    int last_travel_dir = 0;
+    int32_t microstep_time = 0;
+    int32_t cumulative_time = 0;
+    int32_t last_captured_count = 0;
+
+    static int32_t saturate(int64_t time) { return time > INT32_MAX ? INT32_MAX : (int32_t)time; }
+    void microstep_up(int32_t time)
+    {
+        count++;
+        time_since = time;
+        microstep_time = 0;
+        cumulative_time = saturate((int64_t)cumulative_time + time);
+    }
+    void microstep_down(int32_t time)
+    {
+        count--;
+        time_since = -time;
+        microstep_time = 0;
+        cumulative_time = saturate((int64_t)cumulative_time + time);
+    }
+};
+
+static void test_against_switch_decoder(bool count_microsteps, const std::vector<uint32_t>& words)
+{
+    Encoder encoder(pio0, 0, 1, Encoder::PIN_UNUSED, 24, count_microsteps);
+    Switch_decoder reference(count_microsteps);
+    uint32_t num_count_mismatches = 0;
+    uint32_t num_frequency_mismatches = 0;
+    uint32_t num_capture_mismatches = 0;
+    for (size_t idx = 0; idx < words.size(); idx++) {
+        encoder.process_words(&words[idx], 1);
+        reference.decode(words[idx]);
+        if (encoder.get_count() != reference.count)
+            ++num_count_mismatches;
+        if (reference.time_since != 0 &&
+                encoder.get_frequency() != (float)clocks_per_time / (float)reference.time_since)
+            ++num_frequency_mismatches;
+        if (rand() % 50 == 0 && encoder.perform_capture().get_frequency() != reference.capture_frequency())
+            ++num_capture_mismatches;
+    }
+    CHECK(reference.count != 0);
+    CHECK(num_count_mismatches == 0);
+    CHECK(num_frequency_mismatches == 0);
+    CHECK(num_capture_mismatches == 0);
+}
+
+// The words also decode the same when they arrive through the RX FIFO
+// and the PIO0 interrupt handler
+static void test_interrupt_path(const std::vector<uint32_t>& words)
+{
+    Encoder encoder(pio0, 0, 1);
+    CHECK(encoder.init());
+    Switch_decoder reference(false);
+    size_t idx = 0;
+    while (idx < words.size()) {
+        for (size_t burst = 1 + rand() % 8; burst > 0 && idx < words.size(); burst--) {
+            host_pio_push(pio0, 0, words[idx]);
+            reference.decode(words[idx++]);
+        }
+        Encoder::pio0_interrupt_callback();
+        CHECK(pio0->ints0 == 0);
+    }
+    CHECK(encoder.get_count() == reference.count);
+    CHECK(encoder.get_state_a() == (bool)(words.back() & 0x80000000));
+    CHECK(encoder.get_state_b() == (bool)(words.back() & 0x40000000));
+}
+
+static void benchmark(const std::vector<uint32_t>& words)
+{
+    const int num_rounds = 20;
+    volatile int32_t sink = 0;
+    Encoder encoder(pio0, 0, 1);
+    Switch_decoder reference(false);
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < num_rounds; round++)
+        encoder.process_words(words.data(), words.size());
+    sink = sink + encoder.get_count();
+    auto mid = std::chrono::steady_clock::now();
+    for (int round = 0; round < num_rounds; round++)
+        for (uint32_t word : words)
+            reference.decode(word);
+    sink = sink + reference.count;
+    auto end = std::chrono::steady_clock::now();
+    double num_transitions = (double)num_rounds * words.size();
+    printf("transition table: %.2f ns per transition, switch statements: %.2f ns per transition\n",
+        std::chrono::duration<double, std::nano>(mid - start).count() / num_transitions,
+        std::chrono::duration<double, std::nano>(end - mid).count() / num_transitions);
+}
+
+int main()
+{
+    srand(1);
+    std::vector<uint32_t> words = record_encoder_stream(200000);
+    test_against_switch_decoder(false, words);
+    test_against_switch_decoder(true, words);
+    test_interrupt_path(words);
+    benchmark(words);
+    return test_result();
+}
@@ -0,0 +1,201 @@
+/**
+ * @file test_mc_bank_cache.cpp
+ * @brief Switch banks at random and check the Mc_bank_cache hits, misses
+ * and restored states against a reference LRU cache.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+#include "mc_bank_cache.h"
+#include "ram_display.h"
+#include "test_check.h"
+#include "../ext_lib/ssd1306/src/driver_ssd1306_font.h"
+
+using namespace rppicomidi;
+
+static const uint8_t strip_note = 0x00;     // the strip 1 rec LED
+static const uint8_t play_note = 0x5E;      // the transport play LED
+
+// What the DAW might send while a bank is shown: strip and other button
+// LEDs, V-pot rings and LCD text
+static void parse_random_messages(Mc_midi_parser& parser)
+{
+    for (int msg = rand() % 6; msg > 0; msg--) {
+        std::vector<uint8_t> bytes;
+        switch (rand() % 3) {
+            case 0:
+                bytes = {0x90, static_cast<uint8_t>(rand() % 2 ? rand() % 32 : rand() % 128),
+                    static_cast<uint8_t>(rand() % 2 ? 0x7F : 0)};
+                break;
+            case 1:
+                bytes = {0xB0, static_cast<uint8_t>(0x30 + rand() % 8), static_cast<uint8_t>(rand() % 128)};
+                break;
+            default:
+                bytes = {0xF0, 0x00, 0x00, 0x66, 0x14, 0x12, static_cast<uint8_t>(rand() % 100)};
+                for (int chr = rand() % 12; chr > 0; chr--)
+                    bytes.push_back('A' + rand() % 26);
+                bytes.push_back(0xF7);
+                break;
+        }
+        parser.parse(bytes.data(), bytes.size());
+    }
+}
+
+static bool same_state(const Mc_midi_parser::State& a, const Mc_midi_parser::State& b)
+{
+    return memcmp(a.lcd.chars, b.lcd.chars, sizeof(a.lcd.chars)) == 0 &&
+        memcmp(a.vpot_cc, b.vpot_cc, sizeof(a.vpot_cc)) == 0 &&
+        memcmp(a.led_bits, b.led_bits, sizeof(a.led_bits)) == 0;
+}
+
+// The cache behaviour documented in mc_bank_cache.h, written the slow way.
+// The banks in lru are cached, least recently used first.
+struct Reference_cache {
+    size_t max_banks;
+    uint16_t current_bank;
+    std::vector<uint16_t> lru;
+    std::map<uint16_t, Mc_midi_parser::State> states;
+
+    bool is_cached(uint16_t bank) const { return std::find(lru.begin(), lru.end(), bank) != lru.end(); }
+    void touch(uint16_t bank)
+    {
+        lru.erase(std::find(lru.begin(), lru.end(), bank));
+        lru.push_back(bank);
+    }
+    bool switch_bank(uint16_t bank, const Mc_midi_parser::State& current)
+    {
+        if (bank == current_bank)
+            return true;
+        bool hit = is_cached(bank);
+        if (is_cached(current_bank)) {
+            touch(current_bank);
+        }
+        else if (lru.size() < max_banks) {
+            lru.push_back(current_bank);
+        }
+        else {
+            // Replace the oldest bank other than the one being switched to
+            auto oldest = std::find_if(lru.begin(), lru.end(), [bank](uint16_t cached) { return cached != bank; });
+            if (oldest != lru.end()) {
+                states.erase(*oldest);
+                lru.erase(oldest);
+                lru.push_back(current_bank);
+            }
+        }
+        if (is_cached(current_bank))
+            states[current_bank] = current;
+        if (hit)
+            touch(bank);
+        current_bank = bank;
+        return hit;
+    }
+};
+
+static void test_against_reference(size_t max_banks, uint16_t num_banks)
+{
+    Ram_display mem;
+    Ssd1306 display(&mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Mono_graphics screen(&display, Display_rotation::Landscape0);
+    MonoMonoFont font(12, 6, gsc_ssd1306_ascii_1206, sizeof(gsc_ssd1306_ascii_1206));
+    Button_led rec(screen, 0, 0, 40, 14, "REC", font, false);
+    Button_led play(screen, 50, 0, 40, 14, "PLAY", font, false);
+    Mc_midi_parser parser;
+    parser.set_button_led(strip_note, &rec);
+    parser.set_button_led(play_note, &play);
+
+    // A budget one byte short of max_banks + 1 banks holds max_banks banks
+    Mc_bank_cache cache(parser, (max_banks + 1) * Mc_bank_cache::get_bytes_per_bank() - 1);
+    CHECK(cache.get_max_banks() == max_banks);
+    Reference_cache reference{max_banks, 0, {}, {}};
+    Mc_midi_parser::State blank;
+    Mc_midi_parser::clear_state(blank);
+
+    uint32_t num_hits = 0, num_bad = 0;
+    for (int idx = 0; idx < 20000; idx++) {
+        parse_random_messages(parser);
+        if (rand() % 1000 == 0) {
+            cache.clear();
+            reference.lru.clear();
+            reference.states.clear();
+        }
+        // Mostly switch between nearby banks, as a user turning a bank encoder does
+        uint16_t bank = rand() % 4 ? (reference.current_bank + rand() % 3 + num_banks - 1) % num_banks : rand() % num_banks;
+        Mc_midi_parser::State before, after;
+        parser.save_state(before);
+        bool play_on = play.get_state();
+        bool hit = cache.switch_bank(bank);
+        bool changed = bank != reference.current_bank;
+        bool expected_hit = reference.switch_bank(bank, before);
+        parser.save_state(after);
+        if (hit != expected_hit || cache.get_current_bank() != bank)
+            ++num_bad;
+        else if (!changed && !same_state(after, before))
+            ++num_bad;
+        else if (changed && !same_state(after, hit ? reference.states[bank] : blank))
+            ++num_bad;
+        // Only the strip LEDs belong to a bank
+        if (play.get_state() != play_on || rec.get_state() != ((after.led_bits[strip_note / 8] >> (strip_note % 8)) & 1))
+            ++num_bad;
+        if (changed && hit)
+            ++num_hits;
+    }
+    printf("%zu banks cached of %u: %u hits, %u misses\n", max_banks, num_banks,
+        static_cast<unsigned>(cache.get_num_hits()), static_cast<unsigned>(cache.get_num_misses()));
+    CHECK(num_bad == 0);
+    CHECK(cache.get_num_hits() == num_hits);
+    CHECK(num_hits != 0 && cache.get_num_misses() != 0);
+}
+
+// With room for one bank, switching back to the cached bank does not save
+// the bank being left, so switching to that bank again is a miss
+static void test_single_entry()
+{
+    Mc_midi_parser parser;
+    Mc_bank_cache cache(parser, Mc_bank_cache::get_bytes_per_bank());
+    CHECK(cache.get_max_banks() == 1);
+    const uint8_t cc[] = {0xB0, 0x30, 0x11};
+    parser.parse(cc, sizeof(cc));
+    CHECK(!cache.switch_bank(1));
+    CHECK(cache.switch_bank(0));
+    Mc_midi_parser::State state;
+    parser.save_state(state);
+    CHECK(state.vpot_cc[0] == 0x11);
+    CHECK(!cache.switch_bank(1));
+    CHECK(!cache.switch_bank(2));
+    CHECK(cache.switch_bank(1));
+    CHECK(!cache.switch_bank(0));
+    CHECK(cache.get_num_hits() == 2 && cache.get_num_misses() == 4);
+}
+
+int main()
+{
+    test_single_entry();
+    for (size_t max_banks : {1, 2, 3, 8})
+        test_against_reference(max_banks, 12);
+    return test_result();
+}
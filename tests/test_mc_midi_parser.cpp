@@ -0,0 +1,187 @@
+/**
+ * @file test_mc_midi_parser.cpp
+ * @brief Check the Mc_midi_parser routing and time how fast it parses a
+ * synthetic control surface stream.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "mc_midi_parser.h"
+#include "ram_display.h"
+#include "test_check.h"
+#include "../ext_lib/ssd1306/src/driver_ssd1306_font.h"
+
+using namespace rppicomidi;
+
+static const uint8_t timecode_none = 0xFF;
+static uint8_t timecode[12];
+
+static void save_timecode(uint8_t position, uint8_t chr, void*)
+{
+    if (position < sizeof(timecode))
+        timecode[position] = chr;
+}
+
+static void test_routing()
+{
+    Ram_display mem, reference_mem;
+    Ssd1306 display(&mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Ssd1306 reference_display(&reference_mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Mono_graphics screen(&display, Display_rotation::Landscape0);
+    Mono_graphics reference_screen(&reference_display, Display_rotation::Landscape0);
+    MonoMonoFont font(12, 6, gsc_ssd1306_ascii_1206, sizeof(gsc_ssd1306_ascii_1206));
+
+    Mc_midi_parser parser;
+    Mc_channel_text text(screen, 0, 0, 0, font);
+    Button_led led(screen, 0, 30, 40, 14, "REC", font, false);
+    Mc_meter meter(screen, 100, 0, 2);
+    Mc_meter reference_meter(reference_screen, 100, 0, 2);
+    parser.set_channel_text(0, &text);
+    parser.set_button_led(0x10, &led);
+    parser.set_meter(2, &meter);
+    memset(timecode, timecode_none, sizeof(timecode));
+    parser.set_timecode_cb(save_timecode, nullptr);
+
+    // LCD text across strips and lines, with a real-time byte inside the
+    // SysEx and characters that are not printable
+    std::vector<uint8_t> msg = {0xF0, 0x00, 0x00, 0x66, 0x14, 0x12, 0x00};
+    const char* line = "Kick   Snare  Hat    Bass   ";
+    msg.insert(msg.end(), line, line + 4);
+    msg.push_back(0xF8);
+    msg.insert(msg.end(), line + 4, line + strlen(line));
+    msg.insert(msg.end(), {0xF7, 0xF0, 0x00, 0x00, 0x66, 0x14, 0x12, 56 + 21, 'L', 'o', 0x01, 0x7F, 0xF7});
+    parser.parse(msg.data(), msg.size());
+    const Mc_lcd_model& lcd = parser.get_lcd_model();
+    CHECK(lcd.get_character(0, 0) == 'K' && lcd.get_character(0, 3) == 'k' && lcd.get_character(0, 4) == ' ');
+    CHECK(lcd.get_character(0, 7) == 'S' && lcd.get_character(0, 21) == 'B');
+    CHECK(lcd.get_character(1, 21) == 'L' && lcd.get_character(1, 22) == 'o');
+    CHECK(lcd.get_character(1, 23) == ' ' && lcd.get_character(1, 24) == ' ');
+
+    // SysEx for another device ID is ignored
+    const uint8_t extender[] = {0xF0, 0x00, 0x00, 0x66, 0x15, 0x12, 0x00, 'X', 0xF7};
+    parser.parse(extender, sizeof(extender));
+    CHECK(lcd.get_character(0, 0) == 'K');
+
+    // Meter updates with running status, including the overload flag
+    const uint8_t pressure[] = {0xD0, 0x2C, 0x2E, 0x25};
+    parser.parse(pressure, sizeof(pressure));
+    reference_meter.set_value_by_channel_pressure(0x2C);
+    reference_meter.set_value_by_channel_pressure(0x2E);
+    reference_meter.set_value_by_channel_pressure(0x25);
+    // The meter is the only thing drawn in columns 100 to 107
+    for (uint8_t page = 0; page < screen.get_num_pages(); page++)
+        CHECK(memcmp(screen.get_canvas() + page * 128 + 100, reference_screen.get_canvas() + page * 128 + 100, 8) == 0);
+
+    // Note on and off with a real-time byte between status and data
+    const uint8_t note_on[] = {0x90, 0xF8, 0x10, 0x7F};
+    parser.parse(note_on, sizeof(note_on));
+    CHECK(led.get_state());
+    const uint8_t note_off[] = {0x90, 0x10, 0x00};
+    parser.parse(note_off, sizeof(note_off));
+    CHECK(!led.get_state());
+
+    // V-pot CCs with running status, then timecode CCs
+    const uint8_t cc[] = {0xB0, 0x30, 0x15, 0x31, 0x05, 0x40, 0x35, 0x41, 0x36};
+    parser.parse(cc, sizeof(cc));
+    Mc_midi_parser::State state;
+    parser.save_state(state);
+    CHECK(state.vpot_cc[0] == 0x15 && state.vpot_cc[1] == 0x05);
+    CHECK(timecode[0] == 0x35 && timecode[1] == 0x36 && timecode[2] == timecode_none);
+
+    // A system common message cancels running status
+    const uint8_t common[] = {0xF3, 0x01, 0x32, 0x7F};
+    parser.parse(common, sizeof(common));
+    parser.save_state(state);
+    CHECK(state.vpot_cc[2] == 0);
+}
+
+// A DAW-like stream: meter updates for all strips, a V-pot CC for each
+// strip, and an LCD line every 10 frames
+static std::vector<uint8_t> make_stream()
+{
+    std::vector<uint8_t> stream;
+    for (int frame = 0; frame < 1000; frame++) {
+        stream.push_back(0xD0);
+        for (int strip = 0; strip < 8; strip++)
+            stream.push_back((strip << 4) | ((frame + strip) % 13));
+        for (int strip = 0; strip < 8; strip++)
+            stream.insert(stream.end(), {0xB0, static_cast<uint8_t>(0x30 + strip), static_cast<uint8_t>(frame % 12)});
+        if (frame % 10 == 0) {
+            stream.insert(stream.end(), {0xF0, 0x00, 0x00, 0x66, 0x14, 0x12, 0x00});
+            for (int idx = 0; idx < 56; idx++)
+                stream.push_back('a' + (idx + frame) % 26);
+            stream.push_back(0xF7);
+        }
+    }
+    return stream;
+}
+
+static double time_parse(Mc_midi_parser& parser, const std::vector<uint8_t>& stream)
+{
+    const int num_rounds = 100;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < num_rounds; round++)
+        parser.parse(stream.data(), stream.size());
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ((double)num_rounds * stream.size());
+}
+
+static void benchmark()
+{
+    std::vector<uint8_t> stream = make_stream();
+    Mc_midi_parser unrouted;
+    printf("%zu byte stream, nothing routed: %.2f ns/byte\n", stream.size(), time_parse(unrouted, stream));
+
+    Ram_display mem;
+    Ssd1306 display(&mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Mono_graphics screen(&display, Display_rotation::Landscape0);
+    MonoMonoFont font(12, 6, gsc_ssd1306_ascii_1206, sizeof(gsc_ssd1306_ascii_1206));
+    Mc_midi_parser routed;
+    std::vector<Mc_channel_text*> texts;
+    std::vector<Mc_meter*> meters;
+    std::vector<Vpot_display*> vpots;
+    for (uint8_t strip = 0; strip < 8; strip++) {
+        texts.push_back(new Mc_channel_text(screen, (strip % 3) * 42, 40, strip, font));
+        meters.push_back(new Mc_meter(screen, strip * 16, 0, strip));
+        vpots.push_back(new Vpot_display(screen, strip * 16 + 8, 20, Vpot_mode::SINGLE_DOT, 0, false));
+        routed.set_channel_text(strip, texts.back());
+        routed.set_meter(strip, meters.back());
+        routed.set_vpot(strip, vpots.back());
+    }
+    printf("%zu byte stream, routed to 8 strips, drawing included: %.2f ns/byte\n", stream.size(), time_parse(routed, stream));
+    for (uint8_t strip = 0; strip < 8; strip++) {
+        delete texts[strip];
+        delete meters[strip];
+        delete vpots[strip];
+    }
+}
+
+int main()
+{
+    test_routing();
+    benchmark();
+    return test_result();
+}
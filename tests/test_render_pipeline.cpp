@@ -0,0 +1,120 @@
+/**
+ * @file test_render_pipeline.cpp
+ * @brief Race the Render_pipeline producer against its flush thread and
+ * check that the display ends up with the same memory as a screen that
+ * renders directly. Also report the handoff latency.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <initializer_list>
+#include <thread>
+#include "render_pipeline.h"
+#include "ram_display.h"
+#include "test_check.h"
+
+using namespace rppicomidi;
+
+// A display with a bus that takes ns_per_byte for each data byte
+class Slow_ram_display : public Ram_display {
+public:
+    Slow_ram_display(uint32_t ns_per_byte_) : ns_per_byte{ns_per_byte_} {}
+    bool write_data(const uint8_t* data, size_t nbytes) override
+    {
+        auto until = std::chrono::steady_clock::now() + std::chrono::nanoseconds(nbytes * ns_per_byte);
+        while (ns_per_byte && std::chrono::steady_clock::now() < until) {
+        }
+        return Ram_display::write_data(data, nbytes);
+    }
+private:
+    uint32_t ns_per_byte;
+};
+
+static void test_handoff(Display_rotation rotation, uint32_t ns_per_byte, int num_frames)
+{
+    Slow_ram_display piped_mem(ns_per_byte);
+    Ram_display direct_mem;
+    Ssd1306 piped_display(&piped_mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Ssd1306 direct_display(&direct_mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Mono_graphics piped(&piped_display, rotation);
+    Mono_graphics direct(&direct_display, rotation);
+    piped.render();
+    direct.render();
+
+    Render_pipeline pipeline(piped);
+    pipeline.start();
+    uint8_t width = piped.get_screen_width();
+    uint8_t height = piped.get_screen_height();
+    uint32_t num_published = 0;
+    for (int frame = 0; frame < num_frames; frame++) {
+        for (int rect = rand() % 4; rect > 0; rect--) {
+            uint8_t x = rand() % width;
+            uint8_t y = rand() % height;
+            uint8_t w = 1 + rand() % (width - x);
+            uint8_t h = 1 + rand() % (height - y);
+            Pixel_state color = (rand() & 1) ? Pixel_state::PIXEL_ONE : Pixel_state::PIXEL_XOR;
+            piped.draw_rectangle(x, y, w, h, color, color);
+            direct.draw_rectangle(x, y, w, h, color, color);
+        }
+        if (rand() % 50 == 0) {
+            uint8_t line = rand() % 64;
+            piped.set_start_line(line);
+            direct.set_start_line(line);
+        }
+        if (pipeline.publish())
+            ++num_published;
+        direct.render_dirty();
+        if (ns_per_byte)
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        else if (frame % 2)
+            std::this_thread::yield();
+    }
+    // Let the flush thread catch up
+    while (pipeline.get_num_flushed() + pipeline.get_num_coalesced() < pipeline.get_num_published())
+        std::this_thread::yield();
+    pipeline.stop();
+
+    printf("rotation %3d, %5u ns/byte: %u published, %u flushed, %u coalesced, latency max %u us\n",
+        static_cast<int>(rotation), ns_per_byte, pipeline.get_num_published(), pipeline.get_num_flushed(),
+        pipeline.get_num_coalesced(), pipeline.get_max_latency_us());
+    CHECK(piped_mem.same_mem(direct_mem));
+    CHECK(piped_mem.start_line == direct_mem.start_line);
+    CHECK(pipeline.get_num_published() == num_published);
+    CHECK(pipeline.get_num_flushed() + pipeline.get_num_coalesced() == pipeline.get_num_published());
+    if (ns_per_byte)
+        CHECK(pipeline.get_num_coalesced() != 0);
+}
+
+int main()
+{
+    srand(1);
+    for (Display_rotation rotation : {Display_rotation::Landscape0, Display_rotation::Portrait90,
+            Display_rotation::Landscape180, Display_rotation::Portrait270}) {
+        // A fast bus, then one that is slower than the producer so frames coalesce
+        test_handoff(rotation, 0, 2000);
+        test_handoff(rotation, 25000, 30);
+    }
+    return test_result();
+}
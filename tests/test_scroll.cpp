@@ -0,0 +1,156 @@
+/**
+ * @file test_scroll.cpp
+ * @brief Compare random Mono_graphics::scroll() calls against a pixel by
+ * pixel reference in every rotation.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+#include "mono_graphics_lib.h"
+#include "ram_display.h"
+#include "test_check.h"
+
+using namespace rppicomidi;
+
+// The pixels of the screen, one byte per pixel, read from the canvas
+// layout that Ssd1306::set_pixel_on_canvas() writes
+struct Pixels {
+    int width;
+    int height;
+    std::vector<uint8_t> on;
+
+    Pixels(Mono_graphics& screen) : width{screen.get_screen_width()}, height{screen.get_screen_height()}, on(width * height)
+    {
+        const uint8_t* canvas = screen.get_canvas();
+        bool portrait = height > width;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                uint8_t byte = portrait ? canvas[x / 8 + y * screen.get_num_pages()] : canvas[(y / 8) * width + x];
+                on[y * width + x] = (byte >> (portrait ? x % 8 : y % 8)) & 1;
+            }
+        }
+    }
+    uint8_t& at(int x, int y) { return on[y * width + x]; }
+};
+
+struct Rect {
+    int x0, y0, x1, y1;
+};
+
+// Move the pixels one at a time as the scroll() documentation says
+static void reference_scroll(Pixels& pixels, const Rect& clip, int x, int y, int width, int height, int dx, int dy, Pixel_state fill)
+{
+    Rect region{std::max(x, clip.x0), std::max(y, clip.y0), std::min(x + width - 1, clip.x1), std::min(y + height - 1, clip.y1)};
+    Pixels old = pixels;
+    for (int py = region.y0; py <= region.y1; py++) {
+        for (int px = region.x0; px <= region.x1; px++) {
+            int sx = px - dx;
+            int sy = py - dy;
+            uint8_t& dst = pixels.at(px, py);
+            if (sx >= region.x0 && sx <= region.x1 && sy >= region.y0 && sy <= region.y1)
+                dst = old.at(sx, sy);
+            else if (fill == Pixel_state::PIXEL_ZERO)
+                dst = 0;
+            else if (fill == Pixel_state::PIXEL_ONE)
+                dst = 1;
+            else if (fill == Pixel_state::PIXEL_XOR)
+                dst = !old.at(px, py);
+        }
+    }
+}
+
+static void draw_random_dots(Mono_graphics& screen, int num_dots)
+{
+    screen.set_clip_rect(0, 0, screen.get_screen_width() - 1, screen.get_screen_height() - 1);
+    for (int dot = 0; dot < num_dots; dot++)
+        screen.draw_dot(rand() % screen.get_screen_width(), rand() % screen.get_screen_height(), Pixel_state::PIXEL_XOR);
+}
+
+static void test_rotation(Display_rotation rotation, uint8_t display_height)
+{
+    Ram_display mem;
+    Ssd1306 display(&mem, display_height == 64 ? Ssd1306::Com_pin_cfg::ALT_DIS : Ssd1306::Com_pin_cfg::SEQ_DIS,
+        128, display_height, 0, 0);
+    Mono_graphics screen(&display, rotation);
+    int w = screen.get_screen_width();
+    int h = screen.get_screen_height();
+    draw_random_dots(screen, w * h);
+    Pixels expected(screen);
+    uint32_t num_bad = 0;
+    for (int call = 0; call < 20000; call++) {
+        if (call % 50 == 0) {
+            draw_random_dots(screen, 200);
+            expected = Pixels(screen);
+        }
+        Rect clip{0, 0, w - 1, h - 1};
+        if (rand() % 2) {
+            clip.x0 = rand() % w;
+            clip.y0 = rand() % h;
+            clip.x1 = clip.x0 + rand() % (w - clip.x0);
+            clip.y1 = clip.y0 + rand() % (h - clip.y0);
+        }
+        screen.set_clip_rect(clip.x0, clip.y0, clip.x1, clip.y1);
+        int x, y, width, height, dx, dy;
+        if (rand() % 3 == 0) {
+            // Whole pages moved along the columns, the memmove path
+            x = rand() % (w / 8) * 8;
+            y = rand() % (h / 8) * 8;
+            width = (1 + rand() % ((w - x) / 8)) * 8;
+            height = (1 + rand() % ((h - y) / 8)) * 8;
+            dx = rand() % 2 ? rand() % 41 - 20 : 0;
+            dy = dx == 0 ? rand() % 41 - 20 : 0;
+        }
+        else {
+            // Any rectangle, including ones that run past the screen and past 255
+            x = rand() % w;
+            y = rand() % h;
+            width = rand() % 256;
+            height = rand() % 256;
+            dx = rand() % 4 ? rand() % 21 - 10 : rand() % 256 - 128;
+            dy = rand() % 4 ? rand() % 21 - 10 : rand() % 256 - 128;
+        }
+        Pixel_state fill = static_cast<Pixel_state>(rand() % 4);
+        screen.scroll(x, y, width, height, dx, dy, fill);
+        reference_scroll(expected, clip, x, y, width, height, dx, dy, fill);
+        if (Pixels(screen).on != expected.on) {
+            ++num_bad;
+            expected = Pixels(screen);
+        }
+    }
+    CHECK(num_bad == 0);
+}
+
+int main()
+{
+    for (uint8_t display_height : {64, 32}) {
+        for (Display_rotation rotation : {Display_rotation::Landscape0, Display_rotation::Portrait90,
+                Display_rotation::Landscape180, Display_rotation::Portrait270})
+            test_rotation(rotation, display_height);
+    }
+    return test_result();
+}
@@ -0,0 +1,168 @@
+/**
+ * @file test_scroll_menu.cpp
+ * @brief Move a Scroll_menu selection at random and check that every
+ * painted frame matches a menu drawn from scratch.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+#include "scroll_menu.h"
+#include "ram_display.h"
+#include "test_check.h"
+#include "../ext_lib/ssd1306/src/driver_ssd1306_font.h"
+
+using namespace rppicomidi;
+
+static std::vector<std::string> items;
+
+static const char* get_item_text(uint16_t item, void*)
+{
+    return items.at(item).c_str();
+}
+
+static std::string random_item_text()
+{
+    std::string text;
+    for (int len = rand() % 30; len > 0; len--)
+        text.push_back(' ' + rand() % 95);
+    return text;
+}
+
+// The menu as the documentation describes it, drawn on an empty canvas
+struct Reference_menu {
+    Mono_graphics& screen;
+    uint8_t x, y, width, height;
+    const MonoMonoFont& font;
+    bool uses_start_line;
+    uint16_t selected = 0;
+    uint16_t first = 0;
+
+    void move_selection(int32_t delta)
+    {
+        int32_t item = std::max<int32_t>(selected + delta, 0);
+        selected = std::min<int32_t>(item, std::max<int32_t>(items.size() - 1, 0));
+    }
+
+    void draw()
+    {
+        uint8_t row_height = (font.height + 7) / 8 * 8;
+        int num_rows = height / row_height;
+        int num_items = items.size();
+        // Keep the selection in view with as little scrolling as possible and
+        // no empty rows at the bottom
+        first = std::min<int>(first, selected);
+        first = std::max<int>(first, selected - num_rows + 1);
+        first = std::max(0, std::min<int>(first, num_items - num_rows));
+        screen.clear_canvas();
+        screen.set_start_line(uses_start_line ? (first % num_rows) * row_height : 0);
+        for (int item = first; item < first + num_rows; item++) {
+            uint8_t row_y = y + (uses_start_line ? item % num_rows : item - first) * row_height;
+            bool is_selected = item == selected && item < num_items;
+            Pixel_state fg = is_selected ? Pixel_state::PIXEL_ZERO : Pixel_state::PIXEL_ONE;
+            Pixel_state bg = is_selected ? Pixel_state::PIXEL_ONE : Pixel_state::PIXEL_ZERO;
+            screen.draw_rectangle(x, row_y, width, row_height, bg, bg);
+            if (item < num_items) {
+                std::string text = items[item].substr(0, width / font.width);
+                screen.draw_string(font, x, row_y + (row_height - font.height) / 2, text.c_str(), text.size(), fg, bg);
+            }
+        }
+    }
+};
+
+static void test_against_reference(uint8_t display_height, Display_rotation rotation, uint8_t x, uint8_t y,
+    uint8_t width, uint8_t height, bool expect_start_line)
+{
+    Ram_display mem, reference_mem;
+    Ssd1306::Com_pin_cfg com_pins = display_height == 64 ? Ssd1306::Com_pin_cfg::ALT_DIS : Ssd1306::Com_pin_cfg::SEQ_DIS;
+    Ssd1306 display(&mem, com_pins, 128, display_height, 0, 0);
+    Ssd1306 reference_display(&reference_mem, com_pins, 128, display_height, 0, 0);
+    Mono_graphics screen(&display, rotation);
+    Mono_graphics reference_screen(&reference_display, rotation);
+    MonoMonoFont font(12, 6, gsc_ssd1306_ascii_1206, sizeof(gsc_ssd1306_ascii_1206));
+
+    items.clear();
+    for (int item = rand() % 100; item > 0; item--)
+        items.push_back(random_item_text());
+    Widget_root root(screen);
+    Scroll_menu menu(screen, x, y, width, height, font, get_item_text, nullptr, items.size());
+    root.add(menu);
+    CHECK(menu.uses_start_line() == expect_start_line);
+    Reference_menu reference{reference_screen, x, y, width, height, font, expect_start_line};
+
+    size_t nbytes = screen.get_canvas_nbytes();
+    uint32_t num_bad = 0, num_text_requests = 0;
+    for (int frame = 0; frame < 5000; frame++) {
+        // Mostly encoder counts, sometimes a fast spin
+        int32_t delta = rand() % 4 ? rand() % 7 - 3 : rand() % 101 - 50;
+        menu.move_selection(delta);
+        reference.move_selection(delta);
+        if (rand() % 10 == 0 && !items.empty()) {
+            uint16_t item = rand() % items.size();
+            items[item] = random_item_text();
+            menu.invalidate_item(item);
+        }
+        if (rand() % 50 == 0) {
+            // Mostly remove items, which can move the selection and the first visible item
+            size_t num_items = rand() % 3 ? rand() % (items.size() + 1) : items.size() + rand() % 50;
+            while (items.size() < num_items)
+                items.push_back(random_item_text());
+            items.resize(num_items);
+            menu.set_num_items(num_items);
+            reference.move_selection(0);
+        }
+        root.render_frame();
+        reference.draw();
+        if (memcmp(screen.get_canvas(), reference_screen.get_canvas(), nbytes) != 0 ||
+                screen.get_start_line() != reference_screen.get_start_line() || menu.get_selected() != reference.selected ||
+                menu.get_first_visible() != reference.first)
+            ++num_bad;
+        num_text_requests += menu.get_num_text_requests();
+        menu.reset_counters();
+    }
+    printf("%ux%u screen, menu %ux%u at (%u,%u): %u text requests in 5000 frames\n", screen.get_screen_width(),
+        screen.get_screen_height(), width, height, x, y, num_text_requests);
+    CHECK(num_bad == 0);
+}
+
+int main()
+{
+    srand(1);
+    for (uint8_t display_height : {64, 32}) {
+        for (Display_rotation rotation : {Display_rotation::Landscape0, Display_rotation::Portrait90,
+                Display_rotation::Landscape180, Display_rotation::Portrait270}) {
+            bool is_portrait = rotation == Display_rotation::Portrait90 || rotation == Display_rotation::Portrait270;
+            uint8_t width = is_portrait ? display_height : 128;
+            uint8_t height = is_portrait ? 128 : display_height;
+            // Only the whole screen of a 64-row display in a landscape rotation uses the start line
+            test_against_reference(display_height, rotation, 0, 0, width, height, !is_portrait && display_height == 64);
+            test_against_reference(display_height, rotation, 3, 2, width - 10, height - 2 - height % 16, false);
+        }
+    }
+    return test_result();
+}
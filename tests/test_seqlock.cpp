@@ -0,0 +1,363 @@
+/**
+ * @file test_seqlock.cpp
+ * @brief Race SeqLock readers against writers and check that every copy
+ * the reader accepts is consistent. The Encoder and MultiEncoder tests run
+ * the real interrupt handler path against the real perform_capture(), from
+ * a second thread and from a timer signal that interrupts the reader like
+ * an interrupt on the same core.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <sys/time.h>
+#include "encoder.hpp"
+#include "multi_encoder.hpp"
+#include "encoder.pio.h"
+#include "seqlock.hpp"
+#include "test_check.h"
+
+using namespace pimoroni;
+
+// The same shape of data as an Encoder: a count, the time since the last
+// step and a 64-bit running total of step time. Each write keeps
+// total == count * step_time and time_since == count & 0xFFFF.
+struct Shared {
+    SeqLock lock;
+    std::atomic<int32_t> count{0};
+    std::atomic<uint32_t> time_since{0};
+    std::atomic<uint32_t> total_low{0};
+    std::atomic<uint32_t> total_high{0};
+};
+
+// Large enough that the low word of the total wraps
+static const uint64_t step_time = 0x12345;
+
+// If stall is true, the writer gives up the CPU half way through the
+// write, so even a single CPU host runs the reader in the middle of it
+static void write(Shared& shared, int32_t count, bool stall)
+{
+    uint64_t total = (uint64_t)count * step_time;
+    shared.lock.write_begin();
+    shared.count.store(count, std::memory_order_relaxed);
+    if (stall)
+        std::this_thread::yield();
+    shared.time_since.store(count & 0xFFFF, std::memory_order_relaxed);
+    shared.total_low.store((uint32_t)total, std::memory_order_relaxed);
+    shared.total_high.store((uint32_t)(total >> 32), std::memory_order_relaxed);
+    shared.lock.write_end();
+}
+
+struct Copy {
+    int32_t count;
+    uint32_t time_since;
+    uint64_t total;
+    bool is_consistent() const {
+        return total == (uint64_t)count * step_time && time_since == ((uint32_t)count & 0xFFFF);
+    }
+};
+
+// Returns the number of retries the read took. Like write(), the reader
+// can give up the CPU in the middle of its first copy.
+static uint32_t read(const Shared& shared, Copy& copy, bool stall)
+{
+    for (uint32_t num_retries = 0; ; num_retries++) {
+        uint32_t start = shared.lock.read_begin();
+        copy.count = shared.count.load(std::memory_order_relaxed);
+        if (stall && num_retries == 0)
+            std::this_thread::yield();
+        copy.time_since = shared.time_since.load(std::memory_order_relaxed);
+        copy.total = shared.total_low.load(std::memory_order_relaxed) |
+            ((uint64_t)shared.total_high.load(std::memory_order_relaxed) << 32);
+        if (!shared.lock.read_retry(start))
+            return num_retries;
+    }
+}
+
+static void test_single_thread()
+{
+    SeqLock lock;
+    uint32_t start = lock.read_begin();
+    CHECK(!lock.read_retry(start));
+    lock.write_begin();
+    lock.write_end();
+    CHECK(lock.read_retry(start));
+    start = lock.read_begin();
+    CHECK(!lock.read_retry(start));
+}
+
+static void test_two_threads(int32_t num_writes)
+{
+    Shared shared;
+    std::atomic<bool> done{false};
+    std::thread writer([&shared, &done, num_writes]() {
+        for (int32_t count = 1; count <= num_writes; count++) {
+            write(shared, count, (count & 0x3FFF) == 0);
+            if ((count & 0xFF) == 0)
+                std::this_thread::yield();
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    uint32_t num_reads = 0;
+    uint32_t num_retries = 0;
+    uint32_t num_torn = 0;
+    uint32_t num_backwards = 0;
+    int32_t last_count = 0;
+    Copy copy;
+    while (!done.load(std::memory_order_acquire)) {
+        num_retries += read(shared, copy, (num_reads & 0xFF) == 0);
+        ++num_reads;
+        if (!copy.is_consistent())
+            ++num_torn;
+        if (copy.count < last_count)
+            ++num_backwards;
+        last_count = copy.count;
+    }
+    writer.join();
+    read(shared, copy, false);
+
+    printf("%d writes, %u reads, %u retries\n", num_writes, num_reads, num_retries);
+    CHECK(num_torn == 0);
+    CHECK(num_backwards == 0);
+    CHECK(copy.count == num_writes && copy.is_consistent());
+}
+
+static const uint8_t gray_cw[] = {0b00, 0b10, 0b11, 0b01};
+
+// The word the encoder PIO program pushes for the clockwise microstep from
+// position pos to pos + 1 that took step_time PIO loops
+static uint32_t encoder_word(uint32_t pos, uint32_t step_time)
+{
+    return ((uint32_t)gray_cw[(pos + 1) & 3] << 30) | ((uint32_t)gray_cw[pos & 3] << 28) |
+        (step_time - ENC_DEBOUNCE_TIME);
+}
+
+// Every step of an encoder takes step_time, so a capture that copied the
+// count and the total step time together has a time change of exactly
+// count change * step_time, and its frequency follows from that
+struct Capture_checker {
+    uint32_t clocks_per_time;
+    uint32_t step_time;
+    int32_t sign;
+    int32_t last_count = 0;
+    uint32_t num_captures = 0;
+    uint32_t num_moving = 0;
+    uint32_t num_bad = 0;
+
+    void check(const Capture& capture)
+    {
+        int32_t change = capture.get_count_change();
+        uint64_t time = (uint64_t)(change * sign) * step_time;
+        q16_t expected = 0;
+        if (change != 0 && time < INT32_MAX)
+            expected = q16::divide(((int64_t)clocks_per_time * change) << 16, (uint32_t)time);
+        if (change * sign < 0 || capture.get_count() != last_count + change || capture.get_frequency_q16() != expected)
+            ++num_bad;
+        last_count = capture.get_count();
+        ++num_captures;
+        if (change != 0)
+            ++num_moving;
+    }
+};
+
+static const uint32_t encoder_clocks = 125000000 / ENC_LOOP_CYCLES;
+
+// The writer thread feeds the words through the RX FIFO and the PIO0
+// interrupt handler while the reader captures
+static void test_encoder_threads(uint32_t step_time, uint32_t num_words)
+{
+    Encoder encoder(pio0, 0, 1, Encoder::PIN_UNUSED, 24, true);
+    CHECK(encoder.init());
+    std::atomic<bool> done{false};
+    std::thread writer([&encoder, &done, step_time, num_words]() {
+        for (uint32_t pos = 0; pos < num_words; pos++) {
+            host_pio_push(pio0, 0, encoder_word(pos, step_time));
+            if (pos % 4 == 3)
+                Encoder::pio0_interrupt_callback();
+            // Give a single CPU host a chance to run the reader
+            if (pos % 64 == 63)
+                std::this_thread::yield();
+        }
+        Encoder::pio0_interrupt_callback();
+        done.store(true, std::memory_order_release);
+    });
+    Capture_checker checker{encoder_clocks, step_time, 1};
+    while (!done.load(std::memory_order_acquire))
+        checker.check(encoder.perform_capture());
+    writer.join();
+    checker.check(encoder.perform_capture());
+    printf("Encoder, two threads, step time %u: %u captures, %u moving\n", step_time, checker.num_captures, checker.num_moving);
+    CHECK(checker.num_bad == 0);
+    CHECK(checker.last_count == (int32_t)num_words);
+    CHECK(encoder.get_count() == (int32_t)num_words);
+}
+
+// A timer signal stands in for the encoder interrupt. It runs on the
+// reader's thread at any point of perform_capture(), as the interrupt
+// does on the core that captures.
+static Encoder* irq_encoder;
+static const uint32_t* irq_words;
+static uint32_t irq_num_words;
+static std::atomic<uint32_t> irq_next;
+
+static void encoder_irq(int)
+{
+    uint32_t next = irq_next.load(std::memory_order_relaxed);
+    uint32_t num_words = std::min(irq_num_words - next, 1 + next % 7);
+    irq_encoder->process_words(irq_words + next, num_words);
+    irq_next.store(next + num_words, std::memory_order_relaxed);
+}
+
+static void start_timer_signal(void (*handler)(int))
+{
+    signal(SIGALRM, handler);
+    itimerval interval{{0, 20}, {0, 20}};
+    setitimer(ITIMER_REAL, &interval, nullptr);
+}
+
+static void stop_timer_signal()
+{
+    itimerval off{{0, 0}, {0, 0}};
+    setitimer(ITIMER_REAL, &off, nullptr);
+    signal(SIGALRM, SIG_DFL);
+}
+
+static void test_encoder_interrupts(uint32_t step_time, uint32_t num_words)
+{
+    std::vector<uint32_t> words;
+    for (uint32_t pos = 0; pos < num_words; pos++)
+        words.push_back(encoder_word(pos, step_time));
+    Encoder encoder(pio0, 0, 1, Encoder::PIN_UNUSED, 24, true);
+    irq_encoder = &encoder;
+    irq_words = words.data();
+    irq_num_words = num_words;
+    irq_next.store(0);
+    Capture_checker checker{encoder_clocks, step_time, 1};
+    start_timer_signal(encoder_irq);
+    while (irq_next.load(std::memory_order_relaxed) != num_words)
+        checker.check(encoder.perform_capture());
+    stop_timer_signal();
+    checker.check(encoder.perform_capture());
+    printf("Encoder, timer signal, step time %u: %u captures, %u moving\n", step_time, checker.num_captures, checker.num_moving);
+    CHECK(checker.num_bad == 0);
+    CHECK(checker.last_count == (int32_t)num_words);
+}
+
+// The MultiEncoder word for step idx of two encoders on pins 0 to 3.
+// Encoder 0 turns clockwise every step and encoder 1 counter-clockwise
+// every other step.
+static uint32_t multi_encoder_word(uint32_t idx)
+{
+    uint8_t states[2] = {gray_cw[(idx + 1) & 3], gray_cw[(0u - (idx + 1) / 2) & 3]};
+    uint32_t word = 0;
+    for (int enc = 0; enc < 2; enc++) {
+        // The PIO word has A in the lower bit of each pair
+        uint32_t pair = ((states[enc] >> 1) & 1u) | ((states[enc] & 1u) << 1);
+        word |= pair << (2 * enc);
+    }
+    return word;
+}
+
+static MultiEncoder* irq_multi_encoder;
+static uint32_t irq_step_us;
+
+// Each word takes step_us microseconds of the host's stand-in clock
+static void multi_encoder_step(uint32_t idx, uint32_t step_us)
+{
+    host_time_us.fetch_add(step_us, std::memory_order_relaxed);
+    host_pio_push(pio1, 0, multi_encoder_word(idx));
+    MultiEncoder::pio1_interrupt_callback();
+}
+
+static void multi_encoder_irq(int)
+{
+    uint32_t next = irq_next.load(std::memory_order_relaxed);
+    uint32_t last = std::min(irq_num_words, next + 1 + next % 7);
+    for (; next < last; next++)
+        multi_encoder_step(next, irq_step_us);
+    irq_next.store(next, std::memory_order_relaxed);
+}
+
+static void test_multi_encoder(uint32_t step_us, uint32_t num_words, bool use_timer_signal)
+{
+    host_time_manual.store(true);
+    host_time_us.store(1000);
+    MultiEncoder encoders(pio1, 0, 2, 24, true);
+    CHECK(encoders.init());
+    Capture_checker checkers[2] = {{1000000, step_us, 1}, {1000000, 2 * step_us, -1}};
+    auto capture_both = [&encoders, &checkers]() {
+        for (uint8_t enc = 0; enc < 2; enc++)
+            checkers[enc].check(encoders.perform_capture(enc));
+    };
+    if (use_timer_signal) {
+        irq_multi_encoder = &encoders;
+        irq_num_words = num_words;
+        irq_step_us = step_us;
+        irq_next.store(0);
+        start_timer_signal(multi_encoder_irq);
+        while (irq_next.load(std::memory_order_relaxed) != num_words)
+            capture_both();
+        stop_timer_signal();
+    }
+    else {
+        std::atomic<bool> done{false};
+        std::thread writer([&done, step_us, num_words]() {
+            for (uint32_t idx = 0; idx < num_words; idx++) {
+                multi_encoder_step(idx, step_us);
+                if (idx % 64 == 63)
+                    std::this_thread::yield();
+            }
+            done.store(true, std::memory_order_release);
+        });
+        while (!done.load(std::memory_order_acquire))
+            capture_both();
+        writer.join();
+    }
+    capture_both();
+    host_time_manual.store(false);
+    printf("MultiEncoder, %s, step time %u us: %u captures, %u and %u moving\n", use_timer_signal ? "timer signal" : "two threads",
+        step_us, checkers[0].num_captures, checkers[0].num_moving, checkers[1].num_moving);
+    CHECK(checkers[0].num_bad == 0 && checkers[1].num_bad == 0);
+    CHECK(checkers[0].last_count == (int32_t)num_words);
+    CHECK(checkers[1].last_count == -(int32_t)(num_words / 2));
+}
+
+int main()
+{
+    test_single_thread();
+    test_two_threads(2000000);
+    // Steps of 2^28 PIO loops wrap the low word of the total time every 16 steps
+    for (uint32_t step_time : {1000u, 0x0fffffffu + ENC_DEBOUNCE_TIME}) {
+        test_encoder_threads(step_time, 100000);
+        test_encoder_interrupts(step_time, 100000);
+    }
+    for (uint32_t step_us : {3u, 1u << 20}) {
+        test_multi_encoder(step_us, 100000, false);
+        test_multi_encoder(step_us, 50000, true);
+    }
+    return test_result();
+}
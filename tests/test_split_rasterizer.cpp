@@ -0,0 +1,165 @@
+/**
+ * @file test_split_rasterizer.cpp
+ * @brief Check that Split_rasterizer draws a trace the same as a single
+ * replay, and compare the time each band takes with the single replay.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+#include "split_rasterizer.h"
+#include "draw_trace.h"
+#include "ram_display.h"
+#include "test_check.h"
+#include "../ext_lib/ssd1306/src/driver_ssd1306_font.h"
+
+using namespace rppicomidi;
+
+static const uint8_t sprite_bits[] = {0xFF, 0x81, 0x81, 0xFF, 0x0F, 0x0F, 0x0F, 0x0F};
+static const uint8_t sprite_mask[] = {0xFF, 0xFF, 0xFF, 0xFF, 0x0F, 0x0F, 0x0F, 0x0F};
+
+// Draw num_calls random calls. Coordinates may be off the screen.
+static void draw_random(Mono_graphics& screen, const MonoMonoFont& font, int num_calls, bool with_scroll)
+{
+    uint8_t width = screen.get_screen_width();
+    uint8_t height = screen.get_screen_height();
+    for (int call = 0; call < num_calls; call++) {
+        Pixel_state fg = static_cast<Pixel_state>(rand() % 3);
+        Pixel_state bg = static_cast<Pixel_state>(rand() % 4 == 0 ? 3 : rand() % 3);
+        uint8_t x = rand() % (width + 10);
+        uint8_t y = rand() % (height + 10);
+        uint8_t p = rand() % 60;
+        uint8_t q = rand() % 60;
+        switch (rand() % (with_scroll ? 8 : 7)) {
+            case 0:
+                screen.draw_dot(x % width, y % height, fg);
+                break;
+            case 1:
+                screen.draw_line(x % width, y % height, p % width, q % height, fg);
+                break;
+            case 2:
+                screen.draw_rectangle(x, y, p, q, fg, bg);
+                break;
+            case 3:
+                screen.draw_centered_circle(x, y, p / 3, fg, bg);
+                break;
+            case 4:
+                screen.draw_string(font, x, y, "Hi!", 3, fg, bg);
+                break;
+            case 5:
+            {
+                Mono_sprite sprite{4, 12, sprite_bits, (rand() & 1) ? sprite_mask : nullptr};
+                screen.draw_sprite(x, y, sprite);
+                break;
+            }
+            case 6:
+            {
+                uint8_t x0 = rand() % width;
+                uint8_t y0 = rand() % height;
+                screen.set_clip_rect(x0, y0, x0 + rand() % (width - x0), y0 + rand() % (height - y0));
+                break;
+            }
+            case 7:
+                screen.scroll(x % width, y % height, p, q, rand() % 21 - 10, rand() % 21 - 10, bg);
+                break;
+        }
+    }
+    screen.set_clip_rect(0, 0, width - 1, height - 1);
+}
+
+static void test_rotation(Display_rotation rotation)
+{
+    MonoMonoFont font(12, 6, gsc_ssd1306_ascii_1206, sizeof(gsc_ssd1306_ascii_1206));
+    const MonoMonoFont* fonts[] = {&font};
+    Ram_display recorded_mem, split_mem, single_mem;
+    Ssd1306 recorded_display(&recorded_mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Ssd1306 split_display(&split_mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Ssd1306 single_display(&single_mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Mono_graphics recorded(&recorded_display, rotation);
+    Mono_graphics split(&split_display, rotation);
+    Mono_graphics single(&single_display, rotation);
+    recorded.render();
+    split.render();
+    single.render();
+
+    Draw_trace trace(16);
+    trace.add_font(font);
+    recorded.set_trace(&trace);
+    Split_rasterizer rasterizer(split, fonts, 1);
+    rasterizer.start();
+
+    std::vector<uint8_t> bytes(1 << 16);
+    uint32_t num_bad = 0;
+    double single_us = 0;
+    double split_us = 0;
+    double band_us[Split_rasterizer::num_bands] = {0, 0};
+    int num_full_frames = 0;
+    for (int frame = 0; frame < 300; frame++) {
+        // Every 10th frame redraws the whole screen. Frames with a scroll
+        // are drawn on one core.
+        bool full = frame % 10 == 0;
+        if (full)
+            recorded.clear_canvas();
+        draw_random(recorded, font, full ? 200 : 1 + rand() % 10, !full);
+        size_t nbytes = trace.read(bytes.data(), bytes.size());
+
+        auto start = std::chrono::steady_clock::now();
+        Draw_trace::replay(bytes.data(), nbytes, single, fonts, 1);
+        auto single_end = std::chrono::steady_clock::now();
+        rasterizer.rasterize(bytes.data(), nbytes);
+        auto split_end = std::chrono::steady_clock::now();
+        if (full) {
+            single_us += std::chrono::duration<double, std::micro>(single_end - start).count();
+            split_us += std::chrono::duration<double, std::micro>(split_end - single_end).count();
+            for (uint8_t band = 0; band < Split_rasterizer::num_bands; band++)
+                band_us[band] += rasterizer.get_band_us(band);
+            ++num_full_frames;
+        }
+
+        recorded.render();
+        split.render_dirty();
+        single.render_dirty();
+        if (memcmp(recorded.get_canvas(), split.get_canvas(), recorded.get_canvas_nbytes()) != 0 ||
+                !recorded_mem.same_mem(split_mem) || !recorded_mem.same_mem(single_mem))
+            ++num_bad;
+    }
+    rasterizer.stop();
+    CHECK(trace.get_num_dropped() == 0);
+    CHECK(num_bad == 0);
+    printf("rotation %3d full frames: single replay %.1f us, split %.1f us, bands %.1f us and %.1f us\n",
+        static_cast<int>(rotation), single_us / num_full_frames, split_us / num_full_frames,
+        band_us[0] / num_full_frames, band_us[1] / num_full_frames);
+}
+
+int main()
+{
+    srand(3);
+    for (Display_rotation rotation : {Display_rotation::Landscape0, Display_rotation::Portrait90,
+            Display_rotation::Landscape180, Display_rotation::Portrait270})
+        test_rotation(rotation);
+    return test_result();
+}
@@ -0,0 +1,204 @@
+/**
+ * @file test_text_console.cpp
+ * @brief Check that painting a Text_console frame by frame leaves the same
+ * canvas as drawing it from scratch, and time both.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "text_console.h"
+#include "ram_display.h"
+#include "test_check.h"
+#include "../ext_lib/ssd1306/src/driver_ssd1306_font.h"
+
+using namespace rppicomidi;
+
+// A console and the screen it draws on
+struct Console_screen {
+    Ram_display mem;
+    Ssd1306 display;
+    Mono_graphics screen;
+    Widget_root root;
+    Text_console console;
+
+    Console_screen(Display_rotation rotation, uint8_t x, uint8_t y, uint8_t width, uint8_t height, const MonoMonoFont& font) :
+        display{&mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0}, screen{&display, rotation}, root{screen},
+        console{screen, x, y, width, height, font}
+    {
+        // A frame around the console, which painting the console must not touch
+        if (x > 0 && y > 0)
+            screen.draw_rectangle(x - 1, y - 1, width + 2, height + 2, Pixel_state::PIXEL_ONE, Pixel_state::PIXEL_TRANSPARENT);
+        root.add(console);
+    }
+};
+
+static std::string random_text(int max_len)
+{
+    std::string text;
+    for (int len = rand() % (max_len + 1); len > 0; len--) {
+        int kind = rand() % 20;
+        text.push_back(kind == 0 ? '\n' : kind == 1 ? '\r' : kind == 2 ? '\b' : kind == 3 ? '\x7f' : ' ' + rand() % 95);
+    }
+    return text;
+}
+
+// Make the same random calls on both consoles
+static void random_calls(Text_console& painted, Text_console& reference)
+{
+    auto both = [&painted, &reference](auto call) {
+        call(painted);
+        call(reference);
+    };
+    uint8_t num_cols = painted.get_num_cols();
+    uint8_t num_rows = painted.get_num_rows();
+    for (int num_calls = rand() % 4; num_calls > 0; num_calls--) {
+        switch (rand() % 9) {
+            case 0:
+            case 1:
+            {
+                std::string text = random_text(40);
+                both([&text](Text_console& console) { console.print(text.c_str()); });
+                break;
+            }
+            case 2:
+            {
+                char chr = ' ' + rand() % 95;
+                both([chr](Text_console& console) { console.put_char(chr); });
+                break;
+            }
+            case 3:
+            {
+                uint8_t col = rand() % num_cols;
+                uint8_t row = rand() % num_rows;
+                both([col, row](Text_console& console) { console.set_cursor(col, row); });
+                break;
+            }
+            case 4:
+            {
+                // Exactly fill a line, which leaves the wrap for the next character
+                uint8_t row = rand() % num_rows;
+                std::string text(num_cols, 'a' + rand() % 26);
+                if (rand() % 2)
+                    text.push_back(rand() % 2 ? '\n' : 'z');
+                both([row, &text](Text_console& console) {
+                    console.set_cursor(0, row);
+                    console.print(text.c_str());
+                });
+                break;
+            }
+            case 5:
+            {
+                // Scroll by more lines than the console has
+                std::string text(num_rows + rand() % (2 * num_rows), '\n');
+                text += random_text(10);
+                both([&text](Text_console& console) { console.print(text.c_str()); });
+                break;
+            }
+            case 6:
+            {
+                bool visible = rand() % 2;
+                both([visible](Text_console& console) { console.show_cursor(visible); });
+                break;
+            }
+            case 7:
+                if (rand() % 20 == 0)
+                    both([](Text_console& console) { console.clear(); });
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void test_paint_matches_draw(Display_rotation rotation, uint8_t x, uint8_t y, uint8_t width, uint8_t height,
+    const MonoMonoFont& font, bool expect_start_line)
+{
+    Console_screen painted(rotation, x, y, width, height, font);
+    Console_screen reference(rotation, x, y, width, height, font);
+    CHECK(painted.console.uses_start_line() == expect_start_line);
+    size_t nbytes = painted.screen.get_canvas_nbytes();
+    uint32_t num_bad = 0, num_wrap_pending = 0;
+    for (int frame = 0; frame < 5000; frame++) {
+        random_calls(painted.console, reference.console);
+        if (painted.console.get_cursor_col() == painted.console.get_num_cols())
+            ++num_wrap_pending;
+        painted.root.render_frame();
+        reference.console.draw();
+        if (memcmp(painted.screen.get_canvas(), reference.screen.get_canvas(), nbytes) != 0 ||
+                painted.screen.get_start_line() != reference.screen.get_start_line())
+            ++num_bad;
+    }
+    CHECK(num_bad == 0);
+    CHECK(num_wrap_pending != 0);
+}
+
+static void benchmark(const MonoMonoFont& font)
+{
+    Console_screen console_screen(Display_rotation::Landscape0, 0, 0, 128, 64, font);
+    Text_console& console = console_screen.console;
+    uint8_t first_col[8], last_col[8];
+    char line[32];
+    const int num_frames = 20000;
+    auto paint_start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < num_frames; frame++) {
+        snprintf(line, sizeof(line), "\nframe %d", frame);
+        console.print(line);
+        console_screen.root.paint();
+        console_screen.screen.take_dirty(first_col, last_col);
+    }
+    auto paint_end = std::chrono::steady_clock::now();
+    const int num_draws = 2000;
+    for (int idx = 0; idx < num_draws; idx++) {
+        console.draw();
+        console_screen.screen.take_dirty(first_col, last_col);
+    }
+    auto draw_end = std::chrono::steady_clock::now();
+    auto us = [](std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to, int count) {
+        return std::chrono::duration<double, std::micro>(to - from).count() / count;
+    };
+    printf("frame with 1 new line: %.2f us, full redraw: %.2f us\n", us(paint_start, paint_end, num_frames),
+        us(paint_end, draw_end, num_draws));
+}
+
+int main()
+{
+    srand(1);
+    MonoMonoFont font_12(12, 6, gsc_ssd1306_ascii_1206, sizeof(gsc_ssd1306_ascii_1206));
+    MonoMonoFont font_16(16, 8, gsc_ssd1306_ascii_1608, sizeof(gsc_ssd1306_ascii_1608));
+    // The whole screen with a font a whole number of pages high uses the start line
+    test_paint_matches_draw(Display_rotation::Landscape0, 0, 0, 128, 64, font_16, true);
+    test_paint_matches_draw(Display_rotation::Landscape180, 0, 0, 128, 64, font_16, true);
+    // Everything else scrolls the canvas
+    for (Display_rotation rotation : {Display_rotation::Landscape0, Display_rotation::Portrait90,
+            Display_rotation::Landscape180, Display_rotation::Portrait270})
+        test_paint_matches_draw(rotation, 3, 5, 50, 40, font_12, false);
+    test_paint_matches_draw(Display_rotation::Landscape0, 0, 0, 128, 64, font_12, false);
+    // 8 rows of 16 pixels scroll more than scroll() can move, so paint() draws everything
+    test_paint_matches_draw(Display_rotation::Portrait90, 0, 0, 64, 128, font_16, false);
+    benchmark(font_16);
+    return test_result();
+}
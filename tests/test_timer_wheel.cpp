@@ -0,0 +1,216 @@
+/**
+ * @file test_timer_wheel.cpp
+ * @brief Schedule, cancel and expire Timer_wheel timers at random on a
+ * simulated clock and check them and the hardware alarm against a
+ * reference.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <cstdint>
+#include <cstdlib>
+#include "timer_wheel.h"
+#include "test_check.h"
+
+using namespace rppicomidi;
+
+static const uint32_t tick_us = 1000;
+static const uint8_t log2_num_slots = 3;
+static const uint32_t rotation_us = tick_us << log2_num_slots;
+
+static uint64_t get_tick() { return time_us_64() / tick_us; }
+
+struct Test_timer;
+static void on_expiry(Timer_wheel::Timer& timer, void* context);
+
+static Timer_wheel* wheel;
+static Test_timer* timers;
+static int num_timers;
+static uint32_t num_bad;
+static uint32_t num_calls;
+
+// A timer and the tick the reference expects it to expire on
+struct Test_timer {
+    Timer_wheel::Timer timer{on_expiry, this};
+    uint64_t expiry_tick = 0;   // 0 if it is not scheduled
+    bool periodic = false;      // schedule itself again from its callback
+
+    void schedule(uint32_t delay_us)
+    {
+        uint64_t now_us = time_us_64();
+        expiry_tick = std::max((now_us + delay_us + tick_us - 1) / tick_us, now_us / tick_us + 1);
+        wheel->schedule(timer, delay_us);
+    }
+    void cancel()
+    {
+        expiry_tick = 0;
+        wheel->cancel(timer);
+    }
+};
+
+// Mostly less than a rotation, sometimes several rotations
+static uint32_t random_delay()
+{
+    switch (rand() % 4) {
+        case 0:
+            return rand() % (2 * tick_us);
+        case 1:
+            return rand() % (4 * rotation_us);
+        default:
+            return rand() % rotation_us;
+    }
+}
+
+static void on_expiry(Timer_wheel::Timer&, void* context)
+{
+    auto timer = reinterpret_cast<Test_timer*>(context);
+    ++num_calls;
+    // Never early, and only if it is scheduled
+    if (timer->expiry_tick == 0 || timer->expiry_tick > get_tick())
+        ++num_bad;
+    timer->expiry_tick = 0;
+    if (timer->periodic)
+        timer->schedule(random_delay());
+    // Callbacks may also cancel timers that expired in the same run()
+    if (rand() % 8 == 0)
+        timers[rand() % num_timers].cancel();
+}
+
+// Every timer that is due has run, and the one alarm is set for the
+// earliest deadline
+static bool check_wheel()
+{
+    uint64_t now = get_tick();
+    uint64_t earliest = 0;
+    for (int idx = 0; idx < num_timers; idx++) {
+        const Test_timer& timer = timers[idx];
+        if (timer.timer.is_pending() != (timer.expiry_tick != 0) || (timer.expiry_tick != 0 && timer.expiry_tick <= now))
+            return false;
+        if (timer.expiry_tick != 0 && (earliest == 0 || timer.expiry_tick < earliest))
+            earliest = timer.expiry_tick;
+    }
+    if (earliest == 0)
+        return host_alarms.empty();
+    return host_alarms.size() == 1 && host_alarms[0].time == earliest * tick_us;
+}
+
+// Fire the alarm if it is due and call run() if the alarm says to, as a main loop does
+static void main_loop()
+{
+    host_fire_alarms();
+    if (wheel->is_due())
+        wheel->run();
+}
+
+static void test_against_reference(uint64_t start_tick)
+{
+    host_time_manual.store(true);
+    host_time_us.store(start_tick * tick_us + rand() % tick_us);
+    host_alarms.clear();
+    Timer_wheel timer_wheel(tick_us, log2_num_slots);
+    Test_timer test_timers[16];
+    wheel = &timer_wheel;
+    timers = test_timers;
+    num_timers = 16;
+    for (int idx = 0; idx < num_timers; idx++)
+        test_timers[idx].periodic = idx % 4 == 0;
+    num_bad = 0;
+    num_calls = 0;
+    for (int step = 0; step < 200000; step++) {
+        switch (rand() % 8) {
+            case 0:
+            case 1:
+                test_timers[rand() % num_timers].schedule(random_delay());
+                break;
+            case 2:
+                test_timers[rand() % num_timers].cancel();
+                break;
+            case 3:
+                // Calling run() when nothing is due is harmless
+                timer_wheel.run();
+                break;
+            default:
+                break;
+        }
+        // Mostly a fraction of a tick, sometimes more than a rotation
+        host_time_us.fetch_add(rand() % 16 ? rand() % (2 * tick_us) : rand() % (3 * rotation_us));
+        main_loop();
+        if (!check_wheel())
+            ++num_bad;
+    }
+    printf("start tick %llu: %u timer callbacks\n", static_cast<unsigned long long>(start_tick), num_calls);
+    CHECK(num_bad == 0);
+    for (int idx = 0; idx < num_timers; idx++)
+        test_timers[idx].cancel();
+    CHECK(host_alarms.empty());
+}
+
+// The alarm fires, and before run() a timer is scheduled for later. The
+// earliest deadline is still the one the alarm was set for, so no alarm is
+// set; run() has to set the alarm for the later timer.
+static void test_schedule_after_alarm()
+{
+    host_time_manual.store(true);
+    host_time_us.store(1000000);
+    host_alarms.clear();
+    Timer_wheel timer_wheel(tick_us, log2_num_slots);
+    Test_timer test_timers[2];
+    wheel = &timer_wheel;
+    timers = test_timers;
+    num_timers = 2;
+    num_bad = 0;
+    test_timers[0].schedule(5 * tick_us);
+    CHECK(check_wheel());
+    host_time_us.fetch_add(5 * tick_us);
+    host_fire_alarms();
+    CHECK(timer_wheel.is_due() && host_alarms.empty());
+    test_timers[1].schedule(2 * rotation_us);
+    CHECK(timer_wheel.is_due() && host_alarms.empty());
+    timer_wheel.run();
+    CHECK(!test_timers[0].timer.is_pending() && check_wheel());
+    host_time_us.fetch_add(2 * rotation_us);
+    main_loop();
+    CHECK(!test_timers[1].timer.is_pending() && check_wheel());
+
+    // The same with the expired timer moved to a later tick before run()
+    test_timers[0].schedule(3 * tick_us);
+    host_time_us.fetch_add(3 * tick_us);
+    host_fire_alarms();
+    test_timers[0].schedule(tick_us);
+    CHECK(check_wheel());
+    timer_wheel.run();
+    CHECK(test_timers[0].timer.is_pending() && check_wheel());
+    host_time_us.fetch_add(tick_us);
+    main_loop();
+    CHECK(!test_timers[0].timer.is_pending() && check_wheel());
+    CHECK(num_bad == 0);
+}
+
+int main()
+{
+    srand(1);
+    test_schedule_after_alarm();
+    test_against_reference(1000);
+    // The 32-bit tick count wraps during the test
+    test_against_reference(UINT32_MAX - 2000);
+    return test_result();
+}
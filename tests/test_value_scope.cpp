@@ -0,0 +1,124 @@
+/**
+ * @file test_value_scope.cpp
+ * @brief Check that painting a Value_scope a few columns at a time leaves
+ * the same canvas as drawing it from scratch, and time both.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+#include "value_scope.h"
+#include "ram_display.h"
+#include "test_check.h"
+
+using namespace rppicomidi;
+
+static void test_paint_matches_draw(Display_rotation rotation, uint16_t samples_per_column)
+{
+    Ram_display mem;
+    Ssd1306 display(&mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Mono_graphics screen(&display, rotation);
+    uint8_t width = screen.get_screen_width() - 10;
+    uint8_t height = std::min(screen.get_screen_height() - 8, 40);
+    Widget_root root(screen);
+    Value_scope scope(screen, 3, 5, width, height, 127, samples_per_column);
+    // A frame around the scope, which painting the scope must not touch
+    screen.draw_rectangle(2, 4, width + 2, height + 2, Pixel_state::PIXEL_ONE, Pixel_state::PIXEL_TRANSPARENT);
+    root.add(scope);
+
+    std::vector<uint8_t> painted(screen.get_canvas_nbytes());
+    uint32_t num_bad = 0;
+    for (int frame = 0; frame < 3000; frame++) {
+        // Mostly a few samples per frame, sometimes more than the scope is wide
+        int num_samples = rand() % 3 == 0 ? rand() % 300 : rand() % 4;
+        for (int sample = 0; sample < num_samples; sample++)
+            scope.add_sample(rand() % 140);
+        if (rand() % 5 == 0)
+            scope.advance();
+        if (rand() % 500 == 0)
+            scope.clear();
+        root.render_frame();
+        memcpy(painted.data(), screen.get_canvas(), painted.size());
+        scope.draw();
+        if (memcmp(painted.data(), screen.get_canvas(), painted.size()) != 0)
+            ++num_bad;
+    }
+    CHECK(num_bad == 0);
+}
+
+static void benchmark()
+{
+    Ram_display mem;
+    Ssd1306 display(&mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Mono_graphics screen(&display, Display_rotation::Landscape0);
+    Widget_root root(screen);
+    Value_scope scope(screen, 0, 0, 128, 64, 127, 16);
+    root.add(scope);
+    uint8_t first_col[8], last_col[8];
+
+    const int num_samples = 2000000;
+    auto start = std::chrono::steady_clock::now();
+    for (int sample = 0; sample < num_samples; sample++)
+        scope.add_sample((sample * 7) & 127);
+    auto add_end = std::chrono::steady_clock::now();
+    root.render_frame();
+
+    // Each frame adds one column of 16 samples
+    const int num_frames = 20000;
+    auto paint_start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < num_frames; frame++) {
+        for (int sample = 0; sample < 16; sample++)
+            scope.add_sample((frame * 13 + sample) & 127);
+        root.paint();
+        screen.take_dirty(first_col, last_col);
+    }
+    auto paint_end = std::chrono::steady_clock::now();
+    const int num_draws = 2000;
+    for (int idx = 0; idx < num_draws; idx++) {
+        scope.draw();
+        screen.take_dirty(first_col, last_col);
+    }
+    auto draw_end = std::chrono::steady_clock::now();
+    auto us = [](std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to, int count) {
+        return std::chrono::duration<double, std::micro>(to - from).count() / count;
+    };
+    printf("add_sample(): %.3f us, frame with 1 new column: %.2f us, full redraw: %.2f us\n",
+        us(start, add_end, num_samples), us(paint_start, paint_end, num_frames), us(paint_end, draw_end, num_draws));
+}
+
+int main()
+{
+    srand(1);
+    for (Display_rotation rotation : {Display_rotation::Landscape0, Display_rotation::Portrait90,
+            Display_rotation::Landscape180, Display_rotation::Portrait270}) {
+        test_paint_matches_draw(rotation, 1);
+        test_paint_matches_draw(rotation, 4);
+    }
+    benchmark();
+    return test_result();
+}
@@ -0,0 +1,170 @@
+/**
+ * @file test_vpot_display.cpp
+ * @brief Check that the sprite based Vpot_display draws the same pixels as
+ * the original circle based drawing code, and time both.
+ *
+ * Copyright (c) 2022 rppicomid
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "vpot_display.h"
+#include "ram_display.h"
+#include "test_check.h"
+
+using namespace rppicomidi;
+
+// The Vpot_display drawing code before the LED geometry and the circles
+// were precomputed. It draws everything with float trigonometry and
+// draw_centered_circle().
+static void draw_reference(Mono_graphics& screen, uint8_t x, uint8_t y, uint8_t cc_value)
+{
+    const uint8_t led_r = Vpot_display::led_r;
+    const uint8_t outline_r = Vpot_display::outline_r;
+    const uint8_t led_placement_r = Vpot_display::led_placement_r;
+    const uint8_t p_led_placement_r = Vpot_display::p_led_placement_r;
+    const uint8_t center_x = x + Vpot_display::vpot_width/2;
+    const uint8_t center_y = y + Vpot_display::vpot_height/2;
+    bool p_led_on = (cc_value & 0x40) != 0;
+    Vpot_mode mode = static_cast<Vpot_mode>((cc_value >> 4) & 3);
+    uint8_t value = cc_value & 0xf;
+    if (value > 11)
+        value = 0;
+
+    screen.draw_centered_circle(center_x, center_y, outline_r, Pixel_state::PIXEL_ONE, Pixel_state::PIXEL_TRANSPARENT);
+    screen.draw_centered_circle(center_x, center_y, outline_r/2, Pixel_state::PIXEL_ONE, Pixel_state::PIXEL_ONE);
+    screen.draw_centered_circle(center_x, center_y+p_led_placement_r, led_r, Pixel_state::PIXEL_ONE,
+        p_led_on ? Pixel_state::PIXEL_ONE:Pixel_state::PIXEL_ZERO);
+    uint8_t delta = abs(6 - value);
+    uint8_t min_range = 6-delta;
+    uint8_t max_range = 6+delta;
+    for (int angle_mult = -1; angle_mult <= 9; angle_mult++) {
+        float angle = (M_PI / 8.0) * static_cast<float>(angle_mult);
+        float x0 = std::cos(angle) * led_placement_r;
+        float y0 = std::sin(angle) * led_placement_r;
+        uint8_t led_x = uint8_t((int)center_x - (int)x0);
+        uint8_t led_y = uint8_t((int)center_y - (int)y0);
+        uint8_t value_led = angle_mult + 2;
+        bool is_on = false;
+        switch (mode) {
+            case Vpot_mode::SINGLE_DOT:
+                is_on = value_led == value;
+                break;
+            case Vpot_mode::BOOST_CUT:
+                if (value > 6)
+                    is_on = value_led <= value && value_led >= 6;
+                else
+                    is_on = value_led >= value && value_led <= 6;
+                break;
+            case Vpot_mode::WRAP:
+                is_on = value_led <= value;
+                break;
+            case Vpot_mode::SPREAD:
+                if (value == 6)
+                    is_on = value_led == value;
+                else
+                    is_on = value_led >= min_range && value_led <= max_range;
+                break;
+        }
+        screen.draw_centered_circle(led_x, led_y, led_r, Pixel_state::PIXEL_ONE, is_on ? Pixel_state::PIXEL_ONE:Pixel_state::PIXEL_ZERO);
+    }
+}
+
+static void test_same_pixels(Display_rotation rotation)
+{
+    Ram_display mem, reference_mem;
+    Ssd1306 display(&mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Ssd1306 reference_display(&reference_mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Mono_graphics screen(&display, rotation);
+    Mono_graphics reference(&reference_display, rotation);
+    uint8_t width = screen.get_screen_width();
+    uint8_t height = screen.get_screen_height();
+
+    // The last positions are partly off the right or bottom of the screen
+    uint32_t num_bad = 0;
+    for (int pos = 0; pos < 24; pos++) {
+        screen.clear_canvas();
+        reference.clear_canvas();
+        uint8_t x = rand() % (width - Vpot_display::vpot_width + (pos < 20 ? 1 : 20));
+        uint8_t y = rand() % (height - Vpot_display::vpot_height + (pos < 20 ? 1 : 20));
+        if (pos % 5 == 4) {
+            uint8_t x1 = x + 5 < width ? x + 5 : width - 1;
+            uint8_t y1 = y + 3 < height ? y + 3 : height - 1;
+            screen.set_clip_rect(x1, y1, width - 1, height - 1);
+            reference.set_clip_rect(x1, y1, width - 1, height - 1);
+        }
+        uint8_t cc_value = rand() & 0x7B;  // a value of 0-11
+        Vpot_display vpot(screen, x, y, static_cast<Vpot_mode>((cc_value >> 4) & 3), cc_value & 0xF, (cc_value & 0x40) != 0);
+        for (int update = 0; update < 500; update++) {
+            draw_reference(reference, x, y, cc_value);
+            if (memcmp(screen.get_canvas(), reference.get_canvas(), screen.get_canvas_nbytes()) != 0)
+                ++num_bad;
+            cc_value = rand() & 0x7F;
+            vpot.set_by_cc_value(cc_value);
+        }
+        screen.set_clip_rect(0, 0, width - 1, height - 1);
+        reference.set_clip_rect(0, 0, width - 1, height - 1);
+    }
+    CHECK(num_bad == 0);
+}
+
+static void benchmark()
+{
+    Ram_display mem;
+    Ssd1306 display(&mem, Ssd1306::Com_pin_cfg::ALT_DIS, 128, 64, 0, 0);
+    Mono_graphics screen(&display, Display_rotation::Landscape0);
+    Vpot_display vpot(screen, 3, 5, Vpot_mode::WRAP, 0, false);
+    uint8_t cc_values[256];
+    for (int idx = 0; idx < 256; idx++)
+        cc_values[idx] = rand() & 0x7F;
+
+    const int num_calls = 200000;
+    auto start = std::chrono::steady_clock::now();
+    for (int idx = 0; idx < num_calls; idx++)
+        draw_reference(screen, 3, 5, cc_values[idx & 255]);
+    auto reference_end = std::chrono::steady_clock::now();
+    for (int idx = 0; idx < num_calls; idx++)
+        vpot.set_by_cc_value(cc_values[idx & 255]);
+    auto update_end = std::chrono::steady_clock::now();
+    for (int idx = 0; idx < num_calls; idx++)
+        vpot.draw();
+    auto draw_end = std::chrono::steady_clock::now();
+    auto ns = [](std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+        return std::chrono::duration<double, std::nano>(to - from).count() / num_calls;
+    };
+    printf("circle drawing: %.0f ns, set_by_cc_value(): %.0f ns, draw(): %.0f ns\n",
+        ns(start, reference_end), ns(reference_end, update_end), ns(update_end, draw_end));
+}
+
+int main()
+{
+    srand(1);
+    test_same_pixels(Display_rotation::Landscape0);
+    test_same_pixels(Display_rotation::Portrait90);
+    test_same_pixels(Display_rotation::Landscape180);
+    test_same_pixels(Display_rotation::Portrait270);
+    benchmark();
+    return test_result();
+}